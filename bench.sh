@@ -0,0 +1,90 @@
+#!/bin/sh
+#SECU-3  - An open source, free engine control unit
+#Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+# Script for benchmarking of the crankshaft position decoders using host simulator.
+# For each decoder simulator is built (see DECODER in Makefile_host) and run over
+# range of RPM with each of suitable trigger wheels (streams). Host time spent by decoder per tooth,
+# number of teeth passed before the first spark and error of spark timing are reported.
+# Script fails (exit code 1) if absolute mean error exceeds MAX_MEAN or maximum error exceeds
+# MAX_ERR degrees, or if no spark was measured. Such results are marked with FAIL.
+# Note: It requires host GCC toolchain
+
+USAGE="USAGE: bench.sh [decoder...] \n Supported decoders: ckps 2ch odd cs nplus1 hall"
+MAKEFILE="Makefile_host"
+SIM="./secu-3_sim"
+RPMS="600 1000 3000 6000 9000"
+TIME=2000
+MAX_MEAN=1.0  #deg
+MAX_ERR=1.5   #deg
+
+if [ $# -eq 0 ]
+then
+ DECODERS="ckps 2ch odd cs nplus1 hall"
+else
+ DECODERS=$@
+fi
+
+#streams (name of wheel and options of simulator) for each decoder, one per line
+wheel_opts()
+{
+ case $1 in
+  ckps)   echo "60-2 -p -n 60 -m 2"
+          echo "36-1 -p -n 36 -m 1" ;;
+  2ch)    echo "60-2 -p -n 60 -m 2 -E" ;;
+  odd)    echo "60-2 -p -n 60 -m 2"
+          echo "60-2/odd-fire -p -n 60 -m 2 -T 114,204,474,564" ;; #firing intervals 90,270,90,270 deg
+  cs)     echo "60-2/cam -p -n 60 -m 2 -w" ;;
+  nplus1) echo "n+1 -P 0,180,330 -b 60" ;;
+  hall)   echo "shutter -p -P 0,60,180,240 -b 60" ;;
+  *)      return 1 ;;
+ esac
+}
+
+RESULTS=`mktemp`
+trap 'rm -f $RESULTS' EXIT
+echo "Limits: |mean error| <= $MAX_MEAN deg, max error <= $MAX_ERR deg"
+printf "%-8s %-14s %6s %10s %12s %16s %16s\n" "decoder" "wheel" "rpm" "ns/tooth" "first spark" "mean error,deg" "max error,deg"
+for DEC in $DECODERS
+do
+ STREAMS=`wheel_opts $DEC`
+ if [ $? -ne 0 ]
+ then
+  echo "Invalid decoder: "$DEC
+  echo " "$USAGE
+  exit 1  #error
+ fi
+
+ make -f $MAKEFILE clean > /dev/null
+ make -f $MAKEFILE DECODER=$DEC > /dev/null 2>&1
+ if [ $? -ne 0 ]
+ then
+  echo "Can't build simulator for decoder: "$DEC
+  exit 1  #error
+ fi
+
+ echo "$STREAMS" | while read WHEEL OPTS
+ do
+  for RPM in $RPMS
+  do
+   $SIM $OPTS -r $RPM -t $TIME < /dev/null | awk -v dec=$DEC -v wheel=$WHEEL -v rpm=$RPM -v max_mean=$MAX_MEAN -v max_err=$MAX_ERR '
+    /^decoder:/      { ns = $2 }
+    /^sparks:/       { first = $5 }
+    /^spark error:/  { mean = $4; max = $7 }
+    END {
+     fail = (mean == "" || (mean < 0 ? -mean : mean) > max_mean || max > max_err)
+     printf "%-8s %-14s %6s %10s %12s %16s %16s%s\n", dec, wheel, rpm, ns, (first == "" ? "-" : first), (mean == "" ? "-" : mean), (max == "" ? "-" : max), (fail ? "  FAIL" : "")
+    }' | tee -a $RESULTS
+  done
+ done
+done
+
+#restore default build
+make -f $MAKEFILE clean > /dev/null
+make -f $MAKEFILE > /dev/null 2>&1
+
+if grep -q "FAIL" $RESULTS
+then
+ echo "Spark timing error exceeds limits"
+ exit 1  #error
+fi
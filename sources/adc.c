@@ -91,6 +91,11 @@ typedef struct
 #ifndef TPIC8101
  uint8_t  waste_meas;            //!< if 1, then waste measurement will be performed for knock
 #endif
+#ifdef CYL_MAP_SAMPLING
+ volatile uint16_t map_cyl[ADC_MAP_CYL_MAX]; //!< last MAP values sampled for each cylinder
+ volatile uint8_t map_cyl_mask;  //!< bit mask of cylinders for which values in map_cyl[] are valid
+ volatile uint8_t map_cyl_idx;   //!< index of cylinder for current MAP measurement, ADC_MAP_CYL_MAX - none
+#endif
 }adcstate_t;
 
 /** ADC state variables */
@@ -188,11 +193,11 @@ uint16_t adc_get_knock_value(void)
  return value;
 }
 
-void adc_begin_measure(uint8_t speed2x)
+/**Starts conversion of the first input (MAP)
+ * \param speed2x Double ADC clock (0,1)
+ */
+static void start_measure(uint8_t speed2x)
 {
- if (!adc.sensors_ready)
-  return; //We can't start new measurement while previous one is not finished yet
-
  adc.sensors_ready = 0;
  ADMUX = ADCI_MAP|ADC_VREF_TYPE;
  if (speed2x)
@@ -202,6 +207,53 @@ void adc_begin_measure(uint8_t speed2x)
  SETBIT(ADCSRA, ADSC);
 }
 
+void adc_begin_measure(uint8_t speed2x)
+{
+ if (!adc.sensors_ready)
+  return; //We can't start new measurement while previous one is not finished yet
+
+#ifdef CYL_MAP_SAMPLING
+ adc.map_cyl_idx = ADC_MAP_CYL_MAX; //not bound to any cylinder
+#endif
+ start_measure(speed2x);
+}
+
+#ifdef CYL_MAP_SAMPLING
+void adc_begin_measure_cyl(uint8_t speed2x, uint8_t cyl)
+{
+ if (!adc.sensors_ready)
+  return; //We can't start new measurement while previous one is not finished yet
+
+ adc.map_cyl_idx = cyl;
+ start_measure(speed2x);
+}
+
+uint16_t adc_get_map_value_cycavg(void)
+{
+ uint8_t i = 0, n = 0, mask;
+ uint32_t sum = 0;
+ _BEGIN_ATOMIC_BLOCK();
+ mask = adc.map_cyl_mask;
+ for(; i < ADC_MAP_CYL_MAX; ++i, mask>>=1)
+ {
+  if (mask & 1)
+   sum+= adc.map_cyl[i], ++n;
+ }
+ if (!n)
+  sum = adc.map_value, n = 1; //there are no cylinder-resolved values
+ _END_ATOMIC_BLOCK();
+ return sum / n;
+}
+
+void adc_reset_map_value_cycavg(void)
+{
+ _BEGIN_ATOMIC_BLOCK();
+ adc.map_cyl_mask = 0;
+ adc.map_cyl_idx = ADC_MAP_CYL_MAX; //result of measurement which is in progress will be not bound to any cylinder
+ _END_ATOMIC_BLOCK();
+}
+#endif
+
 #ifndef TPIC8101
 //This function is used for HIP9011 only, it is not used for TPIC8101
 void adc_begin_measure_knock(uint8_t speed2x)
@@ -228,6 +280,10 @@ uint8_t adc_is_measure_ready(void)
 void adc_init(void)
 {
  adc.knock_value = 0;
+#ifdef CYL_MAP_SAMPLING
+ adc.map_cyl_mask = 0;
+ adc.map_cyl_idx = ADC_MAP_CYL_MAX;
+#endif
 #ifndef TPIC8101
  adc.waste_meas = 0;
 #endif
@@ -255,6 +311,13 @@ ISR(ADC_vect)
  {
   case ADCI_MAP: //Measurement of MAP completed
    adc.map_value = ADC;
+#ifdef CYL_MAP_SAMPLING
+   if (adc.map_cyl_idx < ADC_MAP_CYL_MAX)
+   {
+    adc.map_cyl[adc.map_cyl_idx] = adc.map_value;
+    adc.map_cyl_mask|= (1 << adc.map_cyl_idx);
+   }
+#endif
    ADMUX = ADCI_UBAT|ADC_VREF_TYPE;
    _DISABLE_INTERRUPT();  //disable interrupts to prevent nested ADC interrupts
    SETBIT(ADCSRA,ADSC);
@@ -28,6 +28,10 @@
 #ifndef _ADC_H_
 #define _ADC_H_
 
+#ifdef CYL_MAP_SAMPLING
+#define ADC_MAP_CYL_MAX         8          //!< Maximum number of cylinders for which MAP values are stored
+#endif
+
 #include <stdint.h>
 
 /** ADC discrete in Volts */
@@ -105,6 +109,26 @@ uint16_t adc_get_knock_value(void);
  */
 void adc_begin_measure(uint8_t speed2x);
 
+#ifdef CYL_MAP_SAMPLING
+/**Starts measurement of sensors' values (same as adc_begin_measure()), but MAP value obtained
+ * will be also remembered for specified cylinder. Used for angle-synchronous sampling of MAP.
+ * \param speed2x Double ADC clock (0,1)
+ * \param cyl Index of cylinder (ignition channel), 0...ADC_MAP_CYL_MAX-1
+ */
+void adc_begin_measure_cyl(uint8_t speed2x, uint8_t cyl);
+
+/**Get average of last MAP values sampled for each cylinder (i.e. average over one engine cycle).
+ * If there are no cylinder-resolved values, then last measured MAP value is returned.
+ * \return value in ADC discretes
+ */
+uint16_t adc_get_map_value_cycavg(void);
+
+/**Discards MAP values sampled for each cylinder. Must be called when engine stops or number of
+ * cylinders changes, otherwise stale values would be included into the average.
+ */
+void adc_reset_map_value_cycavg(void);
+#endif
+
 #ifndef TPIC8101
 /**      .    
  *  INT/HOLD  0  INTOUT       
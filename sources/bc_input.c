@@ -40,6 +40,7 @@
 #include "tables.h"  //for IOCFG_
 #include "measure.h"
 #include "ventilator.h"
+#include "vstimer.h"
 #include "wdt.h"
 
 /**Declare blink codes. Indexes in the array must correspond to numbers of bits of corresponding CE errors in ce_errors.h */
@@ -194,7 +195,7 @@ void bc_indication_mode(void)
   delay_hom(7);
 
   //read errors
-  eeprom_read(&errors, EEPROM_ECUERRORS_START, sizeof(uint32_t));
+  errors = ce_get_saved_errors();
 
   for(i = 0; i < ECUERROR_NUM; ++i)
   {
@@ -203,6 +204,7 @@ void bc_indication_mode(void)
 #if !defined(SECU3T)
    knock_read_expander();
 #endif
+   s_timer_process();
    pwrrelay_control();
 #if !defined(SECU3T)
    knock_write_expander();
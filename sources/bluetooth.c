@@ -275,6 +275,8 @@ uint8_t bt_set_namepass(void)
 
   //Send command to change name
   case 2:
+   if (!uart_is_tx_buff_free())
+    return 0;                      //busy
    append_tx_buff_with_at_name_cmd(d.bt_name);
    ++bts.btnp_mode;
    bts.strt_t1 = s_timer_gtc();    //set timer
@@ -285,6 +287,8 @@ uint8_t bt_set_namepass(void)
 
   //Send command to change password (pin)
   case 4:
+   if (!uart_is_tx_buff_free())
+    return 0;                      //busy
    append_tx_buff_with_at_pass_cmd(d.bt_pass);
    ++bts.btnp_mode;
    bts.strt_t1 = s_timer_gtc();    //set timer
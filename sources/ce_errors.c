@@ -47,7 +47,7 @@ typedef struct
 {
  uint32_t ecuerrors;         //!< 32 error codes maximum
  uint32_t merged_errors;     //!< caching errors to preserve resource of the EEPROM
- uint32_t write_errors;      //!< func. eeprom_start_wr_data() launches background process!
+ uint32_t saved_errors;      //!< errors saved in the EEPROM journal (also used as buffer for writing)
  uint16_t bv_tdc;            //!< board voltage debouncong counter for eliminating of false errors during normal transients
  uint8_t  bv_eds;            //!< board voltage error detecting state, used for state machine
  uint8_t  bv_dev;            //!< board voltage deviation flag, if 0, then voltage is below normal, if 1, then voltage is above normal
@@ -55,11 +55,17 @@ typedef struct
 #ifdef DEFERRED_CRC
  uint8_t  en_err_cls;        //!< Enable error's clearing flag
 #endif
+#ifdef DWELL_CONTROL
+ uint16_t eq_overruns;       //!< last seen number of ignition event queue overruns
+#endif
 }ce_state_t;
 
 /**State variables */
 ce_state_t ce_state = {0,0,0,0,0,0,0,
 #ifdef DEFERRED_CRC
+0,
+#endif
+#ifdef DWELL_CONTROL
 0
 #endif
 };
@@ -104,6 +110,18 @@ void check(ce_sett_t _PGM *cesd)
   ce_clear_error(ECUERROR_CKPS_MALFUNCTION);
  }
 
+#ifdef DWELL_CONTROL
+ //ignition events were dropped because of overrun of the ignition event queue
+ {
+  uint16_t eq_overruns = ckps_get_eq_overruns();
+  if (eq_overruns != ce_state.eq_overruns)
+   ce_set_error(ECUERROR_DWELL_CONTROL);
+  else
+   ce_clear_error(ECUERROR_DWELL_CONTROL);
+  ce_state.eq_overruns = eq_overruns;
+ }
+#endif
+
 #ifdef PHASE_SENSOR
  if (cams_is_error())
  {
@@ -295,22 +313,36 @@ void ce_save_merged_errors(uint32_t* p_merged_errors)
 
  if (!p_merged_errors) //overwrite with parameter?
  {
-  eeprom_read(&temp_errors, EEPROM_ECUERRORS_START, sizeof(uint32_t));
-  ce_state.write_errors = temp_errors | ce_state.merged_errors;
-  if (ce_state.write_errors!=temp_errors)
-   eeprom_start_wr_data(0, EEPROM_ECUERRORS_START, &ce_state.write_errors, sizeof(uint32_t));
+  temp_errors = ce_state.saved_errors | ce_state.merged_errors;
+  if (temp_errors!=ce_state.saved_errors)
+  {
+   ce_state.saved_errors = temp_errors;
+   eeprom_journal_start_wr(0, &ce_state.saved_errors);
+  }
  }
  else
  {
   ce_state.merged_errors = *p_merged_errors;
-  eeprom_start_wr_data(OPCODE_CE_SAVE_ERRORS, EEPROM_ECUERRORS_START, (uint8_t*)&ce_state.merged_errors, sizeof(uint32_t));
+  ce_state.saved_errors = *p_merged_errors;
+  eeprom_journal_start_wr(OPCODE_CE_SAVE_ERRORS, &ce_state.saved_errors);
  }
 }
 
 void ce_clear_errors(void)
 {
  memset(&ce_state, 0, sizeof(ce_state_t));
- eeprom_write((uint8_t*)&ce_state.write_errors, EEPROM_ECUERRORS_START, sizeof(uint32_t));
+ eeprom_journal_write(&ce_state.saved_errors);
+}
+
+void ce_init_saved_errors(void)
+{
+ if (!eeprom_journal_init(&ce_state.saved_errors))
+  eeprom_read(&ce_state.saved_errors, EEPROM_ECUERRORS_START, sizeof(uint32_t)); //journal is empty, take errors from legacy location
+}
+
+uint32_t ce_get_saved_errors(void)
+{
+ return ce_state.saved_errors;
 }
 
 void ce_init_ports(void)
@@ -85,6 +85,14 @@ void ce_save_merged_errors(uint32_t* p_merged_errors);
 /**Clears errors saved in EEPROM */
 void ce_clear_errors(void);
 
+/**Loads errors saved in EEPROM (scans journal). Must be called at start up before other functions
+ * which access saved errors
+ */
+void ce_init_saved_errors(void);
+
+/**\return errors saved in EEPROM */
+uint32_t ce_get_saved_errors(void);
+
 /**Initialization of used I/O ports */
 void ce_init_ports(void);
 
@@ -149,6 +149,7 @@ typedef struct
  volatile uint16_t degrees_per_chan;  //!< number of degrees per one channel (degrees between two spark events)
  volatile uint8_t eq_tail1;           //!< event queue tail (index in a static array)
  volatile uint8_t eq_head1;           //!< event queue head (index), queue is empty if head = tail
+ volatile uint16_t eq_overruns;       //!< number of overruns of the event queue (events were dropped or evicted)
 #endif
 #ifdef HALL_OUTPUT
  int8_t   hop_offset;                 //!< Hall output: start of pulse in teeth of wheel relatively to TDC
@@ -169,6 +170,7 @@ typedef struct
  volatile uint8_t  wheel_latch_btdc;
  volatile uint16_t degrees_per_cog;   //!< Number of degrees which corresponds to the 1 tooth
  volatile uint16_t degrees_per_cog_r; //!< Reciprocal of the degrees_per_cog, value * 65536
+ volatile uint16_t period_dsc;        //!< Time of 1 discrete of angle in ticks of timer 1, value * 256. Updated on each tooth
  volatile uint16_t cogs_per_chan;     //!< Number of teeth per 1 ignition channel (it is fractional number * 256)
  volatile int16_t start_angle;        //!< Precalculated value of the advance angle at 66 (at least) BTDC
 #ifdef STROBOSCOPE
@@ -247,8 +249,13 @@ PGM_DECLARE(uint32_t frq_calc_dividend[1+IGN_CHANNELS_MAX]) =
 
 #define DWL_DEAD_TIME 156        //!< 500uS dead time
 
-/**Maximum queue size for ignition events, MUST BE power of two (2,4,8 etc) */
-#define IGN_QUEUE_SIZE 4
+/**Maximum queue size for ignition events, MUST BE power of two (2,4,8 etc). Can be overridden from the command line */
+#ifndef IGN_QUEUE_SIZE
+ #define IGN_QUEUE_SIZE 8
+#endif
+#if (IGN_QUEUE_SIZE < 4) || (IGN_QUEUE_SIZE > 128) || (IGN_QUEUE_SIZE & (IGN_QUEUE_SIZE-1))
+ #error "IGN_QUEUE_SIZE must be power of two in range 4...128"
+#endif
 
 #define QID_DWELL  0             //!< start dwell
 #define QID_SPARK  1             //!< finish dwell (spark)
@@ -272,33 +279,99 @@ ign_queue_t ign_eq2[IGN_QUEUE_SIZE];
 /** Reset specified queue (makes it empty) */
 #define QUEUE_RESET(q)  ckps.eq_tail##q = ckps.eq_head##q = 0;
 
-/** Add event into the queue (add to head)
+/** Add event into the queue (add to head). If event must fire before end of the strobe pulse, then it takes
+ * place of the pulse (see QUEUE_CUT_STROBE1). Queue may become full only if compare channel missed its events,
+ * in this case overrun is counted and new event is dropped, except spark (see queue_overrun()).
  * r Timer's register (TCNT1 or ICR1)
  * time Time in tics of timer 1 after which event should fire
  * aid ID of pending action, which shold be performed
  */
 #define QUEUE_ADD(q, r, time, aid) \
-    ign_eq##q[ckps.eq_head##q].end_time = (r) + (time); \
-    ign_eq##q[ckps.eq_head##q].id = (aid); \
-    ckps.eq_head##q = (ckps.eq_head##q + 1) & (IGN_QUEUE_SIZE-1);
+    if (QUEUE_CUT_STROBE##q(r, time)) { \
+     QUEUE_TAIL(q).end_time = (r) + (time); \
+     QUEUE_TAIL(q).id = (aid); \
+     QUEUE_START##q(r, time); \
+    } \
+    else if (QUEUE_FREE(q) || queue_overrun(ign_eq##q, ckps.eq_tail##q, &ckps.eq_head##q, (aid))) { \
+     ign_eq##q[ckps.eq_head##q].end_time = (r) + (time); \
+     ign_eq##q[ckps.eq_head##q].id = (aid); \
+     ckps.eq_head##q = (ckps.eq_head##q + 1) & (IGN_QUEUE_SIZE-1); \
+    }
 
 /** Remove event from the queue (remove from tail)*/
 #define QUEUE_REMOVE(q) ckps.eq_tail##q = (ckps.eq_tail##q + 1) & (IGN_QUEUE_SIZE-1)
 
+/** Insert entry in front of the queue (before tail), it will be processed first. Queue must not be full */
+#define QUEUE_PUSH_TAIL(q) ckps.eq_tail##q = (ckps.eq_tail##q - 1) & (IGN_QUEUE_SIZE-1)
+
 /** Get tail item value from queue */
 #define QUEUE_TAIL(q) ign_eq##q[ckps.eq_tail##q]
 
 /** Test is queue empty */
 #define QUEUE_IS_EMPTY(q) (ckps.eq_head##q==ckps.eq_tail##q)
 
+/** Get number of free entries in the queue */
+#define QUEUE_FREE(q) ((ckps.eq_tail##q - ckps.eq_head##q - 1) & (IGN_QUEUE_SIZE-1))
+
+#ifdef STROBOSCOPE
+/** Strobe pulse must never delay ignition events. If new event must fire before end of the strobe pulse
+ * (pulse can be only in the tail of queue 1), then pulse is finished right now.
+ * \return 1 if pulse has been finished, so new event should take its place */
+#define QUEUE_CUT_STROBE1(r, time) (!QUEUE_IS_EMPTY(1) && QID_STROBE == QUEUE_TAIL(1).id && \
+    ((int16_t)(((r) + (time)) - QUEUE_TAIL(1).end_time)) < 0 && (IOCFG_SET(IOP_STROBE, 0), 1))
+#else
+#define QUEUE_CUT_STROBE1(r, time) 0
+#endif
+#define QUEUE_CUT_STROBE2(r, time) 0 //!< there is no strobe pulse in the queue 2
+
+/** Called when event is being added into the full queue, counts overrun (saturated). Spark is never dropped,
+ * because dwell of its coil may be already started, instead it takes place of the latest pending dwell event
+ * (that coil will not be charged). Tail entry is never removed, because it is already programmed into compare channel.
+ * \param eq Pointer to the queue
+ * \param tail Index of the tail entry
+ * \param p_head Pointer to index of the head entry, it is moved back if entry has been removed
+ * \param aid ID of the new event
+ * \return 1 if entry has been removed and new event can be added, 0 if new event must be dropped
+ */
+static uint8_t queue_overrun(ign_queue_t* eq, uint8_t tail, volatile uint8_t* p_head, uint8_t aid)
+{
+ uint8_t i = *p_head, j;
+ if (ckps.eq_overruns != 65535)
+  ++ckps.eq_overruns;
+ if (QID_SPARK != aid)
+  return 0;
+ while((i = (i - 1) & (IGN_QUEUE_SIZE-1)) != tail)
+ {
+  if (QID_DWELL == eq[i].id
+#ifdef STROBOSCOPE
+      || QID_STROBE == eq[i].id
+#endif
+     )
+  {
+   for(j = (i + 1) & (IGN_QUEUE_SIZE-1); j != *p_head; i = j, j = (j + 1) & (IGN_QUEUE_SIZE-1))
+    eq[i] = eq[j];                    //shift later events to fill the gap
+   *p_head = i;
+   return 1;
+  }
+ }
+ return 0;                            //there are only sparks (IGN_QUEUE_SIZE must be greater than number of channels)
+}
+
+/** Start compare channel of the specified queue (used when event takes place of the strobe pulse) */
+#define QUEUE_START1(r, v) SET_T1COMPA(r, v)
+#define QUEUE_START2(r, v) SET_T3COMPA(r, v)
+
 #endif //DWELL_CONTROL
 
-/**Set T1 COMPA channel of timer
+/**Set T1 COMPA channel of timer. If time of event already passed (e.g. event is scheduled at the captured
+ * tooth with zero delay), then it fires as soon as possible, otherwise it would fire only after overflow of timer
  * r Timer's register (TCNT1 or ICR1)
  * v Time in tics of timer 1 after which event should fire
  */
 #define SET_T1COMPA(r, v) \
      OCR1A = (r) + (v); \
+     if (((int16_t)(OCR1A - TCNT1)) < 2) \
+      OCR1A = TCNT1 + 2; \
      TIFR1 = _BV(OCF1A); \
      SETBIT(TIMSK1, OCIE1A);
 
@@ -320,6 +393,8 @@ ign_queue_t ign_eq2[IGN_QUEUE_SIZE];
  */
 #define SET_T3COMPA(r, v) \
      OCR3A = (r) + (v); \
+     if (((int16_t)(OCR3A - TCNT3)) < 2) \
+      OCR3A = TCNT3 + 2; \
      TIFR3 = _BV(OCF3A); \
      SETBIT(TIMSK3, OCIE3A);
 #endif
@@ -343,8 +418,10 @@ void ckps_init_state_variables(void)
 #ifdef SPLIT_ANGLE
  CLEARBIT(flags2, F_PNDDWL1);
 #endif
+ TIMSK1&= ~_BV(OCIE1A); //pending event must not fire when queue is already empty
  QUEUE_RESET(1);
 #ifdef SPLIT_ANGLE
+ TIMSK3&= ~_BV(OCIE3A);
  QUEUE_RESET(2);
 #endif
 #endif
@@ -612,6 +689,17 @@ void ckps_reset_error(void)
  CLEARBIT(flags, F_ERROR);
 }
 
+#ifdef DWELL_CONTROL
+uint16_t ckps_get_eq_overruns(void)
+{
+ uint16_t eq_overruns;
+ _BEGIN_ATOMIC_BLOCK();
+ eq_overruns = ckps.eq_overruns;
+ _END_ATOMIC_BLOCK();
+ return eq_overruns;
+}
+#endif
+
 void ckps_use_knock_channel(uint8_t use_knock_channel)
 {
  WRITEBIT(flags, F_USEKNK, use_knock_channel);
@@ -898,13 +986,13 @@ void ckps_set_inj_timing(int16_t phase, uint16_t pw, uint8_t mode)
  //Apply selected injection pulse option: begin of squirt, middle of squirt or end of squirt
  if (mode > INJANGLESPEC_BEGIN)
  {
-  uint16_t period_curr;
+  uint16_t period_dsc;
   _BEGIN_ATOMIC_BLOCK();
-  period_curr = ckps.period_curr;
+  period_dsc = ckps.period_dsc;
   _END_ATOMIC_BLOCK();
 
   //convert delay to angle (value * ANGLE_MULTIPLIER). TODO: how to escape from slow division?
-  uint16_t pw_angle = (((uint32_t)pw) * ckps.degrees_per_cog) / period_curr;
+  uint16_t pw_angle = period_dsc ? ((((uint32_t)pw) << 8) / period_dsc) : 0;
   if (mode == INJANGLESPEC_MIDDLE)
    pw_angle>>= 1;
   //apply, rotate angle if need
@@ -957,6 +1045,9 @@ static inline void turn_off_ignition_channel(uint8_t i_channel)
  */
 ISR(TIMER1_COMPA_vect)
 {
+#if defined(DWELL_CONTROL) && defined(STROBOSCOPE)
+ uint8_t strobe = 0;
+#endif
  TIMSK1&= ~_BV(OCIE1A); //disable this interrupt
 
 #ifdef DWELL_CONTROL
@@ -979,12 +1070,7 @@ ISR(TIMER1_COMPA_vect)
 #ifdef STROBOSCOPE
    if (1==ckps.strobe)
    {
-    IOCFG_SET(IOP_STROBE, 1);  //start pulse
-    if (QUEUE_IS_EMPTY(1))
-    {
-     SET_T1COMPA(TCNT1, STROBE_PW); //strobe pulse is 100uS by default
-    }
-    QUEUE_ADD(1, TCNT1, STROBE_PW, QID_STROBE);
+    strobe = 1;                //pulse will be started after processing of the queue
     ckps.strobe = 0;           //and reset flag
    }
 #endif
@@ -1033,6 +1119,21 @@ ISR(TIMER1_COMPA_vect)
  //Remove already processed event from queue. After that, is queue is not empty, then start
  //next event in chain. Also, prevent effects when event already expired.
  QUEUE_REMOVE(1);
+#ifdef STROBOSCOPE
+ //Strobe pulse is put in front of the queue only if it ends before the next pending event, otherwise it is dropped.
+ //Events added later and firing before end of the pulse will finish it (see QUEUE_CUT_STROBE1)
+ if (strobe)
+ {
+  uint16_t end_time = TCNT1 + STROBE_PW; //strobe pulse is 100uS by default
+  if (QUEUE_IS_EMPTY(1) || (QUEUE_FREE(1) && ((int16_t)(QUEUE_TAIL(1).end_time - end_time)) > 0))
+  {
+   QUEUE_PUSH_TAIL(1);
+   QUEUE_TAIL(1).end_time = end_time;
+   QUEUE_TAIL(1).id = QID_STROBE;
+   IOCFG_SET(IOP_STROBE, 1);  //start pulse
+  }
+ }
+#endif
  if (!QUEUE_IS_EMPTY(1))
  {
   uint16_t t = (QUEUE_TAIL(1).end_time-(uint16_t)2) - TCNT1;
@@ -1249,18 +1350,29 @@ static uint8_t sync_at_startup(void)
  return 0; //continue process of synchronization
 }
 
+/**Calculates time of 1 discrete of angle from period of the current tooth. It is done once per tooth,
+ * thus all conversions of angle to time below require only one 16x16 multiplication
+ */
+static void calc_period_dsc(void)
+{
+ uint32_t pd = ((((uint32_t)ckps.period_curr) * ckps.degrees_per_cog_r) + 128) >> 8;
+ ckps.period_dsc = (pd > 65535) ? 65535 : pd; //saturate at very low RPM
+}
+
 /**This procedure called for all teeth (including recovered teeth)
  */
 static void process_ckps_cogs(void)
 {
  uint8_t i;
 
+ calc_period_dsc();
+
 #ifdef DWELL_CONTROL
  if (CHECKBIT(flags, F_PNDDWL) && !ckps.rising_edge_spark)
  {
   //calculate delay between current tooth and next spark
-  int32_t angle_to_spark = (((int32_t)_normalize_tn(chanstate[ckps.channel_mode_b].cogs_btdc - ckps.cog)) * ckps.degrees_per_cog) - ckps.advance_angle;
-  int32_t delay =  (angle_to_spark * (((int32_t)ckps.period_curr * ckps.degrees_per_cog_r) >> 10)) >> 6; //convert angle to delay
+  int16_t angle_to_spark = (_normalize_tn(chanstate[ckps.channel_mode_b].cogs_btdc - ckps.cog) * ckps.degrees_per_cog) - ckps.advance_angle;
+  int32_t delay = (((int32_t)angle_to_spark) * ckps.period_dsc) >> 8; //convert angle to delay
   delay-= ckps.cr_acc_time;    //apply dwell time
 
   if (delay < (ckps.period_curr<<1))
@@ -1280,8 +1392,8 @@ static void process_ckps_cogs(void)
  if (CHECKBIT(flags2, F_PNDDWL1) && !ckps.rising_edge_spark)
  {
   //calculate delay between current tooth and next spark
-  int32_t angle_to_spark = (((int32_t)_normalize_tn(chanstate[ckps.channel_mode_b1].cogs_btdc - ckps.cog)) * ckps.degrees_per_cog) - ckps.advance_angle1;
-  int32_t delay =  (angle_to_spark * (((int32_t)ckps.period_curr * ckps.degrees_per_cog_r) >> 10)) >> 6; //convert angle to delay
+  int16_t angle_to_spark = (_normalize_tn(chanstate[ckps.channel_mode_b1].cogs_btdc - ckps.cog) * ckps.degrees_per_cog) - ckps.advance_angle1;
+  int32_t delay = (((int32_t)angle_to_spark) * ckps.period_dsc) >> 8; //convert angle to delay
   delay-= ckps.cr_acc_time;    //apply dwell time
 
   if (delay < (ckps.period_curr<<1))
@@ -1376,7 +1488,7 @@ static void process_ckps_cogs(void)
     if (diff <= (ckps.degrees_per_cog << 1))
     {
      ckps.inj_chidx = i;  //remember number of channel to be fired
-     uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPB_VECT_DELAY;
+     uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPB_VECT_DELAY;
      SET_T1COMPB(ICR1, delay);
      sync_inj_angle();
      chanstate[i].inj_skipth = 4;  //skip 4 teeth
@@ -1393,7 +1505,7 @@ static void process_ckps_cogs(void)
   uint16_t diff = ckps.current_angle - ckps.advance_angle;
   if (diff <= (ckps.degrees_per_cog << 1))
   {
-   uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPA_VECT_DELAY;
+   uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPA_VECT_DELAY;
 #ifdef DWELL_CONTROL
    //before starting the ignition it is left to count less than 2 teeth. It is necessary to prepare the compare module
    if (QUEUE_IS_EMPTY(1))
@@ -1415,7 +1527,7 @@ static void process_ckps_cogs(void)
   uint16_t diff = ckps.current_angle - ckps.advance_angle1;
   if (diff <= (ckps.degrees_per_cog << 1))
   {
-   uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPA_VECT_DELAY;
+   uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPA_VECT_DELAY;
 #ifdef DWELL_CONTROL
    //before starting the ignition it is left to count less than 2 teeth. It is necessary to prepare the compare module
    if (QUEUE_IS_EMPTY(2))
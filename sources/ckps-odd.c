@@ -131,6 +131,7 @@ typedef struct
  uint16_t cogang[TEETH_MAX];          //!< look up table for converting cog's number to corresponding angle
  volatile uint8_t eq_tail1;           //!< event queue tail (index in a static array)
  volatile uint8_t eq_head1;           //!< event queue head (index), queue is empty if head = tail
+ volatile uint16_t eq_overruns;       //!< number of overruns of the event queue (events were dropped or evicted)
  volatile uint8_t chan_number;        //!< number of ignition channels
  volatile uint8_t wheel_last_cog;     //!< Number of last(present) tooth, numeration begins from 0
  volatile uint8_t wheel_cogs_num;     //!< Number of teeth, including missing
@@ -146,6 +147,9 @@ typedef struct
  volatile uint16_t cr_acc_time;       //!< accumulation time for dwell control (timer's ticks)
  volatile uint16_t degrees_per_cog;   //!< Number of degrees which corresponds to the 1 tooth
  volatile uint16_t degrees_per_cog_r; //!< Reciprocal of the degrees_per_cog, value * 65536
+#ifdef CYL_MAP_SAMPLING
+ volatile uint8_t smp_chan;           //!< index of channel for which sensors' sample event is queued
+#endif
  volatile uint16_t wheel_deg_r;       //!< constant = wheel_cogs_num*(65536/360)
 
  volatile uint8_t TCNT0_H;            //!< For supplementing timer/counter 0 up to 16 bits
@@ -217,8 +221,13 @@ PGM_DECLARE(uint32_t frq_calc_dividend[1+IGN_CHANNELS_MAX]) =
  //     1          2          3          4         5         6         7         8
  {0, 37500000L, 18750000L, 12500000L, 9375000L, 7500000L, 6250000L, 5357143L, 4687500L};
 
-/**Maximum queue size for ignition events, MUST BE power of two (2,4,8 etc) */
-#define IGN_QUEUE_SIZE 32
+/**Maximum queue size for ignition events, MUST BE power of two (2,4,8 etc). Can be overridden from the command line */
+#ifndef IGN_QUEUE_SIZE
+ #define IGN_QUEUE_SIZE 32
+#endif
+#if (IGN_QUEUE_SIZE < 4) || (IGN_QUEUE_SIZE > 128) || (IGN_QUEUE_SIZE & (IGN_QUEUE_SIZE-1))
+ #error "IGN_QUEUE_SIZE must be power of two in range 4...128"
+#endif
 
 #define QID_DWELL   0             //!< start dwell
 #define QID_SPARK   1             //!< finish dwell (spark)
@@ -253,7 +262,9 @@ ign_queue_t ign_eq2[IGN_QUEUE_SIZE];
 /** Reset specified queue (makes it empty) */
 #define QUEUE_RESET(q)  ckps.eq_tail##q = ckps.eq_head##q = 0;
 
-/** Add event into the queue (add to head)
+/** Add event into the queue (add to head). If event must fire before end of the strobe pulse, then it takes
+ * place of the pulse (see QUEUE_CUT_STROBE1). Queue may become full only if compare channel missed its events,
+ * in this case overrun is counted and new event is dropped, except spark (see queue_overrun()).
  * q Number of queue
  * r Timer's register (TCNT1 or ICR1)
  * time Time in tics of timer 1 after which event should fire
@@ -261,31 +272,103 @@ ign_queue_t ign_eq2[IGN_QUEUE_SIZE];
  * chan Number of channel
  */
 #define QUEUE_ADD(q, r, time, aid, chan) \
-    ign_eq##q[ckps.eq_head##q].end_time = (r) + (time); \
-    ign_eq##q[ckps.eq_head##q].id = (aid); \
-    ign_eq##q[ckps.eq_head##q].ch = (chan); \
-    ckps.eq_head##q = (ckps.eq_head##q + 1) & (IGN_QUEUE_SIZE-1);
+    if (QUEUE_CUT_STROBE##q(r, time)) { \
+     QUEUE_TAIL(q).end_time = (r) + (time); \
+     QUEUE_TAIL(q).id = (aid); \
+     QUEUE_TAIL(q).ch = (chan); \
+     QUEUE_START##q(r, time); \
+    } \
+    else if (QUEUE_FREE(q) || queue_overrun(ign_eq##q, ckps.eq_tail##q, &ckps.eq_head##q, (aid))) { \
+     ign_eq##q[ckps.eq_head##q].end_time = (r) + (time); \
+     ign_eq##q[ckps.eq_head##q].id = (aid); \
+     ign_eq##q[ckps.eq_head##q].ch = (chan); \
+     ckps.eq_head##q = (ckps.eq_head##q + 1) & (IGN_QUEUE_SIZE-1); \
+    }
 
 #define QUEUE_ADDF(q, r, time, aid) \
-    ign_eq##q[ckps.eq_head##q].end_time = (r) + (time); \
-    ign_eq##q[ckps.eq_head##q].id = (aid); \
-    ckps.eq_head##q = (ckps.eq_head##q + 1) & (IGN_QUEUE_SIZE-1);
+    if (QUEUE_CUT_STROBE##q(r, time)) { \
+     QUEUE_TAIL(q).end_time = (r) + (time); \
+     QUEUE_TAIL(q).id = (aid); \
+     QUEUE_START##q(r, time); \
+    } \
+    else if (QUEUE_FREE(q) || queue_overrun(ign_eq##q, ckps.eq_tail##q, &ckps.eq_head##q, (aid))) { \
+     ign_eq##q[ckps.eq_head##q].end_time = (r) + (time); \
+     ign_eq##q[ckps.eq_head##q].id = (aid); \
+     ckps.eq_head##q = (ckps.eq_head##q + 1) & (IGN_QUEUE_SIZE-1); \
+    }
 
 /** Remove event from the queue (remove from tail)*/
 #define QUEUE_REMOVE(q) ckps.eq_tail##q = (ckps.eq_tail##q + 1) & (IGN_QUEUE_SIZE-1)
 
+/** Insert entry in front of the queue (before tail), it will be processed first. Queue must not be full */
+#define QUEUE_PUSH_TAIL(q) ckps.eq_tail##q = (ckps.eq_tail##q - 1) & (IGN_QUEUE_SIZE-1)
+
 /** Get tail item value from queue */
 #define QUEUE_TAIL(q) ign_eq##q[ckps.eq_tail##q]
 
 /** Test is queue empty */
 #define QUEUE_IS_EMPTY(q) (ckps.eq_head##q==ckps.eq_tail##q)
 
-/**Set T1 COMPA channel of timer
+/** Get number of free entries in the queue */
+#define QUEUE_FREE(q) ((ckps.eq_tail##q - ckps.eq_head##q - 1) & (IGN_QUEUE_SIZE-1))
+
+#ifdef STROBOSCOPE
+/** Strobe pulse must never delay other events. If new event must fire before end of the strobe pulse
+ * (pulse can be only in the tail of queue 1), then pulse is finished right now.
+ * \return 1 if pulse has been finished, so new event should take its place */
+#define QUEUE_CUT_STROBE1(r, time) (!QUEUE_IS_EMPTY(1) && QID_STROBE == QUEUE_TAIL(1).id && \
+    ((int16_t)(((r) + (time)) - QUEUE_TAIL(1).end_time)) < 0 && (IOCFG_SET(IOP_STROBE, 0), 1))
+#else
+#define QUEUE_CUT_STROBE1(r, time) 0
+#endif
+#define QUEUE_CUT_STROBE2(r, time) 0 //!< there is no strobe pulse in the queue 2
+
+/** Called when event is being added into the full queue, counts overrun (saturated). Spark is never dropped,
+ * because dwell of its coil may be already started, instead it takes place of the latest pending dwell event
+ * (that coil will not be charged). Tail entry is never removed, because it is already programmed into compare channel.
+ * \param eq Pointer to the queue
+ * \param tail Index of the tail entry
+ * \param p_head Pointer to index of the head entry, it is moved back if entry has been removed
+ * \param aid ID of the new event
+ * \return 1 if entry has been removed and new event can be added, 0 if new event must be dropped
+ */
+static uint8_t queue_overrun(ign_queue_t* eq, uint8_t tail, volatile uint8_t* p_head, uint8_t aid)
+{
+ uint8_t i = *p_head, j;
+ if (ckps.eq_overruns != 65535)
+  ++ckps.eq_overruns;
+ if (QID_SPARK != aid)
+  return 0;
+ while((i = (i - 1) & (IGN_QUEUE_SIZE-1)) != tail)
+ {
+  if (QID_DWELL == eq[i].id
+#ifdef STROBOSCOPE
+      || QID_STROBE == eq[i].id
+#endif
+     )
+  {
+   for(j = (i + 1) & (IGN_QUEUE_SIZE-1); j != *p_head; i = j, j = (j + 1) & (IGN_QUEUE_SIZE-1))
+    eq[i] = eq[j];                    //shift later events to fill the gap
+   *p_head = i;
+   return 1;
+  }
+ }
+ return 0;                            //there are only sparks (IGN_QUEUE_SIZE must be greater than number of channels)
+}
+
+/** Start compare channel of the specified queue (used when event takes place of the strobe pulse) */
+#define QUEUE_START1(r, v) SET_T1COMPA(r, v)
+#define QUEUE_START2(r, v) SET_T3COMPA(r, v)
+
+/**Set T1 COMPA channel of timer. If time of event already passed (e.g. event is scheduled at the captured
+ * tooth with zero delay), then it fires as soon as possible, otherwise it would fire only after overflow of timer
  * r Timer's register (TCNT1 or ICR1)
  * v Time in tics of timer 1 after which event should fire
  */
 #define SET_T1COMPA(r, v) \
      OCR1A = (r) + (v); \
+     if (((int16_t)(OCR1A - TCNT1)) < 2) \
+      OCR1A = TCNT1 + 2; \
      TIFR1 = _BV(OCF1A); \
      SETBIT(TIMSK1, OCIE1A);
 
@@ -307,6 +390,8 @@ ign_queue_t ign_eq2[IGN_QUEUE_SIZE];
  */
 #define SET_T3COMPA(r, v) \
      OCR3A = (r) + (v); \
+     if (((int16_t)(OCR3A - TCNT3)) < 2) \
+      OCR3A = TCNT3 + 2; \
      TIFR3 = _BV(OCF3A); \
      SETBIT(TIMSK3, OCIE3A);
 #endif
@@ -331,11 +416,16 @@ void ckps_init_state_variables(void)
  ckps.stroke_period = 0xFFFF;
  ckps.cr_acc_time = 0;
  ckps.starting_mode = 0;
+ TIMSK1&= ~_BV(OCIE1A); //pending event must not fire when queue is already empty
  QUEUE_RESET(1);
 #ifdef SPLIT_ANGLE
+ TIMSK3&= ~_BV(OCIE3A);
  QUEUE_RESET(2);
 #endif
  _END_ATOMIC_BLOCK();
+#ifdef CYL_MAP_SAMPLING
+ adc_reset_map_value_cycavg();        //engine is stopped, MAP values sampled in the last cycle are stale
+#endif
 }
 
 void ckps_init_state(void)
@@ -638,6 +728,17 @@ void ckps_reset_error(void)
  CLEARBIT(flags, F_ERROR);
 }
 
+#ifdef DWELL_CONTROL
+uint16_t ckps_get_eq_overruns(void)
+{
+ uint16_t eq_overruns;
+ _BEGIN_ATOMIC_BLOCK();
+ eq_overruns = ckps.eq_overruns;
+ _END_ATOMIC_BLOCK();
+ return eq_overruns;
+}
+#endif
+
 void ckps_use_knock_channel(uint8_t use_knock_channel)
 {
  WRITEBIT(flags, F_USEKNK, use_knock_channel);
@@ -770,6 +871,10 @@ void ckps_set_cyl_number(uint8_t i_cyl_number)
 
  ckps.frq_calc_dividend = FRQ_CALC_DIVIDEND(i_cyl_number);
 
+#ifdef CYL_MAP_SAMPLING
+ adc_reset_map_value_cycavg(); //values sampled for old set of cylinders are not valid anymore
+#endif
+
  if (CHECKBIT(flags2, F_SINGCH))
  { //single channel
   set_channels_sc();
@@ -979,6 +1084,9 @@ void ckps_use_cam_ref_s(uint8_t i_camref)
  */
 ISR(TIMER1_COMPA_vect)
 {
+#ifdef STROBOSCOPE
+ uint8_t strobe = 0;
+#endif
  TIMSK1&= ~_BV(OCIE1A); //disable this interrupt
 
  switch(QUEUE_TAIL(1).id) //what exactly happen?
@@ -1002,14 +1110,7 @@ ISR(TIMER1_COMPA_vect)
 
 #ifdef STROBOSCOPE
    if (0==QUEUE_TAIL(1).ch)
-   {
-    IOCFG_SET(IOP_STROBE, 1);  //start pulse
-    if (QUEUE_IS_EMPTY(1))
-    {
-     SET_T1COMPA(TCNT1, STROBE_PW); //strobe pulse is 100uS by default
-    }
-    QUEUE_ADD(1, TCNT1, STROBE_PW, QID_STROBE, 0);
-   }
+    strobe = 1;                //pulse will be started after processing of the queue
 #endif
    break;
   }
@@ -1031,7 +1132,11 @@ ISR(TIMER1_COMPA_vect)
   }
 
   case QID_MEASURE:
+#ifdef CYL_MAP_SAMPLING
+   adc_begin_measure_cyl(_AB(ckps.stroke_period, 1) < 4, ckps.smp_chan);//MAP will be remembered for this cylinder
+#else
    adc_begin_measure(_AB(ckps.stroke_period, 1) < 4);//start the process of measuring analog input values
+#endif
    break;
 
   case QID_KNKBEG:
@@ -1067,6 +1172,21 @@ ISR(TIMER1_COMPA_vect)
  //Remove already processed event from queue. After that, if queue is not empty, then start
  //next event in chain. Also, prevent effects when event already expired.
  QUEUE_REMOVE(1);
+#ifdef STROBOSCOPE
+ //Strobe pulse is put in front of the queue only if it ends before the next pending event, otherwise it is dropped.
+ //Events added later and firing before end of the pulse will finish it (see QUEUE_CUT_STROBE1)
+ if (strobe)
+ {
+  uint16_t end_time = TCNT1 + STROBE_PW; //strobe pulse is 100uS by default
+  if (QUEUE_IS_EMPTY(1) || (QUEUE_FREE(1) && ((int16_t)(QUEUE_TAIL(1).end_time - end_time)) > 0))
+  {
+   QUEUE_PUSH_TAIL(1);
+   QUEUE_TAIL(1).end_time = end_time;
+   QUEUE_TAIL(1).id = QID_STROBE;
+   IOCFG_SET(IOP_STROBE, 1);  //start pulse
+  }
+ }
+#endif
  if (!QUEUE_IS_EMPTY(1))
  {
   uint16_t t = (QUEUE_TAIL(1).end_time-(uint16_t)2) - TCNT1;
@@ -1270,6 +1390,9 @@ static void process_ckps_cogs(void)
     SET_T1COMPA(ICR1, delay);
    }
    QUEUE_ADDF(1, ICR1, (uint16_t)delay, QID_MEASURE);
+#ifdef CYL_MAP_SAMPLING
+   ckps.smp_chan = i;  //remember cylinder for which sensors will be sampled
+#endif
   }
 
   if (CHECKBIT(flags, F_USEKNK))
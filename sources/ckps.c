@@ -36,6 +36,7 @@
 #include "ckps.h"
 #include "ioconfig.h"
 #include "injector.h"   //inject_start_inj()
+#include "isrprof.h"
 #include "magnitude.h"
 #include "tables.h"     //fnptr_t
 
@@ -105,6 +106,9 @@
 #define F_IGNIEN    7                 //!< Ignition enabled/disabled
 
 //Additional flags (see flags2 variable)
+#ifdef STROKE_SYNC_CALC
+ #define F_CALC      0                //!< Indicates that it is time to perform calculations (see fw_ex_data_t::calc_angle)
+#endif
 #if defined(PHASED_IGNITION) || (defined(PHASE_SENSOR) && defined(FUEL_INJECT))
  #define F_CAMISS    1                //!< Indicates that system has already obtained event from a cam sensor
 #endif
@@ -150,6 +154,7 @@ typedef struct
  volatile uint16_t degrees_per_chan;  //!< number of degrees per one channel (degrees between two spark events)
  volatile uint8_t eq_tail1;           //!< event queue tail (index in a static array)
  volatile uint8_t eq_head1;           //!< event queue head (index), queue is empty if head = tail
+ volatile uint16_t eq_overruns;       //!< number of overruns of the event queue (events were dropped or evicted)
 #endif
 #ifdef HALL_OUTPUT
  int8_t   hop_offset;                 //!< Hall output: start of pulse in teeth of wheel relatively to TDC
@@ -170,8 +175,15 @@ typedef struct
   * latching of settings into HIP9011
   */
  volatile uint8_t  wheel_latch_btdc;
+#ifdef CYL_MAP_SAMPLING
+ volatile uint8_t  wheel_smp_btdc;    //!< Number of teeth before TDC which determines moment of sampling of sensors (see fw_ex_data_t::smp_angle)
+#endif
+#ifdef STROKE_SYNC_CALC
+ volatile uint8_t  wheel_calc_btdc;   //!< Number of teeth before TDC which determines moment of starting of calculations (see fw_ex_data_t::calc_angle)
+#endif
  volatile uint16_t degrees_per_cog;   //!< Number of degrees which corresponds to the 1 tooth
  volatile uint16_t degrees_per_cog_r; //!< Reciprocal of the degrees_per_cog, value * 65536
+ volatile uint16_t period_dsc;        //!< Time of 1 discrete of angle in ticks of timer 1, value * 256. Updated on each tooth
  volatile uint16_t cogs_per_chan;     //!< Number of teeth per 1 ignition channel (it is fractional number * 256)
  volatile int16_t start_angle;        //!< Precalculated value of the advance angle at 66 (at least) BTDC
 #ifdef STROBOSCOPE
@@ -223,6 +235,14 @@ typedef struct
 
  /** Determines number of tooth (relatively to TDC) at which "latching" of data is performed */
  volatile uint16_t cogs_latch;
+#ifdef CYL_MAP_SAMPLING
+ /** Determines number of tooth (relatively to TDC) at which measurement of sensors is started */
+ volatile uint16_t cogs_smp;
+#endif
+#ifdef STROKE_SYNC_CALC
+ /** Determines number of tooth (relatively to TDC) at which calculations are started */
+ volatile uint16_t cogs_calc;
+#endif
  /** Determines number of tooth at which measurement of rotation period is performed */
  volatile uint16_t cogs_btdc;
  /** Determines number of tooth at which phase selection window for knock detection is opened */
@@ -250,8 +270,13 @@ PGM_DECLARE(uint32_t frq_calc_dividend[1+IGN_CHANNELS_MAX]) =
 
 #define DWL_DEAD_TIME 156        //!< 500uS dead time
 
-/**Maximum queue size for ignition events, MUST BE power of two (2,4,8 etc) */
-#define IGN_QUEUE_SIZE 4
+/**Maximum queue size for ignition events, MUST BE power of two (2,4,8 etc). Can be overridden from the command line */
+#ifndef IGN_QUEUE_SIZE
+ #define IGN_QUEUE_SIZE 8
+#endif
+#if (IGN_QUEUE_SIZE < 4) || (IGN_QUEUE_SIZE > 128) || (IGN_QUEUE_SIZE & (IGN_QUEUE_SIZE-1))
+ #error "IGN_QUEUE_SIZE must be power of two in range 4...128"
+#endif
 
 #define QID_DWELL  0             //!< start dwell
 #define QID_SPARK  1             //!< finish dwell (spark)
@@ -275,33 +300,99 @@ ign_queue_t ign_eq2[IGN_QUEUE_SIZE];
 /** Reset specified queue (makes it empty) */
 #define QUEUE_RESET(q)  ckps.eq_tail##q = ckps.eq_head##q = 0;
 
-/** Add event into the queue (add to head)
+/** Add event into the queue (add to head). If event must fire before end of the strobe pulse, then it takes
+ * place of the pulse (see QUEUE_CUT_STROBE1). Queue may become full only if compare channel missed its events,
+ * in this case overrun is counted and new event is dropped, except spark (see queue_overrun()).
  * r Timer's register (TCNT1 or ICR1)
  * time Time in tics of timer 1 after which event should fire
  * aid ID of pending action, which shold be performed
  */
 #define QUEUE_ADD(q, r, time, aid) \
-    ign_eq##q[ckps.eq_head##q].end_time = (r) + (time); \
-    ign_eq##q[ckps.eq_head##q].id = (aid); \
-    ckps.eq_head##q = (ckps.eq_head##q + 1) & (IGN_QUEUE_SIZE-1);
+    if (QUEUE_CUT_STROBE##q(r, time)) { \
+     QUEUE_TAIL(q).end_time = (r) + (time); \
+     QUEUE_TAIL(q).id = (aid); \
+     QUEUE_START##q(r, time); \
+    } \
+    else if (QUEUE_FREE(q) || queue_overrun(ign_eq##q, ckps.eq_tail##q, &ckps.eq_head##q, (aid))) { \
+     ign_eq##q[ckps.eq_head##q].end_time = (r) + (time); \
+     ign_eq##q[ckps.eq_head##q].id = (aid); \
+     ckps.eq_head##q = (ckps.eq_head##q + 1) & (IGN_QUEUE_SIZE-1); \
+    }
 
 /** Remove event from the queue (remove from tail)*/
 #define QUEUE_REMOVE(q) ckps.eq_tail##q = (ckps.eq_tail##q + 1) & (IGN_QUEUE_SIZE-1)
 
+/** Insert entry in front of the queue (before tail), it will be processed first. Queue must not be full */
+#define QUEUE_PUSH_TAIL(q) ckps.eq_tail##q = (ckps.eq_tail##q - 1) & (IGN_QUEUE_SIZE-1)
+
 /** Get tail item value from queue */
 #define QUEUE_TAIL(q) ign_eq##q[ckps.eq_tail##q]
 
 /** Test is queue empty */
 #define QUEUE_IS_EMPTY(q) (ckps.eq_head##q==ckps.eq_tail##q)
 
+/** Get number of free entries in the queue */
+#define QUEUE_FREE(q) ((ckps.eq_tail##q - ckps.eq_head##q - 1) & (IGN_QUEUE_SIZE-1))
+
+#ifdef STROBOSCOPE
+/** Strobe pulse must never delay ignition events. If new event must fire before end of the strobe pulse
+ * (pulse can be only in the tail of queue 1), then pulse is finished right now.
+ * \return 1 if pulse has been finished, so new event should take its place */
+#define QUEUE_CUT_STROBE1(r, time) (!QUEUE_IS_EMPTY(1) && QID_STROBE == QUEUE_TAIL(1).id && \
+    ((int16_t)(((r) + (time)) - QUEUE_TAIL(1).end_time)) < 0 && (IOCFG_SET(IOP_STROBE, 0), 1))
+#else
+#define QUEUE_CUT_STROBE1(r, time) 0
+#endif
+#define QUEUE_CUT_STROBE2(r, time) 0 //!< there is no strobe pulse in the queue 2
+
+/** Called when event is being added into the full queue, counts overrun (saturated). Spark is never dropped,
+ * because dwell of its coil may be already started, instead it takes place of the latest pending dwell event
+ * (that coil will not be charged). Tail entry is never removed, because it is already programmed into compare channel.
+ * \param eq Pointer to the queue
+ * \param tail Index of the tail entry
+ * \param p_head Pointer to index of the head entry, it is moved back if entry has been removed
+ * \param aid ID of the new event
+ * \return 1 if entry has been removed and new event can be added, 0 if new event must be dropped
+ */
+static uint8_t queue_overrun(ign_queue_t* eq, uint8_t tail, volatile uint8_t* p_head, uint8_t aid)
+{
+ uint8_t i = *p_head, j;
+ if (ckps.eq_overruns != 65535)
+  ++ckps.eq_overruns;
+ if (QID_SPARK != aid)
+  return 0;
+ while((i = (i - 1) & (IGN_QUEUE_SIZE-1)) != tail)
+ {
+  if (QID_DWELL == eq[i].id
+#ifdef STROBOSCOPE
+      || QID_STROBE == eq[i].id
+#endif
+     )
+  {
+   for(j = (i + 1) & (IGN_QUEUE_SIZE-1); j != *p_head; i = j, j = (j + 1) & (IGN_QUEUE_SIZE-1))
+    eq[i] = eq[j];                    //shift later events to fill the gap
+   *p_head = i;
+   return 1;
+  }
+ }
+ return 0;                            //there are only sparks (IGN_QUEUE_SIZE must be greater than number of channels)
+}
+
+/** Start compare channel of the specified queue (used when event takes place of the strobe pulse) */
+#define QUEUE_START1(r, v) SET_T1COMPA(r, v)
+#define QUEUE_START2(r, v) SET_T3COMPA(r, v)
+
 #endif //DWELL_CONTROL
 
-/**Set T1 COMPA channel of timer
+/**Set T1 COMPA channel of timer. If time of event already passed (e.g. event is scheduled at the captured
+ * tooth with zero delay), then it fires as soon as possible, otherwise it would fire only after overflow of timer
  * r Timer's register (TCNT1 or ICR1)
  * v Time in tics of timer 1 after which event should fire
  */
 #define SET_T1COMPA(r, v) \
      OCR1A = (r) + (v); \
+     if (((int16_t)(OCR1A - TCNT1)) < 2) \
+      OCR1A = TCNT1 + 2; \
      TIFR1 = _BV(OCF1A); \
      SETBIT(TIMSK1, OCIE1A);
 
@@ -323,6 +414,8 @@ ign_queue_t ign_eq2[IGN_QUEUE_SIZE];
  */
 #define SET_T3COMPA(r, v) \
      OCR3A = (r) + (v); \
+     if (((int16_t)(OCR3A - TCNT3)) < 2) \
+      OCR3A = TCNT3 + 2; \
      TIFR3 = _BV(OCF3A); \
      SETBIT(TIMSK3, OCIE3A);
 #endif
@@ -346,8 +439,10 @@ void ckps_init_state_variables(void)
 #ifdef SPLIT_ANGLE
  CLEARBIT(flags2, F_PNDDWL1);
 #endif
+ TIMSK1&= ~_BV(OCIE1A); //pending event must not fire when queue is already empty
  QUEUE_RESET(1);
 #ifdef SPLIT_ANGLE
+ TIMSK3&= ~_BV(OCIE3A);
  QUEUE_RESET(2);
 #endif
 #endif
@@ -374,6 +469,9 @@ void ckps_init_state_variables(void)
  CLEARBIT(flags, F_ISSYNC);
  SETBIT(flags, F_IGNIEN);
  CLEARBIT(flags2, F_SPSIGN);
+#ifdef STROKE_SYNC_CALC
+ CLEARBIT(flags2, F_CALC);
+#endif
 #ifdef FUEL_INJECT
  ckps.inj_chidx = 0;
  {
@@ -392,6 +490,9 @@ void ckps_init_state_variables(void)
  ckps.t1oc = 0;                       //reset overflow counter
  ckps.t1oc_s = 255;                   //RPM is very low
  _END_ATOMIC_BLOCK();
+#ifdef CYL_MAP_SAMPLING
+ adc_reset_map_value_cycavg();        //engine is stopped, MAP values sampled in the last cycle are stale
+#endif
 }
 
 void ckps_init_state(void)
@@ -557,6 +658,12 @@ void ckps_set_cogs_btdc(uint8_t cogs_btdc)
   chanstate[i+SPLIT_OFFSET].cogs_btdc = _normalize_tn(tdc);
 #endif
   chanstate[i].cogs_latch = _normalize_tn(tdc - ckps.wheel_latch_btdc);
+#ifdef CYL_MAP_SAMPLING
+  chanstate[i].cogs_smp = _normalize_tn(tdc - ckps.wheel_smp_btdc);
+#endif
+#ifdef STROKE_SYNC_CALC
+  chanstate[i].cogs_calc = _normalize_tn(tdc - ckps.wheel_calc_btdc);
+#endif
   chanstate[i].knock_wnd_begin = _normalize_tn(tdc + ckps.knock_wnd_begin_abs);
   chanstate[i].knock_wnd_end = _normalize_tn(tdc + ckps.knock_wnd_end_abs);
 #ifdef HALL_OUTPUT
@@ -615,6 +722,17 @@ void ckps_reset_error(void)
  CLEARBIT(flags, F_ERROR);
 }
 
+#ifdef DWELL_CONTROL
+uint16_t ckps_get_eq_overruns(void)
+{
+ uint16_t eq_overruns;
+ _BEGIN_ATOMIC_BLOCK();
+ eq_overruns = ckps.eq_overruns;
+ _END_ATOMIC_BLOCK();
+ return eq_overruns;
+}
+#endif
+
 void ckps_use_knock_channel(uint8_t use_knock_channel)
 {
  WRITEBIT(flags, F_USEKNK, use_knock_channel);
@@ -630,6 +748,18 @@ uint8_t ckps_is_stroke_event_r()
  return result;
 }
 
+#ifdef STROKE_SYNC_CALC
+uint8_t ckps_is_calc_event_r(void)
+{
+ uint8_t result;
+ _BEGIN_ATOMIC_BLOCK();
+ result = CHECKBIT(flags2, F_CALC) > 0;
+ CLEARBIT(flags2, F_CALC);
+ _END_ATOMIC_BLOCK();
+ return result;
+}
+#endif
+
 uint8_t ckps_is_cog_changed(void)
 {
  static uint8_t prev_cog = 0;
@@ -747,6 +877,10 @@ void ckps_set_cyl_number(uint8_t i_cyl_number)
 
  ckps.frq_calc_dividend = FRQ_CALC_DIVIDEND(i_cyl_number);
 
+#ifdef CYL_MAP_SAMPLING
+ adc_reset_map_value_cycavg(); //values sampled for old set of cylinders are not valid anymore
+#endif
+
  if (CHECKBIT(flags2, F_SINGCH))
  { //single channel
   set_channels_sc();
@@ -865,6 +999,15 @@ void ckps_set_cogs_num(uint8_t norm_num, uint8_t miss_num)
  //precalculate value and round it always to the upper bound,
  //e.g. for 60-2 crank wheel result = 11 (66), for 36-1 crank wheel result = 7 (70)
  dr = div(ANGLE_MAGNITUDE(66), degrees_per_cog);
+#ifdef CYL_MAP_SAMPLING
+ //number of teeth before TDC at which sensors are sampled, rounded to the nearest tooth
+ uint8_t smp_btdc = (PGM_GET_WORD(&fw_data.exdata.smp_angle) + (degrees_per_cog >> 1)) / degrees_per_cog;
+#endif
+#ifdef STROKE_SYNC_CALC
+ //number of teeth before TDC at which calculations are started: latch tooth plus calc_angle rounded to the upper bound,
+ //so results are always ready before latching
+ uint8_t calc_btdc = (dr.quot + (dr.rem > 0)) + ((PGM_GET_WORD(&fw_data.exdata.calc_angle) + degrees_per_cog - 1) / degrees_per_cog);
+#endif
 
  _t=_SAVE_INTERRUPT();
  _DISABLE_INTERRUPT();
@@ -879,6 +1022,12 @@ void ckps_set_cogs_num(uint8_t norm_num, uint8_t miss_num)
  ckps.wheel_cogs_num2p1 = (norm_num * 2) + 1;
  //set other precalculated values
  ckps.wheel_latch_btdc = dr.quot + (dr.rem > 0);
+#ifdef CYL_MAP_SAMPLING
+ ckps.wheel_smp_btdc = smp_btdc;
+#endif
+#ifdef STROKE_SYNC_CALC
+ ckps.wheel_calc_btdc = calc_btdc;
+#endif
  ckps.degrees_per_cog = degrees_per_cog;
  ckps.degrees_per_cog_r = degrees_per_cog_r; //reciprocal of the degrees_per_cog
 #ifdef DWELL_CONTROL
@@ -903,13 +1052,13 @@ void ckps_set_inj_timing(int16_t phase, uint16_t pw, uint8_t mode)
  //Apply selected injection pulse option: begin of squirt, middle of squirt or end of squirt
  if (mode > INJANGLESPEC_BEGIN)
  {
-  uint16_t period_curr;
+  uint16_t period_dsc;
   _BEGIN_ATOMIC_BLOCK();
-  period_curr = ckps.period_curr;
+  period_dsc = ckps.period_dsc;
   _END_ATOMIC_BLOCK();
 
   //convert delay to angle (value * ANGLE_MULTIPLIER). TODO: how to escape from slow division?
-  uint16_t pw_angle = (((uint32_t)pw) * ckps.degrees_per_cog) / period_curr;
+  uint16_t pw_angle = period_dsc ? ((((uint32_t)pw) << 8) / period_dsc) : 0;
   if (mode == INJANGLESPEC_MIDDLE)
    pw_angle>>= 1;
   //apply, rotate angle if need
@@ -962,6 +1111,10 @@ static inline void turn_off_ignition_channel(uint8_t i_channel)
  */
 ISR(TIMER1_COMPA_vect)
 {
+#if defined(DWELL_CONTROL) && defined(STROBOSCOPE)
+ uint8_t strobe = 0;
+#endif
+ ISRPROF_ENTER();
  TIMSK1&= ~_BV(OCIE1A); //disable this interrupt
 
 #ifdef DWELL_CONTROL
@@ -974,6 +1127,7 @@ ISR(TIMER1_COMPA_vect)
 
   case QID_SPARK:
   {
+   ISRPROF_LATENCY(IPC_SPARK_ERR, QUEUE_TAIL(1).end_time);
    //line of port in the low level, now set it into a high level - makes the transistor to close and coil to stop 
    //the accumulation of energy (spark)
    ((iocfg_pfn_set)chanstate[ckps.channel_mode].io_callback1)(IGNOUTCB_ON_VAL);
@@ -984,12 +1138,7 @@ ISR(TIMER1_COMPA_vect)
 #ifdef STROBOSCOPE
    if (1==ckps.strobe)
    {
-    IOCFG_SET(IOP_STROBE, 1);  //start pulse
-    if (QUEUE_IS_EMPTY(1))
-    {
-     SET_T1COMPA(TCNT1, STROBE_PW); //strobe pulse is 100uS by default
-    }
-    QUEUE_ADD(1, TCNT1, STROBE_PW, QID_STROBE);
+    strobe = 1;                //pulse will be started after processing of the queue
     ckps.strobe = 0;           //and reset flag
    }
 #endif
@@ -1038,6 +1187,21 @@ ISR(TIMER1_COMPA_vect)
  //Remove already processed event from queue. After that, is queue is not empty, then start
  //next event in chain. Also, prevent effects when event already expired.
  QUEUE_REMOVE(1);
+#ifdef STROBOSCOPE
+ //Strobe pulse is put in front of the queue only if it ends before the next pending event, otherwise it is dropped.
+ //Events added later and firing before end of the pulse will finish it (see QUEUE_CUT_STROBE1)
+ if (strobe)
+ {
+  uint16_t end_time = TCNT1 + STROBE_PW; //strobe pulse is 100uS by default
+  if (QUEUE_IS_EMPTY(1) || (QUEUE_FREE(1) && ((int16_t)(QUEUE_TAIL(1).end_time - end_time)) > 0))
+  {
+   QUEUE_PUSH_TAIL(1);
+   QUEUE_TAIL(1).end_time = end_time;
+   QUEUE_TAIL(1).id = QID_STROBE;
+   IOCFG_SET(IOP_STROBE, 1);  //start pulse
+  }
+ }
+#endif
  if (!QUEUE_IS_EMPTY(1))
  {
   uint16_t t = (QUEUE_TAIL(1).end_time-(uint16_t)2) - TCNT1;
@@ -1063,6 +1227,7 @@ ISR(TIMER1_COMPA_vect)
  }
 #endif
 
+ ISRPROF_LATENCY(IPC_SPARK_ERR, OCR1A);
  //line of port in the low level, now set it into a high level - makes the igniter to stop 
  //the accumulation of energy and close the transistor (spark)
  ((iocfg_pfn_set)chanstate[ckps.channel_mode].io_callback1)(IGNOUTCB_ON_VAL);
@@ -1078,6 +1243,7 @@ ISR(TIMER1_COMPA_vect)
 /** Timer 3 compare interrupt A - used for second ignition channels (angle splitting for rotary engines)*/
 ISR(TIMER3_COMPA_vect)
 {
+ ISRPROF_ENTER(); //note: we rely that timers 1 and 3 are synchronized!
  TIMSK3&= ~_BV(OCIE3A); //disable this interrupt
 
 #ifdef DWELL_CONTROL
@@ -1090,6 +1256,7 @@ ISR(TIMER3_COMPA_vect)
 
   case QID_SPARK:
   {
+   ISRPROF_LATENCY(IPC_SPARK_ERR, QUEUE_TAIL(2).end_time);
    //line of port in the low level, now set it into a high level - makes the transistor to close and coil to stop 
    //the accumulation of energy (spark)
    ((iocfg_pfn_set)chanstate[ckps.channel_mode1].io_callback1)(IGNOUTCB_ON_VAL);
@@ -1147,6 +1314,7 @@ ISR(TIMER3_COMPA_vect)
 
 #else //just use trigger wheel teeth instead of dwell control
 
+ ISRPROF_LATENCY(IPC_SPARK_ERR, OCR3A);
  //line of port in the low level, now set it into a high level - makes the igniter to stop 
  //the accumulation of energy and close the transistor (spark)
  ((iocfg_pfn_set)chanstate[ckps.channel_mode1].io_callback1)(IGNOUTCB_ON_VAL);
@@ -1255,18 +1423,29 @@ static uint8_t sync_at_startup(void)
  return 0; //continue process of synchronization
 }
 
+/**Calculates time of 1 discrete of angle from period of the current tooth. It is done once per tooth,
+ * thus all conversions of angle to time below require only one 16x16 multiplication
+ */
+static void calc_period_dsc(void)
+{
+ uint32_t pd = ((((uint32_t)ckps.period_curr) * ckps.degrees_per_cog_r) + 128) >> 8;
+ ckps.period_dsc = (pd > 65535) ? 65535 : pd; //saturate at very low RPM
+}
+
 /**This procedure called for all teeth (including recovered teeth)
  */
 static void process_ckps_cogs(void)
 {
  uint8_t i;
 
+ calc_period_dsc();
+
 #ifdef DWELL_CONTROL
  if (CHECKBIT(flags, F_PNDDWL) && !ckps.rising_edge_spark)
  {
   //calculate delay between current tooth and next spark
-  int32_t angle_to_spark = (((int32_t)_normalize_tn(chanstate[ckps.channel_mode_b].cogs_btdc - ckps.cog)) * ckps.degrees_per_cog) - ckps.advance_angle;
-  int32_t delay =  (angle_to_spark * (((int32_t)ckps.period_curr * ckps.degrees_per_cog_r) >> 10)) >> 6; //convert angle to delay
+  int16_t angle_to_spark = (_normalize_tn(chanstate[ckps.channel_mode_b].cogs_btdc - ckps.cog) * ckps.degrees_per_cog) - ckps.advance_angle;
+  int32_t delay = (((int32_t)angle_to_spark) * ckps.period_dsc) >> 8; //convert angle to delay
   delay-= ckps.cr_acc_time;    //apply dwell time
 
   if (delay < (ckps.period_curr<<1))
@@ -1286,8 +1465,8 @@ static void process_ckps_cogs(void)
  if (CHECKBIT(flags2, F_PNDDWL1) && !ckps.rising_edge_spark)
  {
   //calculate delay between current tooth and next spark
-  int32_t angle_to_spark = (((int32_t)_normalize_tn(chanstate[ckps.channel_mode_b1].cogs_btdc - ckps.cog)) * ckps.degrees_per_cog) - ckps.advance_angle1;
-  int32_t delay =  (angle_to_spark * (((int32_t)ckps.period_curr * ckps.degrees_per_cog_r) >> 10)) >> 6; //convert angle to delay
+  int16_t angle_to_spark = (_normalize_tn(chanstate[ckps.channel_mode_b1].cogs_btdc - ckps.cog) * ckps.degrees_per_cog) - ckps.advance_angle1;
+  int32_t delay = (((int32_t)angle_to_spark) * ckps.period_dsc) >> 8; //convert angle to delay
   delay-= ckps.cr_acc_time;    //apply dwell time
 
   if (delay < (ckps.period_curr<<1))
@@ -1343,13 +1522,27 @@ static void process_ckps_cogs(void)
 #ifdef SPLIT_ANGLE
    ckps.advance_angle1 = ckps.advance_angle_buffered1; //advance angle with all the adjustments (say, 15)
 #endif
+#ifndef CYL_MAP_SAMPLING
    adc_begin_measure(_AB(ckps.stroke_period, 1) < 4);//start the process of measuring analog input values
+#endif
 #ifdef STROBOSCOPE
    if (0==i)
     ckps.strobe = 1; //strobe!
 #endif
   }
 
+#ifdef STROKE_SYNC_CALC
+  //it is time to calculate new advance angle and inj. PW for this cylinder
+  if (ckps.cog == chanstate[i].cogs_calc)
+   SETBIT(flags2, F_CALC);
+#endif
+
+#ifdef CYL_MAP_SAMPLING
+  //start the process of measuring analog input values at the specified crank angle, MAP will be remembered for this cylinder
+  if (ckps.cog == chanstate[i].cogs_smp)
+   adc_begin_measure_cyl(_AB(ckps.stroke_period, 1) < 4, i);
+#endif
+
   //teeth of end/beginning of the measurement of rotation period - TDC Read and save the measured period,
   //then remember current value of count for the next measurement
   if (ckps.cog==chanstate[i].cogs_btdc)
@@ -1382,7 +1575,7 @@ static void process_ckps_cogs(void)
     if (diff <= (ckps.degrees_per_cog << 1))
     {
      ckps.inj_chidx = i;  //remember number of channel to be fired
-     uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPB_VECT_DELAY;
+     uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPB_VECT_DELAY;
      SET_T1COMPB(ICR1, delay);
      sync_inj_angle();
      chanstate[i].inj_skipth = 4;  //skip 4 teeth
@@ -1399,7 +1592,7 @@ static void process_ckps_cogs(void)
   uint16_t diff = ckps.current_angle - ckps.advance_angle;
   if (diff <= (ckps.degrees_per_cog << 1))
   {
-   uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPA_VECT_DELAY;
+   uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPA_VECT_DELAY;
 #ifdef DWELL_CONTROL
    //before starting the ignition it is left to count less than 2 teeth. It is necessary to prepare the compare module
    if (QUEUE_IS_EMPTY(1))
@@ -1421,7 +1614,7 @@ static void process_ckps_cogs(void)
   uint16_t diff = ckps.current_angle - ckps.advance_angle1;
   if (diff <= (ckps.degrees_per_cog << 1))
   {
-   uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPA_VECT_DELAY;
+   uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPA_VECT_DELAY;
 #ifdef DWELL_CONTROL
    //before starting the ignition it is left to count less than 2 teeth. It is necessary to prepare the compare module
    if (QUEUE_IS_EMPTY(2))
@@ -1516,6 +1709,8 @@ static void process_ckps_cogs(void)
  */
 ISR(TIMER1_CAPT_vect)
 {
+ ISRPROF_ENTER();
+ ISRPROF_LATENCY(IPC_CKPS_LAT, ICR1);
  ckps.period_curr = ICR1 - ckps.icr_prev;
 
  //At the start of engine, skipping a certain number of teeth for initializing
@@ -1535,6 +1730,7 @@ ISR(TIMER1_CAPT_vect)
 #endif
    goto sync_enter;
   }
+  ISRPROF_LEAVE(IPC_CKPS_DUR);
   return;
  }
 
@@ -1592,6 +1788,7 @@ sync_enter:
 
  ckps.icr_prev = ICR1;
  ckps.period_prev = ckps.period_curr;
+ ISRPROF_LEAVE(IPC_CKPS_DUR);
 }
 
 /**Purpose of this interrupt handler is to supplement timer up to 16 bits and call procedure
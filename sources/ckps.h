@@ -34,6 +34,12 @@
  */
 #define ANGLE_MULTIPLIER   32
 
+#ifdef CYL_MAP_SAMPLING
+#if defined(HALL_SYNC) || defined(CKPS_2CHIGN) || defined(CKPS_NPLUS1) || defined(CAM_SYNC)
+ #error "CYL_MAP_SAMPLING option is supported only by the decoders of toothed wheel (ckps.c, ckps-odd.c)"
+#endif
+#endif
+
 /**Initialization of CKP module (hardware & variables)
  */
 void ckps_init_state(void);
@@ -102,11 +108,28 @@ uint8_t ckps_is_error(void);
 /** Reset detected errors */
 void ckps_reset_error(void);
 
+#ifdef DWELL_CONTROL
+/** \return number of overruns of the ignition event queue since start, pending events are dropped
+ * on each overrun (saturated at 65535) */
+uint16_t ckps_get_eq_overruns(void);
+#endif
+
 /**\return 1 if there was engine stroke and reset flag!
  * \details Used to perform synchronization with rotation of crankshaft.
  */
 uint8_t ckps_is_stroke_event_r(void);
 
+#ifdef STROKE_SYNC_CALC
+#if defined(HALL_SYNC) || defined(CKPS_2CHIGN) || defined(CKPS_NPLUS1) || defined(CAM_SYNC) || defined(ODDFIRE_ALGO)
+ #error "STROKE_SYNC_CALC option is supported only by the decoder of toothed wheel (ckps.c)"
+#endif
+/**\return 1 if crankshaft has reached the point at which calculations must be started (fw_ex_data_t::calc_angle
+ * before latching of ignition timing) and reset flag!
+ * \details Used to perform calculations of ignition timing and inj. PW once per engine stroke.
+ */
+uint8_t ckps_is_calc_event_r(void);
+#endif
+
 /** Initialization of state variables */
 void ckps_init_state_variables(void);
 
@@ -166,6 +166,7 @@ typedef struct
  volatile uint8_t  wheel_latch_btdc;
  volatile uint16_t degrees_per_cog;   //!< Number of degrees which corresponds to the 1 tooth
  volatile uint16_t degrees_per_cog_r; //!< Reciprocal of the degrees_per_cog, value * 65536
+ volatile uint16_t period_dsc;        //!< Time of 1 discrete of angle in ticks of timer 1, value * 256. Updated on each tooth
  volatile uint16_t cogs_per_chan;     //!< Number of teeth per 1 ignition channel (it is fractional number * 256)
  volatile int16_t start_angle;        //!< Precalculated value of the advance angle at 66 (at least) BTDC
 #ifdef STROBOSCOPE
@@ -720,13 +721,13 @@ void ckps_set_inj_timing(int16_t phase, uint16_t pw, uint8_t mode)
  //Apply selected injection pulse option: begin of squirt, middle of squirt or end of squirt
  if (mode > INJANGLESPEC_BEGIN)
  {
-  uint16_t period_curr;
+  uint16_t period_dsc;
   _BEGIN_ATOMIC_BLOCK();
-  period_curr = ckps.period_curr;
+  period_dsc = ckps.period_dsc;
   _END_ATOMIC_BLOCK();
 
   //convert delay to angle (value * ANGLE_MULTIPLIER). TODO: how to escape from slow division?
-  uint16_t pw_angle = (((uint32_t)pw) * ckps.degrees_per_cog) / period_curr;
+  uint16_t pw_angle = period_dsc ? ((((uint32_t)pw) << 8) / period_dsc) : 0;
   if (mode == INJANGLESPEC_MIDDLE)
    pw_angle>>= 1;
   //apply, rotate angle if need
@@ -919,12 +920,23 @@ static uint8_t sync_at_startup(void)
  return 0; //continue process of synchronization
 }
 
+/**Calculates time of 1 discrete of angle from period of the current tooth. It is done once per tooth,
+ * thus all conversions of angle to time below require only one 16x16 multiplication
+ */
+static void calc_period_dsc(void)
+{
+ uint32_t pd = ((((uint32_t)ckps.period_curr) * ckps.degrees_per_cog_r) + 128) >> 8;
+ ckps.period_dsc = (pd > 65535) ? 65535 : pd; //saturate at very low RPM
+}
+
 /**This procedure called for all teeth (including recovered teeth)
  */
 static void process_ckps_cogs(void)
 {
  uint8_t i;
 
+ calc_period_dsc();
+
  force_pending_spark();
 
  for(i = 0; i < ckps.chan_number; ++i)
@@ -1004,7 +1016,7 @@ static void process_ckps_cogs(void)
    if (diff <= (ckps.degrees_per_cog << 1))
    {
     ckps.inj_chidx = i;  //remember number of channel to be fired
-    uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPB_VECT_DELAY;
+    uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPB_VECT_DELAY;
     SET_T1COMPB(ICR1, delay);
     sync_inj_angle();
     chanstate[i].inj_skipth = 4;  //skip 4 teeth
@@ -1024,7 +1036,7 @@ static void process_ckps_cogs(void)
   if (diff <= (ckps.degrees_per_cog << 1))
   {
    //before starting the ignition it is left to count less than 2 teeth. It is necessary to prepare the compare module
-   uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPA_VECT_DELAY;
+   uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPA_VECT_DELAY;
    SET_T1COMPA(ICR1, delay);
    CLEARBIT(flags, F_NTSCHA); // For avoiding to enter into setup mode
    SETBIT(flags2, F_CALTIM);  // Set indication that we begin to calculate the time
@@ -1039,7 +1051,7 @@ static void process_ckps_cogs(void)
   if (diff <= (ckps.degrees_per_cog << 1))
   {
    //before starting the ignition it is left to count less than 2 teeth. It is necessary to prepare the compare module
-   uint16_t delay = ((((uint32_t)diff * (ckps.period_curr)) * ckps.degrees_per_cog_r) >> 16) - COMPA_VECT_DELAY;
+   uint16_t delay = ((((uint32_t)diff) * ckps.period_dsc) >> 8) - COMPA_VECT_DELAY;
    SET_T3COMPA(ICR1, delay);
    CLEARBIT(flags2, F_NTSCHA1); // For avoiding to enter into setup mode
    SETBIT(flags2, F_CALTIM1);  // Set indication that we begin to calculate the time
@@ -23,6 +23,9 @@
  * \author Alexey A. Shabelnikov
  * CRC16 related functions.
  * Functions for calculate CRC16 of data in RAM and in the ROM
+ * CRC16 is table driven (polynomial 0xA001, initial value 0xFFFF). By default table of 16 items
+ * (nibbles) is used, define CRC16_FAST option to use table of 256 items (bytes), which is faster
+ * but takes 480 bytes of ROM more.
  */
 
 #ifndef _CRC16_H_
@@ -31,6 +34,13 @@
 #include "port/pgmspace.h"
 #include <stdint.h>
 
+/** Updates CRC16 with one byte of data. All other CRC16 functions are based on this one
+ * \param crc Previous value of the CRC (0xFFFF for the first byte)
+ * \param data Byte of data
+ * \return updated value of the CRC
+ */
+uint16_t crc16_update(uint16_t crc, uint8_t data);
+
 /** Calculates CRC16 for a given block of data in RAM
  * \param buf Pointer to a block of data (RAM)
  * \param num Size of block to process in bytes
@@ -53,14 +63,12 @@ uint16_t crc16f(uint8_t _HPGM *buf, pgmsize_t num);
  */
 uint8_t update_crc8(uint8_t data, uint8_t crc);
 
-#ifdef DEFERRED_CRC
 /** Calculates and updates CRC16 for given block of data in ROM
- * \param crc Previous value of the CRC to be updated (or zero)
+ * \param crc Previous value of the CRC to be updated (or 0xFFFF)
  * \param buf Pointer to block of data (ROM)
  * \param num Size of block in bytes to be processed
  * \return updated value on the crc
  */
-uint16_t upd_crc16f(uint16_t crc, uint8_t _HPGM *buf, uint16_t num);
-#endif
+uint16_t upd_crc16f(uint16_t crc, uint8_t _HPGM *buf, pgmsize_t num);
 
 #endif //_CRC16_H_
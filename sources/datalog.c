@@ -0,0 +1,157 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file datalog.c
+ * \author Alexey A. Shabelnikov
+ * Implementation of the data logger.
+ */
+
+#ifdef DATA_LOGGER
+
+#include "port/port.h"
+#include <stddef.h>
+#include <stdint.h>
+#include "datalog.h"
+#include "ecudata.h"
+#include "vstimer.h"
+
+#define secu3_offsetof(type,member)   ((size_t)(&((type *)0)->member))
+
+/**Size of ring buffer. Indexes are 8-bit and wrap naturally, one byte is always left unused
+ * to distinguish full buffer from empty one */
+#define DLOG_BUFF_SIZE 256
+
+/**Define state variables */
+typedef struct
+{
+ uint8_t buff[DLOG_BUFF_SIZE];   //!< ring buffer of records
+ uint8_t wr;                     //!< write index
+ uint8_t rd;                     //!< read index
+ uint8_t recsize;                //!< size of one record in bytes (including sequence number), 0 - logger is off
+ uint8_t seq;                    //!< sequence number of the next sampled record
+ uint16_t t_last;                //!< value of system timer at the time of last sample
+}dlog_state_t;
+
+/**Global instance of logger's state variables */
+static dlog_state_t dlog;
+
+dlog_cfg_t dlog_cfg;
+
+void datalog_init(void)
+{
+ //default list: RPM, MAP, advance angle, knock level - sampled each engine stroke
+ dlog_cfg.period = 0;
+ dlog_cfg.chan[0].offset = secu3_offsetof(struct ecudata_t, sens.inst_frq);
+ dlog_cfg.chan[0].size = sizeof(d.sens.inst_frq);
+ dlog_cfg.chan[1].offset = secu3_offsetof(struct ecudata_t, sens.inst_map);
+ dlog_cfg.chan[1].size = sizeof(d.sens.inst_map);
+ dlog_cfg.chan[2].offset = secu3_offsetof(struct ecudata_t, corr.curr_angle);
+ dlog_cfg.chan[2].size = sizeof(d.corr.curr_angle);
+ dlog_cfg.chan[3].offset = secu3_offsetof(struct ecudata_t, sens.knock_k);
+ dlog_cfg.chan[3].size = sizeof(d.sens.knock_k);
+ datalog_apply_config();
+}
+
+void datalog_apply_config(void)
+{
+ uint8_t i;
+ dlog.recsize = 0;
+ for(i = 0; i < DLOG_MAX_CHANNELS; ++i)
+ {
+  dlog_chan_t* p_ch = &dlog_cfg.chan[i];
+  if ((p_ch->size != 1 && p_ch->size != 2 && p_ch->size != 4) || (p_ch->offset + p_ch->size) > sizeof(struct ecudata_t))
+   p_ch->size = 0; //wrong or unused channel
+  dlog.recsize+= p_ch->size;
+ }
+ if (dlog.recsize)
+  ++dlog.recsize; //sequence number
+ dlog.wr = dlog.rd = 0;
+ dlog.seq = 0;
+ dlog.t_last = s_timer_gtc();
+}
+
+/**Samples all channels and puts record (sequence number, values of channels) into the ring buffer.
+ * If there is no free space in the buffer, then record is dropped (receiver detects it by gap in
+ * sequence numbers) */
+static void take_sample(void)
+{
+ uint8_t i, j;
+ if (!dlog.recsize)
+  return; //logger is off
+
+ if ((uint8_t)(dlog.rd - dlog.wr - 1) >= dlog.recsize)
+ {
+  dlog.buff[dlog.wr++] = dlog.seq;
+  for(i = 0; i < DLOG_MAX_CHANNELS; ++i)
+  {
+   uint8_t* p = ((uint8_t*)&d) + dlog_cfg.chan[i].offset;
+   for(j = 0; j < dlog_cfg.chan[i].size; ++j)
+    dlog.buff[dlog.wr++] = p[j];
+  }
+ }
+ ++dlog.seq; //dropped records also get numbers
+}
+
+void datalog_stroke_event_notification(void)
+{
+ if (!dlog_cfg.period)
+  take_sample();
+}
+
+void datalog_process(void)
+{
+ uint16_t t = s_timer_gtc();
+ if (dlog_cfg.period && (uint16_t)(t - dlog.t_last) >= dlog_cfg.period)
+ {
+  dlog.t_last = t;
+  take_sample();
+ }
+}
+
+uint8_t datalog_is_block_ready(void)
+{
+ uint8_t used = dlog.wr - dlog.rd;
+ return dlog.recsize && used >= (DLOG_BLOCK_SIZE / dlog.recsize) * dlog.recsize;
+}
+
+uint8_t datalog_get_recsize(void)
+{
+ return dlog.recsize;
+}
+
+uint8_t datalog_begin_block(void)
+{
+ uint8_t num;
+ if (!dlog.recsize)
+  return 0;
+ num = (uint8_t)(dlog.wr - dlog.rd) / dlog.recsize;
+ if (num > (DLOG_BLOCK_SIZE / dlog.recsize))
+  num = DLOG_BLOCK_SIZE / dlog.recsize;
+ return num;
+}
+
+uint8_t datalog_read_byte(void)
+{
+ return dlog.buff[dlog.rd++];
+}
+
+#endif //DATA_LOGGER
@@ -0,0 +1,88 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file datalog.h
+ * \author Alexey A. Shabelnikov
+ * Data logger. Samples user-selected list of fields of the ecudata_t structure (channels, set by
+ * offset and size) into the ring buffer, once per engine stroke or with specified period. Contents
+ * of the ring buffer are sent out via UART as blocks of records (packet DLOGBL_DAT), list of channels
+ * is set by the DLOGCF_PAR packet. Each record begins with 8-bit sequence number, so receiver can detect
+ * records lost because of ring buffer overflow.
+ */
+
+#ifndef _DATALOG_H_
+#define _DATALOG_H_
+
+#ifdef DATA_LOGGER
+
+#include <stdint.h>
+
+#define DLOG_MAX_CHANNELS  8     //!< maximum number of channels
+#define DLOG_BLOCK_SIZE    96    //!< maximum number of bytes of records in one block (DLOGBL_DAT packet)
+
+/**Describes one channel of the logger */
+typedef struct
+{
+ uint16_t offset;                //!< offset of the field in the ecudata_t structure
+ uint8_t size;                   //!< size of the field in bytes (1, 2 or 4), 0 - channel is not used
+}dlog_chan_t;
+
+/**Describes configuration of the logger */
+typedef struct
+{
+ uint8_t period;                 //!< sampling period in 10ms ticks, 0 - sample once per engine stroke
+ dlog_chan_t chan[DLOG_MAX_CHANNELS]; //!< list of channels
+}dlog_cfg_t;
+
+/**Configuration of the logger. Must be applied by calling of datalog_apply_config() after change */
+extern dlog_cfg_t dlog_cfg;
+
+/**Initialization of the logger (sets default list of channels) */
+void datalog_init(void);
+
+/**Validates configuration (see dlog_cfg), clears ring buffer and resets sequence number */
+void datalog_apply_config(void);
+
+/**Must be called from the main loop once per engine stroke */
+void datalog_stroke_event_notification(void);
+
+/**Must be called from the main loop, samples channels if logger works with period */
+void datalog_process(void);
+
+/**\return 1 - ring buffer contains enough records to fill entire block */
+uint8_t datalog_is_block_ready(void);
+
+/**\return size of one record in bytes (sequence number and values of channels), 0 - logger is off */
+uint8_t datalog_get_recsize(void);
+
+/**Begins reading of block of records from the ring buffer
+ * \return number of records in block (may be 0), then number of bytes equal to records * record size
+ * must be read using datalog_read_byte()
+ */
+uint8_t datalog_begin_block(void);
+
+/**Reads next byte of records from the ring buffer (see datalog_begin_block()) */
+uint8_t datalog_read_byte(void);
+
+#endif //DATA_LOGGER
+
+#endif //_DATALOG_H_
@@ -32,6 +32,7 @@
 #include "bitmask.h"
 #include "diagnost.h"
 #include "ecudata.h"
+#include "eeprom.h"
 #include "knock.h"
 #include "magnitude.h"
 #include "procuart.h"
@@ -401,8 +402,12 @@ void diagnost_process(void)
  //local loop
  while(1)
  {
+  //update virtual timers
+  s_timer_process();
   //check & execute suspended operations
   sop_execute_operations();
+  //compare data being saved with EEPROM, so only changed bytes will be written
+  eeprom_process();
   //process data being received and sent via serial port
   process_uart_interface();
 
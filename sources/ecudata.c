@@ -62,9 +62,7 @@ struct ecudata_t d =
                 {{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0}}, //AFR
                 {{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0}}, //Timing
                 {0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0},{0}},
- .mm_ptr8 = 0,
- .mm_ptr16 = 0,
- .mm_ptr12 = 0,
+ .mm_ram = 0,
 #endif
  .fn_dat = 0,
 
@@ -127,24 +125,13 @@ struct ecudata_t d =
 ,.gasval_on = 0
 ,.gasval_res = 0
 #endif
+#ifdef DEFERRED_CRC
+,.fwcrc_progress = 0
+,.fwcrc_speed = 0
+#endif
 };
 
 #ifdef REALTIME_TABLES
-uint8_t mm_get_byte_ram(uint16_t offset)
-{
- return *(((uint8_t*)&d.tables_ram) + offset);
-}
-
-uint8_t mm_get_byte_pgm(uint16_t offset)
-{
- return PGM_GET_BYTE(((uint8_t _PGM*)d.fn_dat) + offset);
-}
-
-uint16_t mm_get_word_ram(uint16_t offset)
-{
- return *((uint16_t*)(((uint8_t*)&d.tables_ram) + offset));
-}
-
 /** Get 12-bit word from SRAM
  * \param offset offset of the array from the beginning of structure
  * \param off offset of cell from the beginning of array
@@ -154,11 +141,6 @@ uint16_t mm_get_w12_ram(uint16_t offset, uint8_t off)
  uint16_t word = *((uint16_t*)(((uint8_t*)&d.tables_ram) + offset + ((uint16_t)off+(off>>1)) ));
  return ((off & 0x0001) ? word >> 4 : word) & 0x0FFF;
 }
-
-uint16_t mm_get_word_pgm(uint16_t offset)
-{
- return PGM_GET_WORD((uint16_t _PGM*)(((uint8_t _PGM*)d.fn_dat) + offset));
-}
 #endif
 
 /** Get 12-bit word from flash
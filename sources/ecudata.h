@@ -31,15 +31,7 @@
 #include "tables.h"
 
 #ifdef REALTIME_TABLES
-typedef uint8_t  (*mm_func8_ptr_t)(uint16_t);
-typedef uint16_t (*mm_func16_ptr_t)(uint16_t);
-typedef uint16_t (*mm_func12_ptr_t)(uint16_t,uint8_t);
-
-uint8_t mm_get_byte_ram(uint16_t offset);
-uint8_t mm_get_byte_pgm(uint16_t offset);
-uint16_t mm_get_word_ram(uint16_t offset);
 uint16_t mm_get_w12_ram(uint16_t offset, uint8_t off);
-uint16_t mm_get_word_pgm(uint16_t offset);
 #endif
 uint16_t mm_get_w12_pgm(uint16_t offset, uint8_t off);
 
@@ -211,6 +203,31 @@ typedef struct correct_t
 #endif
 }correct_t;
 
+#ifdef FUEL_INJECT
+//Multiplicative stages of the fuel pulse width pipeline (indexes in fuelpw_t::corr)
+#define FPW_IFR          0               //!< injector's flow rate vs MAP
+#define FPW_AIRDEN       1               //!< air density
+#define FPW_WARMUP       2               //!< warmup enrichment
+#define FPW_AFTSTR       3               //!< afterstart enrichment
+#define FPW_LAMBDA       4               //!< lambda (EGO) correction
+#define FPW_IACMIX       5               //!< mixture correction vs IAC position
+#define FPW_BARO         6               //!< barometric correction
+#define FPW_GASTEMP      7               //!< gas temperature
+#define FPW_GASPRESS     8               //!< gas pressure
+#define FPW_NUM          9               //!< number of stages
+
+#define FPW_ONE          4096            //!< factor 1.0 (stage is not used)
+
+/**Breakdown of the fuel pulse width calculation. Contribution of each stage can be logged */
+typedef struct fuelpw_t
+{
+ uint16_t base;                          //!< base PW (ideal gas law, VE, AFR) or cranking PW, in ticks of timer
+ uint16_t corr[FPW_NUM];                 //!< factors of multiplicative stages, value * 4096
+ uint16_t k;                             //!< product of all factors, value * 4096
+ int32_t  acc;                           //!< acceleration enrichment (added after all factors), in ticks of timer
+}fuelpw_t;
+#endif
+
 /**Describes system's data (main ECU data structure)
  */
 typedef struct ecudata_t
@@ -235,9 +252,7 @@ typedef struct ecudata_t
 
 #ifdef REALTIME_TABLES
  f_data_t tables_ram;                    //!< set of tables in RAM
- mm_func8_ptr_t mm_ptr8;                 //!< callback, returns 8 bit result, unsigned
- mm_func16_ptr_t mm_ptr16;               //!< callback, return 16 bit result, unsigned
- mm_func12_ptr_t mm_ptr12;               //!< callback, return 12 bit result, unsigned
+ uint8_t mm_ram;                         //!< 1 - selected set of tables resides in RAM (tables_ram), 0 - in FLASH (fn_dat)
 #endif
  f_data_t _PGM *fn_dat;                  //!< Pointer to the set of tables
 
@@ -271,6 +286,7 @@ typedef struct ecudata_t
 
 #ifdef FUEL_INJECT
  uint16_t inj_pw;                        //!< current value of injector pulse width
+ fuelpw_t fpw;                           //!< breakdown of inj_pw
  volatile uint16_t inj_pwns[2];
  int16_t inj_dt;                         //!< current value of injector's dead time
  uint16_t inj_fff;                       //!< Instant fuel flow as frequency (Hz), 16000 pulses per 1L of burnt fuel (value * 256)
@@ -304,6 +320,11 @@ typedef struct ecudata_t
  uint8_t gasval_on;                     //!< State of the GASVAL_O output
  uint8_t gasval_res;
 #endif
+
+#ifdef DEFERRED_CRC
+ uint8_t  fwcrc_progress;               //!< Progress of the deferred check of firmware's CRC, 0...100%
+ uint16_t fwcrc_speed;                  //!< Achieved speed of the deferred check of firmware's CRC, bytes per ms
+#endif
 }ecudata_t;
 
 
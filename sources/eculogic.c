@@ -52,6 +52,8 @@ typedef struct
  uint8_t  sfc_transient_l;       //!< Counter for soft transient from the fuel cut mode to normal injection
  uint16_t sfc_pw_e;              //!<
  uint16_t sfc_pw_l;              //!<
+ uint16_t fpw_m;                 //!< mantissa of the product of inj. PW factors, 32768...65535 (or 0), product = fpw_m * 2^fpw_e / 32768
+ int8_t   fpw_e;                 //!< exponent of the product of inj. PW factors
 #endif
  int16_t  calc_adv_ang;          //!< calculated advance angle
  int16_t  advance_angle_inhibitor_state; //!<
@@ -60,7 +62,7 @@ typedef struct
 /**Instance of internal state variables structure*/
 static logic_state_t lgs = {
 #ifdef FUEL_INJECT
- 0,0,0,0,0,0,0,0,
+ 0,0,0,0,0,0,0,0,0,0,
 #endif
  0,0
 };
@@ -73,14 +75,67 @@ void eculogic_init(void)
  d.sens.baro_press = PRESSURE_MAGNITUDE(101.3); //set default value to prevent wrong conditions when barometric pressure will not be sampled for some reasons
 }
 
+#ifdef FUEL_INJECT
+void fpw_begin(uint16_t base)
+{
+ uint8_t i;
+ d.fpw.base = base;
+ for(i = 0; i < FPW_NUM; ++i)
+  d.fpw.corr[i] = FPW_ONE;
+ d.fpw.k = FPW_ONE;
+ d.fpw.acc = 0;
+ lgs.fpw_m = 32768, lgs.fpw_e = 0; //1.0
+}
+
+void fpw_corr(uint8_t stage, uint16_t factor, uint8_t shift)
+{
+ uint32_t f;
+ if (shift > 12)
+  d.fpw.corr[stage] = factor >> (shift - 12);
+ else
+  d.fpw.corr[stage] = (factor > (65535 >> (12 - shift))) ? 65535 : factor << (12 - shift);
+ //Product is kept normalized, so it does not lose precision when it is small and does not saturate
+ //when it exceeds 16.0 temporarily (following factors may decrease it)
+ f = ((uint32_t)factor) * lgs.fpw_m;   //factor is used as is, without loss of precision
+ if (!f || lgs.fpw_e < -24)
+ {
+  lgs.fpw_m = 0;                     //zero
+  return;
+ }
+ lgs.fpw_e+= 16 - shift;             //(2^32 / 2^16) / 2^shift
+ //normalize by halves (binary search of the leading one), shifts by 16 and 8 are just moves of bytes
+ if (!(f & 0xFFFF0000))
+  f<<= 16, lgs.fpw_e-= 16;
+ if (!(f & 0xFF000000))
+  f<<= 8, lgs.fpw_e-= 8;
+ if (!(f & 0xF0000000))
+  f<<= 4, lgs.fpw_e-= 4;
+ if (!(f & 0xC0000000))
+  f<<= 2, lgs.fpw_e-= 2;
+ if (!(f & 0x80000000))
+  f<<= 1, --lgs.fpw_e;
+ lgs.fpw_m = f >> 16;
+}
+
+int32_t fpw_end(int32_t acc)
+{
+ uint8_t shift;
+ if (lgs.fpw_e > 3)
+  lgs.fpw_m = 65535, lgs.fpw_e = 3;  //16.0 max.
+ shift = 15 - lgs.fpw_e;
+ d.fpw.k = (shift < 31) ? (((uint32_t)lgs.fpw_m) << 12) >> shift : 0;
+ d.fpw.acc = acc;
+ return ((shift < 32) ? (((uint32_t)d.fpw.base) * lgs.fpw_m) >> shift : 0) + acc;
+}
+#endif
+
 #if defined(FUEL_INJECT) && !defined(SECU3T)
 /** Applies gas temperature and pressure corrections (coefficients) to the inj. PW
- * \param pw PW to be corrected, will also receive result
  */
-void pw_gascorr(int32_t* pw)
+static void fpw_gascorr(void)
 {
- (*pw) = ((*pw) * inj_gts_pwcorr()) >> 7;              //apply gas temperature correction
- (*pw) = ((*pw) * inj_gps_pwcorr()) >> 7;              //apply gas pressure correction
+ fpw_corr(FPW_GASTEMP, inj_gts_pwcorr(), 7);         //apply gas temperature correction
+ fpw_corr(FPW_GASPRESS, inj_gps_pwcorr(), 7);        //apply gas pressure correction
 }
 #endif
 
@@ -212,29 +267,30 @@ static void fuel_calc(void)
  if (!(d.sens.gas && IOCFG_CHECK(IOP_GD_STP)))
  {
 #endif
- int32_t pw = inj_base_pw();
+ int32_t pw;
+ fpw_begin(inj_base_pw());
 
 #ifdef IFR_VS_MAP_CORR
  if (PGM_GET_WORD(&fw_data.exdata.frap))
-  pw = (pw * ifr_vs_map_corr()) >> 8;            //apply injector's flow rate vs manifold pressure correction
+  fpw_corr(FPW_IFR, ifr_vs_map_corr(), 8);      //apply injector's flow rate vs manifold pressure correction
 #endif
 
  if (CHECKBIT(d.param.inj_flags, INJFLG_USEAIRDEN))
-  pw = (pw * inj_airtemp_corr(0)) >> 7;           //apply air density correction (if enabled)
+  fpw_corr(FPW_AIRDEN, inj_airtemp_corr(0), 7); //apply air density correction (if enabled)
 
- pw = (pw * inj_warmup_en()) >> 7;              //apply warmup enrichemnt factor
+ fpw_corr(FPW_WARMUP, inj_warmup_en(), 7);      //apply warmup enrichemnt factor
  if (lgs.aftstr_enrich_counter)
-  pw= (pw * (128 + scale_aftstr_enrich(lgs.aftstr_enrich_counter))) >> 7; //apply scaled afterstart enrichment factor
- pw= (pw * (512 + d.corr.lambda)) >> 9;         //apply lambda correction additive factor (signed)
- pw= (pw * inj_iacmixtcorr_lookup()) >> 13;     //apply mixture correction vs IAC
+  fpw_corr(FPW_AFTSTR, 128 + scale_aftstr_enrich(lgs.aftstr_enrich_counter), 7); //apply scaled afterstart enrichment factor
+ fpw_corr(FPW_LAMBDA, 512 + d.corr.lambda, 9);  //apply lambda correction additive factor (signed)
+ fpw_corr(FPW_IACMIX, inj_iacmixtcorr_lookup(), 13); //apply mixture correction vs IAC
  if (d.param.barocorr_type)
-  pw = (pw * barocorr_lookup()) >> 12;           //apply barometric correction
+  fpw_corr(FPW_BARO, barocorr_lookup(), 12);     //apply barometric correction
 
 #ifndef SECU3T
  if (CHECKBIT(d.param.inj_flags, INJFLG_USEADDCORRS))
-  pw_gascorr(&pw);                              //apply gas corrections
+  fpw_gascorr();                                //apply gas corrections
 #endif
- pw+= acc_enrich_calc(0, lambda_get_stoichval());//add acceleration enrichment
+ pw = fpw_end(acc_enrich_calc(0, lambda_get_stoichval()));//apply all factors at once and add acceleration enrichment
 
  d.inj_pw = finalize_inj_time(&pw);
  d.inj_pw = apply_smooth_fuelcut(d.inj_pw);
@@ -360,13 +416,15 @@ void eculogic_system_state_machine(void)
    if (!(d.sens.gas && IOCFG_CHECK(IOP_GD_STP)))
 #endif
    { //PW = CRANKING + DEADTIME
-   int32_t pw = inj_cranking_pw();
+   int32_t pw;
+   fpw_begin(inj_cranking_pw());
    if (d.param.barocorr_type)
-    pw = (pw * barocorr_lookup()) >> 12;             //apply barometric correction
+    fpw_corr(FPW_BARO, barocorr_lookup(), 12);       //apply barometric correction
 #ifndef SECU3T
    if (CHECKBIT(d.param.inj_flags, INJFLG_USEADDCORRS))
-    pw_gascorr(&pw);                                 //apply gas corrections
+    fpw_gascorr();                                   //apply gas corrections
 #endif
+   pw = fpw_end(0);
 
    d.inj_pw = finalize_inj_time(&pw);
    if (!(d.eng_running))
@@ -57,4 +57,27 @@ void eculogic_cog_changed_notification(void);
 /**called from main loop when system detects engine stop*/
 void eculogic_eng_stopped_notification(void);
 
+#ifdef FUEL_INJECT
+/** Begins calculation of the inj. PW. All multiplicative stages are set to 1.0
+ * Uses d ECU data structure (d.fpw receives breakdown of the calculation)
+ * \param base Base PW (ticks of timer)
+ */
+void fpw_begin(uint16_t base);
+
+/** Applies multiplicative stage of the inj. PW calculation. Factor is converted into common format
+ * (value * 4096) and stored in the breakdown. Factor is combined with normalized product (mantissa
+ * and exponent) of previous factors, so PW itself is multiplied and shifted only once (see fpw_end())
+ * \param stage Index of stage (FPW_XXX)
+ * \param factor Value of factor
+ * \param shift Number of fractional bits in the factor (e.g. 7 for value * 128)
+ */
+void fpw_corr(uint8_t stage, uint16_t factor, uint8_t shift);
+
+/** Finishes calculation of the inj. PW: applies product of all factors to the base PW and adds acceleration enrichment
+ * \param acc Acceleration enrichment (ticks of timer, signed)
+ * \return PW (not restricted)
+ */
+int32_t fpw_end(int32_t acc);
+#endif
+
 #endif //_ECULOGIC_H_
@@ -30,10 +30,37 @@
 #include "port/interrupt.h"
 #include "port/intrinsic.h"
 #include "port/port.h"
+#include <string.h>
 #include "bitmask.h"
+#include "crc16.h"
 #include "eeprom.h"
+#include "tables.h"   //for params_t and f_data_t
 #include "wdt.h"
 
+/**End of the data area (parameters, errors and tables which can be edited in real time) */
+#ifdef REALTIME_TABLES
+ #define EEPROM_DATA_END (EEPROM_REALTIME_TABLES_START + sizeof(f_data_t))
+#else
+ #define EEPROM_DATA_END EEPROM_REALTIME_TABLES_START
+#endif
+
+/**Compile-time check: data area must not overlap the journal. Size of array becomes negative otherwise */
+typedef uint8_t eeprom_journal_overlap_check[(EEPROM_DATA_END <= EEPROM_JOURNAL_START) ? 1 : -1];
+
+/**Size of queue of ranges which must be written (see eeprom_start_wr_changes()) */
+#define EEPROM_WRQ_SIZE  8
+
+/**Number of bytes compared per call of eeprom_process() */
+#define EEPROM_SCAN_STEP 64
+
+/**Describes one range of data which must be written into EEPROM */
+typedef struct
+{
+ uint16_t ee_addr;             //!< Address for EEPROM
+ uint8_t* sram_addr;           //!< Address of data in RAM
+ uint16_t count;               //!< Number of bytes
+}eeprom_wr_range_t;
+
 /**Describes information is necessary for storing of data into EEPROM
  * (       EEPROM)
  */
@@ -45,10 +72,24 @@ typedef struct
  uint8_t eews;                 //!< State of writing process (  )
  uint8_t opcode;               //!< code of specific operation which caused writing process
  uint8_t completed_opcode;     //!< will be equal to opcode after finish of process
+ eeprom_wr_range_t q[EEPROM_WRQ_SIZE]; //!< queue of changed ranges found by comparison
+ uint8_t q_num;                //!< number of ranges in the queue
+ uint8_t q_idx;                //!< index of range which is being written
+ eeprom_wr_range_t scan;       //!< remaining part of block which must be compared with EEPROM
 }eeprom_wr_desc_t;
 
 /**State variables */
-eeprom_wr_desc_t eewd = {0,0,0,0,0,0};
+eeprom_wr_desc_t eewd = {0,0,0,0,0,0,{{0,0,0}},0,0,{0,0,0}};
+
+/**State of the journal */
+typedef struct
+{
+ uint8_t rec[EEPROM_JOURNAL_REC_SIZE]; //!< newest record (found by scan or being written)
+ uint8_t slot;                 //!< index of cell for the next record
+}eeprom_journal_t;
+
+/**Journal's state variables */
+eeprom_journal_t ejr = {{0},0};
 
 /** Initiates process of byte's writing (     EEPROM) */
 #define EE_START_WR_BYTE()  {EECR|= _BV(EEMPE);  EECR|= _BV(EEPE);}
@@ -66,6 +107,8 @@ uint8_t eeprom_take_completed_opcode(void)
 //    EEPROM   
 void eeprom_start_wr_data(uint8_t opcode, uint16_t eeaddr, void* sramaddr, uint16_t size)
 {
+ eewd.q_num = 0;
+ eewd.scan.count = 0;
  eewd.eews = 1;
  eewd.ee_addr = eeaddr;
  eewd.sram_addr = sramaddr;
@@ -74,6 +117,68 @@ void eeprom_start_wr_data(uint8_t opcode, uint16_t eeaddr, void* sramaddr, uint1
  SETBIT(EECR, EERIE);
 }
 
+void eeprom_start_wr_changes(uint8_t opcode, uint16_t eeaddr, void* sramaddr, uint16_t size)
+{
+ eewd.q_num = 0;
+ eewd.scan.ee_addr = eeaddr;
+ eewd.scan.sram_addr = sramaddr;
+ eewd.scan.count = size;
+ eewd.opcode = opcode;
+ eewd.eews = 3;   //comparison will be performed by eeprom_process()
+}
+
+void eeprom_process(void)
+{
+ uint8_t n = EEPROM_SCAN_STEP, _t, b;
+ if (eewd.eews != 3)
+  return; //nothing to compare
+
+ for(; n && eewd.scan.count; --n)
+ {
+  _t=_SAVE_INTERRUPT();
+  _DISABLE_INTERRUPT();
+  __EEGET(b, eewd.scan.ee_addr);
+  _RESTORE_INTERRUPT(_t);
+  if (b != *eewd.scan.sram_addr)
+  {
+   eeprom_wr_range_t* p_last = &eewd.q[eewd.q_num];
+   if (eewd.q_num && (p_last[-1].ee_addr + p_last[-1].count) == eewd.scan.ee_addr)
+    ++p_last[-1].count;  //coalesce with previous changed byte
+   else if (eewd.q_num < EEPROM_WRQ_SIZE)
+   {
+    p_last->ee_addr = eewd.scan.ee_addr;
+    p_last->sram_addr = eewd.scan.sram_addr;
+    p_last->count = 1;
+    ++eewd.q_num;
+   }
+   else
+    break; //queue is full, write queued ranges and then continue from this byte
+  }
+  ++eewd.scan.ee_addr;
+  ++eewd.scan.sram_addr;
+  --eewd.scan.count;
+ }
+ EEAR=0x000; //this will help to prevent corruption of EEPROM
+
+ if (eewd.scan.count && eewd.q_num < EEPROM_WRQ_SIZE)
+  return; //continue comparison next time
+
+ if (eewd.q_num)
+ { //start writing of the first queued range
+  eewd.q_idx = 0;
+  eewd.ee_addr = eewd.q[0].ee_addr;
+  eewd.sram_addr = eewd.q[0].sram_addr;
+  eewd.count = eewd.q[0].count;
+  eewd.eews = 1;
+  SETBIT(EECR, EERIE);
+ }
+ else if (!eewd.scan.count)
+ { //nothing changed
+  eewd.eews = 0;
+  eewd.completed_opcode = eewd.opcode;
+ }
+}
+
 //  0        
 uint8_t eeprom_is_idle(void)
 {
@@ -104,19 +209,100 @@ ISR(EE_RDY_vect)
    ++eewd.sram_addr;
    ++eewd.ee_addr;
    if (--eewd.count==0)
-    eewd.eews = 2;   //    .
+   {
+    if (++eewd.q_idx < eewd.q_num)
+    { //take next queued range
+     eeprom_wr_range_t* p_r = &eewd.q[eewd.q_idx];
+     eewd.ee_addr = p_r->ee_addr;
+     eewd.sram_addr = p_r->sram_addr;
+     eewd.count = p_r->count;
+    }
+    else
+     eewd.eews = 2;   //    .
+   }
    else
     eewd.eews = 1;
    break;
 
   case 2:   //last byte wrote
    EEAR=0x000;      //this will help to prevent corruption of EEPROM
-   eewd.eews = 0;
-   eewd.completed_opcode = eewd.opcode;
+   eewd.q_num = 0;
+   if (eewd.scan.count)
+    eewd.eews = 3;   //comparison was interrupted because queue was full, continue it
+   else
+   {
+    eewd.eews = 0;
+    eewd.completed_opcode = eewd.opcode;
+   }
    break;
  }//switch
 }
 
+/**Calculates CRC8 of journal's record (sequence number and data)
+ * \param rec pointer to record
+ * \return CRC8
+ */
+static uint8_t journal_crc(const uint8_t* rec)
+{
+ uint8_t i = 0, crc = 0x5A; //non-zero seed, so neither erased (0xFF) nor zeroed cell is a valid record
+ for(; i < (EEPROM_JOURNAL_REC_SIZE - 1); ++i)
+  crc = update_crc8(rec[i], crc);
+ return crc;
+}
+
+/**Builds next record of journal and selects cell for it
+ * \param data data of record
+ * \return EEPROM address of cell
+ */
+static uint16_t journal_make_rec(const void* data)
+{
+ uint16_t addr = EEPROM_JOURNAL_START + (((uint16_t)ejr.slot) * EEPROM_JOURNAL_REC_SIZE);
+ if (++ejr.slot >= EEPROM_JOURNAL_RECS)
+  ejr.slot = 0;
+ ++ejr.rec[0]; //sequence number
+ memcpy(&ejr.rec[1], data, EEPROM_JOURNAL_DATA_SIZE);
+ ejr.rec[EEPROM_JOURNAL_REC_SIZE - 1] = journal_crc(ejr.rec);
+ return addr;
+}
+
+uint8_t eeprom_journal_init(void* data)
+{
+ uint8_t rec[EEPROM_JOURNAL_REC_SIZE], i, found = 0;
+ for(i = 0; i < EEPROM_JOURNAL_RECS; ++i)
+ {
+  eeprom_read(rec, EEPROM_JOURNAL_START + (((uint16_t)i) * EEPROM_JOURNAL_REC_SIZE), EEPROM_JOURNAL_REC_SIZE);
+  if (journal_crc(rec) != rec[EEPROM_JOURNAL_REC_SIZE - 1])
+   continue; //empty or damaged cell
+  //sequence numbers are compared using serial arithmetic, because they wrap around
+  if (!found || ((int8_t)(rec[0] - ejr.rec[0])) > 0)
+  {
+   memcpy(ejr.rec, rec, EEPROM_JOURNAL_REC_SIZE);
+   ejr.slot = (i + 1) < EEPROM_JOURNAL_RECS ? (i + 1) : 0;
+   found = 1;
+  }
+ }
+ if (found)
+  memcpy(data, &ejr.rec[1], EEPROM_JOURNAL_DATA_SIZE);
+ else
+ {
+  ejr.rec[0] = 0xFF; //first record will get sequence number 0
+  ejr.slot = 0;
+ }
+ return found;
+}
+
+void eeprom_journal_start_wr(uint8_t opcode, const void* data)
+{
+ uint16_t addr = journal_make_rec(data);
+ eeprom_start_wr_data(opcode, addr, ejr.rec, EEPROM_JOURNAL_REC_SIZE);
+}
+
+void eeprom_journal_write(const void* data)
+{
+ uint16_t addr = journal_make_rec(data);
+ eeprom_write(ejr.rec, addr, EEPROM_JOURNAL_REC_SIZE);
+}
+
 void eeprom_read(void* sram_dest, uint16_t eeaddr, uint16_t size)
 {
  uint8_t _t;
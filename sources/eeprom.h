@@ -35,7 +35,8 @@
 /**Address of parameters structure in EEPROM (    EEPROM) */
 #define EEPROM_PARAM_START     0x001
 
-/**Address of errors's array (Check Engine) in EEPROM (   (Check Engine)  EEPROM) */
+/**Legacy address of errors's array (Check Engine) in EEPROM, now errors are saved in the journal
+ * and this location is read only if journal doesn't contain any record (   (Check Engine)  EEPROM) */
 #define EEPROM_ECUERRORS_START (EEPROM_PARAM_START+(sizeof(params_t)))
 
 /**Address of tables which can be edited in real time */
@@ -44,6 +45,13 @@
 /**Address of magic number in EEPROM (last 4 bytes) */
 #define EEPROM_MAGIC_START (E2END-3)
 
+#define EEPROM_JOURNAL_DATA_SIZE 4   //!< size of data in one record of the journal
+#define EEPROM_JOURNAL_REC_SIZE  (EEPROM_JOURNAL_DATA_SIZE + 2) //!< size of record: sequence number, data, CRC8
+#define EEPROM_JOURNAL_RECS      32  //!< number of records in the journal (ring), each cell is written once per this number of records
+
+/**Address of the journal (wear-levelled area for frequently updated data), placed before magic number */
+#define EEPROM_JOURNAL_START (EEPROM_MAGIC_START - (EEPROM_JOURNAL_RECS * EEPROM_JOURNAL_REC_SIZE))
+
 //Interface of module ( )
 
 /**Start writing process of EEPROM for selected block of data
@@ -55,6 +63,22 @@
  */
 void eeprom_start_wr_data(uint8_t opcode, uint16_t eeaddr, void* sramaddr, uint16_t size);
 
+/**Start writing process of EEPROM for selected block of data, but only bytes which differ from
+ * the current contents of EEPROM are written. Block is compared with EEPROM by portions in the
+ * eeprom_process(), changed bytes are coalesced into ranges, which are queued and written in
+ * background. EEPROM is busy until whole block is processed (see eeprom_is_idle()).
+ * \param opcode some code which will be remembered and can be retrieved when process finishes
+ * \param eeaddr address in the EEPROM for write into
+ * \param sramaddr address of block of data in RAM
+ * \param size number of bytes in RAM to write (size of block)
+ */
+void eeprom_start_wr_changes(uint8_t opcode, uint16_t eeaddr, void* sramaddr, uint16_t size);
+
+/**Performs comparison of block of data started by eeprom_start_wr_changes(). Must be called from
+ * the main loop
+ */
+void eeprom_process(void);
+
 /**Checks if EEPROM is busy
  * (  0        ).
  * \return 0 - busy, > 0 - idle
@@ -85,6 +109,26 @@ void eeprom_write(const void* sram_src, uint16_t eeaddr, uint16_t size);
  */
 void eeprom_write_P(void _PGM *pgm_src, uint16_t eeaddr, uint16_t size);
 
+/**Scans journal and finds its newest valid record (record with correct CRC8 and greatest sequence number).
+ * Must be called at start up before any other journal functions
+ * \param data buffer (EEPROM_JOURNAL_DATA_SIZE bytes) which will receive data of the newest record
+ * \return 1 - record found, 0 - journal is empty (data is not changed)
+ */
+uint8_t eeprom_journal_init(void* data);
+
+/**Starts appending of record to the journal (background process, see eeprom_start_wr_data()).
+ * Record is written into the cell following the newest record, CRC8 is written last, so interrupted
+ * writing doesn't damage previous records. Call only if EEPROM is idle!
+ * \param opcode some code which will be remembered and can be retrieved when process finishes
+ * \param data data of record (EEPROM_JOURNAL_DATA_SIZE bytes)
+ */
+void eeprom_journal_start_wr(uint8_t opcode, const void* data);
+
+/**Appends record to the journal (without using of interrupts)
+ * \param data data of record (EEPROM_JOURNAL_DATA_SIZE bytes)
+ */
+void eeprom_journal_write(const void* data);
+
 /**Returns code of last finished operation (code which was passed into eeprom_start_wr_data())
  *     (    eeprom_start_wr_data())
  * \return code of last finished operation
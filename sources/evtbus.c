@@ -0,0 +1,159 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file evtbus.c
+ * \author Alexey A. Shabelnikov
+ * Implementation of the event bus.
+ */
+
+#include "port/pgmspace.h"
+#include "port/port.h"
+#include <stdint.h>
+#include "aircond.h"
+#include "ce_errors.h"
+#include "eculogic.h"
+#include "evtbus.h"
+#include "gasdose.h"
+#include "grheat.h"
+#include "grvalve.h"
+#include "intkheat.h"
+#include "lambda.h"
+#include "starter.h"
+#include "ventilator.h"
+#include "vstimer.h"
+
+//Tables of subscribers. Note: order of calls matters! Pay special attention if you are going to change it!
+
+/**Subscribers of engine stroke event */
+PGM_DECLARE(static evt_handler_t evt_stroke_subs[]) =
+{
+ &eculogic_stroke_event_notification,
+ &ce_stroke_event_notification,
+ &starter_stroke_event_notification,
+#if defined(FUEL_INJECT) || defined(CARB_AFR) || defined(GD_CONTROL)
+ &lambda_stroke_event_notification,
+#endif
+#ifdef GD_CONTROL
+ &gasdose_stroke_event_notification,
+#endif
+#ifdef AIRCONDIT
+ &aircond_stroke_event_notification,
+#endif
+};
+
+/**Subscribers of cog changed event */
+PGM_DECLARE(static evt_handler_t evt_cogchg_subs[]) =
+{
+ &eculogic_cog_changed_notification,
+#ifdef INTK_HEATING
+ &intkheat_cog_changed_notification,
+#endif
+ &vent_cog_changed_notification,
+#ifndef SECU3T
+ &grheat_cog_changed_notification,
+ &grvalve_cog_changed_notification,
+#endif
+};
+
+/**Subscribers of engine stopped event */
+PGM_DECLARE(static evt_handler_t evt_engstop_subs[]) =
+{
+ &eculogic_eng_stopped_notification, //set cranking mode
+#if defined(FUEL_INJECT) || defined(CARB_AFR) || defined(GD_CONTROL)
+ &lambda_eng_stopped_notification,
+#endif
+ &starter_eng_stopped_notification,
+#ifndef SECU3T
+ &grvalve_eng_stopped_notification,
+#endif
+};
+
+#define EVT_STROKE_SUBS  (sizeof(evt_stroke_subs) / sizeof(evt_handler_t))   //!< number of subscribers of EVT_STROKE
+#define EVT_COGCHG_SUBS  (sizeof(evt_cogchg_subs) / sizeof(evt_handler_t))   //!< number of subscribers of EVT_COG_CHANGED
+#define EVT_ENGSTOP_SUBS (sizeof(evt_engstop_subs) / sizeof(evt_handler_t))  //!< number of subscribers of EVT_ENG_STOPPED
+
+#ifdef EVENT_PROFILER
+
+evtprof_stat_t evtprof_stat[EVT_NUMBER][EVTPROF_MAX_SUBS];
+
+void evtprof_init(void)
+{
+ uint8_t i, j;
+ for(i = 0; i < EVT_NUMBER; ++i)
+  for(j = 0; j < EVTPROF_MAX_SUBS; ++j)
+  {
+   evtprof_stat[i][j].count = 0;
+   evtprof_stat[i][j].max = 0;
+   evtprof_stat[i][j].sum = 0;
+  }
+}
+
+uint8_t evtbus_get_subs_num(uint8_t event)
+{
+ if (EVT_STROKE == event)
+  return EVT_STROKE_SUBS;
+ else if (EVT_COG_CHANGED == event)
+  return EVT_COGCHG_SUBS;
+ else
+  return EVT_ENGSTOP_SUBS;
+}
+#endif //EVENT_PROFILER
+
+/**Calls subscribers from the specified table
+ * \param subs Pointer to the table of subscribers (program memory)
+ * \param num Number of subscribers in the table
+ * \param event Event (used for recording of statistics)
+ */
+static void evtbus_call(evt_handler_t const* subs, uint8_t num, uint8_t event)
+{
+ uint8_t i = 0;
+#ifdef EVENT_PROFILER
+ uint16_t t0, t1;
+ t0 = s_timer_ftc();
+#endif
+ for(; i < num; ++i)
+ {
+  ((evt_handler_t)PGM_GET_FPTR(&subs[i]))();
+#ifdef EVENT_PROFILER
+  t1 = s_timer_ftc();
+  if (i < EVTPROF_MAX_SUBS)
+   prof_update(&evtprof_stat[event][i], t1 - t0);
+  t0 = t1;
+#endif
+ }
+}
+
+void evtbus_dispatch(uint8_t event)
+{
+ switch(event)
+ {
+  case EVT_STROKE:
+   evtbus_call(evt_stroke_subs, EVT_STROKE_SUBS, event);
+   break;
+  case EVT_COG_CHANGED:
+   evtbus_call(evt_cogchg_subs, EVT_COGCHG_SUBS, event);
+   break;
+  case EVT_ENG_STOPPED:
+   evtbus_call(evt_engstop_subs, EVT_ENGSTOP_SUBS, event);
+   break;
+ }
+}
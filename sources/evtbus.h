@@ -0,0 +1,70 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file evtbus.h
+ * \author Alexey A. Shabelnikov
+ * Event bus. Dispatches events of the main loop (engine stroke, cog changed, engine stopped) to the
+ * subscribers registered at compile time in tables stored in the program memory.
+ */
+
+#ifndef _EVTBUS_H_
+#define _EVTBUS_H_
+
+#include <stdint.h>
+#include "loopprof.h"
+
+//Events
+#define EVT_STROKE       0     //!< engine stroke
+#define EVT_COG_CHANGED  1     //!< cog number has changed (engine is rotating)
+#define EVT_ENG_STOPPED  2     //!< engine has stopped (RPM is below critical threshold)
+#define EVT_NUMBER       3     //!< number of events
+
+/**Type of subscriber's function (event handler) */
+typedef void (*evt_handler_t)(void);
+
+/**Calls all subscribers of specified event in order of their registration
+ * \param event Event (EVT_xxx)
+ */
+void evtbus_dispatch(uint8_t event);
+
+#ifdef EVENT_PROFILER
+
+#define EVTPROF_MAX_SUBS 8     //!< maximum number of subscribers of one event, which statistics is recorded for
+
+/**Statistics of a single subscriber (number of calls, maximum and sum of times, see loopprof.h) */
+typedef prof_stat_t evtprof_stat_t;
+
+/**Statistics of subscribers, indexes are event (EVT_xxx) and order of subscriber in the table of event */
+extern evtprof_stat_t evtprof_stat[EVT_NUMBER][EVTPROF_MAX_SUBS];
+
+/**Initialization of statistics */
+void evtprof_init(void);
+
+/**Returns number of subscribers of specified event
+ * \param event Event (EVT_xxx)
+ * \return number of subscribers
+ */
+uint8_t evtbus_get_subs_num(uint8_t event);
+
+#endif //EVENT_PROFILER
+
+#endif //_EVTBUS_H_
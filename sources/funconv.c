@@ -44,12 +44,13 @@
  #define secu3_offsetof(type,member)   ((size_t)(&((type *)0)->member))
 //For use with fn_dat pointer, because it can point either to FLASH or RAM
 #ifdef REALTIME_TABLES
- /**Macro for abstraction under getting bytes from RAM or FLASH (RAM version) */
- #define _GB(x) ((int8_t)d.mm_ptr8(secu3_offsetof(struct f_data_t, x)))
- #define _GW(x) ((int16_t)d.mm_ptr16(secu3_offsetof(struct f_data_t, x)))
- #define _GBU(x) (d.mm_ptr8(secu3_offsetof(struct f_data_t, x)))
- #define _GWU(x) (d.mm_ptr16(secu3_offsetof(struct f_data_t, x)))
- #define _GWU12(x,i,j) (d.mm_ptr12(secu3_offsetof(struct f_data_t, x), (i*16+j) )) //note: hard coded size of array
+ /**Macro for abstraction under getting bytes from RAM or FLASH (RAM version). Set of tables in RAM is accessed
+  * directly, offset of the value is calculated at compile time */
+ #define _GB(x) ((int8_t)(d.mm_ram ? d.tables_ram.x : PGM_GET_BYTE(&d.fn_dat->x)))
+ #define _GW(x) ((int16_t)(d.mm_ram ? d.tables_ram.x : PGM_GET_WORD(&d.fn_dat->x)))
+ #define _GBU(x) (d.mm_ram ? (uint8_t)d.tables_ram.x : PGM_GET_BYTE(&d.fn_dat->x))
+ #define _GWU(x) (d.mm_ram ? (uint16_t)d.tables_ram.x : PGM_GET_WORD(&d.fn_dat->x))
+ #define _GWU12(x,i,j) (d.mm_ram ? mm_get_w12_ram(secu3_offsetof(struct f_data_t, x), (i*16+j)) : mm_get_w12_pgm(secu3_offsetof(struct f_data_t, x), (i*16+j))) //note: hard coded size of array
 #else
  #define _GB(x) ((int8_t)(PGM_GET_BYTE(&d.fn_dat->x)))    //!< Macro for abstraction under getting bytes from RAM or FLASH (FLASH version)
  #define _GW(x) ((int16_t)(PGM_GET_WORD(&d.fn_dat->x)))   //!< Macro for abstraction under getting words from RAM or FLASH (FLASH version)
@@ -74,29 +75,59 @@
 /**TPS % between two interpolation points, additionally multiplied by 16 */
 #define TPS_AXIS_STEP TPS_MAGNITUDE((100.0*16)/(F_WRK_POINTS_L-1))
 
+//Indexes of maps in the cache of corners (maps which use RPM/load grid)
+#define LC_WRK      0     //!< f_wrk map
+#define LC_PWM1     1     //!< pwm_duty1 map (unsigned)
+#define LC_PWM2     2     //!< pwm_duty2 map
+#define LC_SPLIT    3     //!< pwm_duty1 map (signed), used for angle splitting
+#define LC_VE       4     //!< inj_ve map
+#define LC_AFR      5     //!< inj_afr map
+#define LC_INJTIM   6     //!< inj_timing map
+#define LC_NUM      7     //!< number of entries in the cache
+
 /**State variables, local use*/
 typedef struct
 {
  int16_t la_rpm;       //!< RPM axis argument
  int16_t la_load;      //!< Load axis argument
  int16_t la_grad;      //!< amount of load per one cell on the load axis
+ int16_t la_range;     //!< load range (upper - lower) for which la_grad and la_rgrad have been calculated
+ uint16_t la_rgrad;    //!< reciprocal of la_grad, 65535 / la_grad
  int16_t la_l;         //!< index on the load axis
  int8_t  la_lp1;       //!< la_l + 1
  int8_t  la_f;         //!< index on the rpm axis
  int8_t  la_fp1;       //!< la_f + 1
+ uint16_t la_wf;       //!< position of RPM in the cell, (la_rpm - rpm_grid_points[la_f]) / cell size * 32768
+ uint16_t la_wl;       //!< position of load in the cell (from la_l to la_lp1), value * 32768
+ cell_rcp_t rc_f;      //!< cached reciprocal of the size of current cell on the RPM axis
+ cell_rcp_t rc_l;      //!< cached reciprocal of the size of current cell on the load axis
  //CLT args:
  int8_t  ta_i;         //!< index
  int8_t  ta_i1;        //!< index + 1
  int16_t ta_clt;       //!< temperature (CLT)
+ uint16_t ta_w;        //!< position of CLT in the cell, value * 32768
+ cell_rcp_t rc_t;      //!< cached reciprocal of the size of current cell on the CLT axis
 #ifndef SECU3T
  //GRTS args:
  int8_t  ga_i;         //!< index
  int8_t  ga_i1;        //!< index + 1
  int16_t ga_grt;       //!< temperature (GRTS)
+ uint16_t ga_w;        //!< position of GRTS in the cell, value * 32768
+ cell_rcp_t rc_g;      //!< cached reciprocal of the size of current cell on the GRTS axis
 #endif
  //precalculated values:
  int16_t vecurr;       //!< current value of VE (value * 2048)
  int16_t afrcurr;      //!< current value of AFR (value * 256)
+ //cache of corners of maps which use RPM/load grid:
+ int16_t lc[LC_NUM][4]; //!< corner values: [la_l][la_f], [la_lp1][la_f], [la_lp1][la_fp1], [la_l][la_fp1]
+ uint8_t lc_valid;     //!< bit mask of valid entries in lc[]
+ int8_t  lc_l;         //!< la_l for which cache has been filled
+ int8_t  lc_lp1;       //!< la_lp1 for which cache has been filled
+ int8_t  lc_f;         //!< la_f for which cache has been filled
+ f_data_t _PGM *lc_dat;//!< set of tables for which cache has been filled
+#ifdef REALTIME_TABLES
+ uint8_t lc_ram;       //!< memory (RAM or FLASH) for which cache has been filled
+#endif
  //AE decay:
  uint8_t  ae_decay_counter; //!< AE decay counter
  int16_t  aef_decay;        //!< AE factor value at the start of decay
@@ -105,6 +136,32 @@ typedef struct
 /**Instance of state variables*/
 fcs_t fcs = {0};
 
+void invalidate_lookup_cache(void)
+{
+ fcs.lc_valid = 0;
+}
+
+/** Stores corners of the current cell of specified map in the cache
+ * \param id Index of map in the cache (LC_XXX)
+ */
+static void lc_set(uint8_t id, int16_t a1, int16_t a2, int16_t a3, int16_t a4)
+{
+ fcs.lc[id][0] = a1;
+ fcs.lc[id][1] = a2;
+ fcs.lc[id][2] = a3;
+ fcs.lc[id][3] = a4;
+ SETBIT(fcs.lc_valid, id);
+}
+
+/** Interpolates value of specified map using cached corners and precalculated weights of RPM/load
+ * \param id Index of map in the cache (LC_XXX)
+ * \param m function multiplier
+ */
+static int16_t lc_interpolation(uint8_t id, uint8_t m)
+{
+ return bilinear_interpolation_w(fcs.lc[id][0], fcs.lc[id][1], fcs.lc[id][2], fcs.lc[id][3], fcs.la_wf, fcs.la_wl, m);
+}
+
 /* Calculates synthetic load values basing on MAP, TPS and TPS switch point table
  * Uses d ECU data structure
  * \return load value in % * 64 (0...100%)
@@ -150,18 +207,125 @@ static uint16_t calc_airflow(void)
 }
 #endif
 
+/**Maximum number of cells the axis search steps from the previously found cell, binary search is used on larger jumps */
+#define AXIS_SEARCH_STEPS 2
+
+/** Finds cell of the ascending axis which contains specified value. Search starts from the previously found cell,
+ * because state of engine changes slowly between iterations of the main loop, so usually only two points are read.
+ * \param p_pts Pointer to the points of axis (program memory), points must be in ascending order
+ * \param num Number of points
+ * \param x Value
+ * \param i Previously found index
+ * \return largest index in range 0...num-2 for which p_pts[index] <= x, or -1 if x < p_pts[0]
+ */
+static int8_t axis_search_asc(int16_t _PGM *p_pts, int8_t num, int16_t x, int8_t i)
+{
+ int8_t lo = -1, hi = num - 2, mid, steps = AXIS_SEARCH_STEPS;
+ if (i < lo || i > hi)
+  i = hi;
+
+ if (i < hi && x >= (int16_t)PGM_GET_WORD(&p_pts[i + 1]))
+ { //step up
+  do
+  {
+   if (!steps--)
+   {
+    lo = i + 1;
+    goto binary;
+   }
+   ++i;
+  }while(i < hi && x >= (int16_t)PGM_GET_WORD(&p_pts[i + 1]));
+ }
+ else
+ { //step down
+  while(i >= 0 && x < (int16_t)PGM_GET_WORD(&p_pts[i]))
+  {
+   if (!steps--)
+   {
+    hi = i - 1;
+    goto binary;
+   }
+   --i;
+  }
+ }
+ return i;
+
+binary: //value has jumped far from the previous cell
+ while(lo < hi)
+ {
+  mid = (lo + hi + 1) >> 1;
+  if (x >= (int16_t)PGM_GET_WORD(&p_pts[mid]))
+   lo = mid;
+  else
+   hi = mid - 1;
+ }
+ return lo;
+}
+
+/** Finds cell of the descending axis which contains specified value. Search starts from the previously found cell
+ * (see axis_search_asc()).
+ * \param p_pts Pointer to the points of axis (program memory), points must be in descending order
+ * \param num Number of points
+ * \param x Value, must not be less than p_pts[num-1]
+ * \param i Previously found index
+ * \return smallest index in range 1...num-1 for which p_pts[index] <= x
+ */
+static int8_t axis_search_desc(int16_t _PGM *p_pts, int8_t num, int16_t x, int8_t i)
+{
+ int8_t lo = 1, hi = num - 1, mid, steps = AXIS_SEARCH_STEPS;
+ if (i < lo || i > hi)
+  i = lo;
+
+ if (i > lo && x >= (int16_t)PGM_GET_WORD(&p_pts[i - 1]))
+ { //step towards beginning of axis
+  do
+  {
+   if (!steps--)
+   {
+    hi = i - 1;
+    goto binary;
+   }
+   --i;
+  }while(i > lo && x >= (int16_t)PGM_GET_WORD(&p_pts[i - 1]));
+ }
+ else
+ { //step towards end of axis
+  while(i < hi && x < (int16_t)PGM_GET_WORD(&p_pts[i]))
+  {
+   if (!steps--)
+   {
+    lo = i + 1;
+    goto binary;
+   }
+   ++i;
+  }
+ }
+ return i;
+
+binary: //value has jumped far from the previous cell
+ while(lo < hi)
+ {
+  mid = (lo + hi) >> 1;
+  if (x >= (int16_t)PGM_GET_WORD(&p_pts[mid]))
+   hi = mid;
+  else
+   lo = mid + 1;
+ }
+ return lo;
+}
+
 /**Calculates argument values needed for some 2d and 3d lookup tables. Fills la_x values in the fcs_t structure
  * Uses d ECU data structure
  * Note! This function must be called before any other function which expects precalculated results
  */
 void calc_lookup_args(void)
 {
+ int16_t l_pos, l_size;
  //-----------------------------------------
  fcs.la_rpm = d.sens.inst_frq;
 
  //find interpolation points, then restrict RPM if it fall outside set range
- for(fcs.la_f = F_WRK_POINTS_F-2; fcs.la_f >= 0; fcs.la_f--)
-  if (fcs.la_rpm >= PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f])) break;
+ fcs.la_f = axis_search_asc(fw_data.exdata.rpm_grid_points, F_WRK_POINTS_F, fcs.la_rpm, fcs.la_f);
 
  //lookup table works from rpm_grid_points[0] and upper
  if (fcs.la_f < 0)  {fcs.la_f = 0; fcs.la_rpm = PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[0]);}
@@ -185,10 +349,12 @@ void calc_lookup_args(void)
   if (fcs.la_load < PGM_GET_WORD(&fw_data.exdata.load_grid_points[F_WRK_POINTS_L-1]))
    fcs.la_load = PGM_GET_WORD(&fw_data.exdata.load_grid_points[F_WRK_POINTS_L-1]);
 
-  for(fcs.la_l = 1; fcs.la_l < F_WRK_POINTS_L; ++fcs.la_l)
-   if (fcs.la_load >= PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l])) break;
+  fcs.la_l = axis_search_desc(fw_data.exdata.load_grid_points, F_WRK_POINTS_L, fcs.la_load, fcs.la_l);
   fcs.la_lp1 = fcs.la_l - 1;
 
+  l_pos = fcs.la_load - PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l]);
+  l_size = PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_lp1]);
+
   //update air flow variable (find nearest point)
   if (fcs.la_load < (PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_lp1]) - (PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_lp1]) / 2)))
    d.airflow = (F_WRK_POINTS_L-1) - fcs.la_lp1;
@@ -202,18 +368,29 @@ void calc_lookup_args(void)
   if (fcs.la_load < 0) fcs.la_load = 0;
 
   //load_upper - value of the upper load, load_lower - value of the lower load
-  //todo: replace division by 1/x multiplication
-  fcs.la_grad = (get_load_upper() - d.param.load_lower) / (F_WRK_POINTS_L - 1); //divide by number of points on the load axis - 1
-  if (fcs.la_grad < 1)
-   fcs.la_grad = 1;  //exclude division by zero and negative value in case when upper pressure < lower pressure
+  l_size = get_load_upper() - d.param.load_lower;
+  if (l_size != fcs.la_range || !fcs.la_grad)
+  { //range has changed (parameters or barometric pressure), so recalculate size of cell and its reciprocal
+   fcs.la_range = l_size;
+   fcs.la_grad = l_size / (F_WRK_POINTS_L - 1); //divide by number of points on the load axis - 1
+   if (fcs.la_grad < 1)
+    fcs.la_grad = 1;  //exclude division by zero and negative value in case when upper pressure < lower pressure
+   fcs.la_rgrad = 65535U / fcs.la_grad;
+  }
 
-  fcs.la_l = (fcs.la_load / fcs.la_grad);
+  //la_load / la_grad, reciprocal is truncated, so quotient may be less by one
+  fcs.la_l = (((uint32_t)fcs.la_load) * fcs.la_rgrad) >> 16;
+  if ((fcs.la_load - (fcs.la_grad * fcs.la_l)) >= fcs.la_grad)
+   ++fcs.la_l;
 
   if (fcs.la_l >= (F_WRK_POINTS_L - 1))
    fcs.la_lp1 = fcs.la_l = F_WRK_POINTS_L - 1;
   else
    fcs.la_lp1 = fcs.la_l + 1;
 
+  l_pos = fcs.la_load - (fcs.la_grad * fcs.la_l);
+  l_size = fcs.la_grad;
+
   //update air flow variable (find nearest point)
   if (fcs.la_load < ((fcs.la_grad * fcs.la_lp1) - (fcs.la_grad / 2)))
    d.airflow = (F_WRK_POINTS_L+1) - fcs.la_lp1;
@@ -221,18 +398,39 @@ void calc_lookup_args(void)
    d.airflow = F_WRK_POINTS_L - fcs.la_lp1;
  }
 
+ //-----------------------------------------
+ //Weights of arguments, they are shared by all maps which use RPM/load grid. Divisions by cell sizes
+ //are replaced by multiplications by reciprocals, which are recalculated only when cell changes
+ fcs.la_wf = interpolation_weight(&fcs.rc_f, fcs.la_rpm - PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]), PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]));
+ fcs.la_wl = interpolation_weight(&fcs.rc_l, l_pos, l_size); //l_pos > l_size if load is out of range of the last cell (la_l = la_lp1)
+
+ //Corners are kept in the cache until cell or set of tables changes
+ if (fcs.lc_l != fcs.la_l || fcs.lc_lp1 != fcs.la_lp1 || fcs.lc_f != fcs.la_f || fcs.lc_dat != d.fn_dat
+#ifdef REALTIME_TABLES
+     || fcs.lc_ram != d.mm_ram
+#endif
+    )
+ {
+  fcs.lc_l = fcs.la_l, fcs.lc_lp1 = fcs.la_lp1, fcs.lc_f = fcs.la_f;
+  fcs.lc_dat = d.fn_dat;
+#ifdef REALTIME_TABLES
+  fcs.lc_ram = d.mm_ram;
+#endif
+  fcs.lc_valid = 0;
+ }
+
  //-----------------------------------------
  //Coolant temperature arguments:
  fcs.ta_clt = d.sens.temperat;
 
  //find interpolation points, then restrict CLT if it fall outside set range
- for(fcs.ta_i = F_TMP_POINTS-2; fcs.ta_i >= 0; fcs.ta_i--)
-  if (fcs.ta_clt >= ((int16_t)PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]))) break;
+ fcs.ta_i = axis_search_asc(fw_data.exdata.clt_grid_points, F_TMP_POINTS, fcs.ta_clt, fcs.ta_i);
 
  //lookup table works from clt_grid_points[0] and upper
  if (fcs.ta_i < 0)  {fcs.ta_i = 0; fcs.ta_clt = PGM_GET_WORD(&fw_data.exdata.clt_grid_points[0]);}
  if (fcs.ta_clt > ((int16_t)PGM_GET_WORD(&fw_data.exdata.clt_grid_points[F_TMP_POINTS-1]))) fcs.ta_clt = PGM_GET_WORD(&fw_data.exdata.clt_grid_points[F_TMP_POINTS-1]);
  fcs.ta_i1 = fcs.ta_i + 1;
+ fcs.ta_w = interpolation_weight(&fcs.rc_t, fcs.ta_clt - PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]));
 
 #if !defined(SECU3T) && defined(MCP3204)
  //-----------------------------------------
@@ -240,13 +438,13 @@ void calc_lookup_args(void)
  fcs.ga_grt = d.sens.grts;
 
  //find interpolation points, then restrict CLT if it fall outside set range
- for(fcs.ga_i = F_TMP_POINTS-2; fcs.ga_i >= 0; fcs.ga_i--)
-  if (fcs.ga_grt >= ((int16_t)PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ga_i]))) break;
+ fcs.ga_i = axis_search_asc(fw_data.exdata.clt_grid_points, F_TMP_POINTS, fcs.ga_grt, fcs.ga_i);
 
  //lookup table works from clt_grid_points[0] and upper
  if (fcs.ga_i < 0)  {fcs.ga_i = 0; fcs.ga_grt = PGM_GET_WORD(&fw_data.exdata.clt_grid_points[0]);}
  if (fcs.ga_grt > ((int16_t)PGM_GET_WORD(&fw_data.exdata.clt_grid_points[F_TMP_POINTS-1]))) fcs.ga_grt = PGM_GET_WORD(&fw_data.exdata.clt_grid_points[F_TMP_POINTS-1]);
  fcs.ga_i1 = fcs.ga_i + 1;
+ fcs.ga_w = interpolation_weight(&fcs.rc_g, fcs.ga_grt - PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ga_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ga_i]));
 #endif
 
 //-------------------------------------------
@@ -259,8 +457,7 @@ void calc_lookup_args(void)
 // Returns ignition timing value * 32 (2 * 16 = 32).
 int16_t idling_function(void)
 {
- return simple_interpolation(fcs.la_rpm, _GB(f_idl[fcs.la_f]), _GB(f_idl[fcs.la_fp1]),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]), PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]), 16);
+ return simple_interpolation_w(_GB(f_idl[fcs.la_f]), _GB(f_idl[fcs.la_fp1]), fcs.la_wf, 16);
 }
 
 
@@ -284,16 +481,13 @@ int16_t start_function(void)
 //        * 32, 2 * 16 = 32.
 int16_t work_function(void)
 {
- uint8_t use_grid = CHECKBIT(d.param.func_flags, FUNC_LDAX_GRID);
- return bilinear_interpolation(fcs.la_rpm, fcs.la_load,
+ if (!CHECKBIT(fcs.lc_valid, LC_WRK))
+  lc_set(LC_WRK,
         _GB(f_wrk[fcs.la_l][fcs.la_f]),
         _GB(f_wrk[fcs.la_lp1][fcs.la_f]),
         _GB(f_wrk[fcs.la_lp1][fcs.la_fp1]),
-        _GB(f_wrk[fcs.la_l][fcs.la_fp1]),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l]) : (fcs.la_grad * fcs.la_l),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_lp1]) : fcs.la_grad, 16);
+        _GB(f_wrk[fcs.la_l][fcs.la_fp1]));
+ return lc_interpolation(LC_WRK, 16);
 }
 
 //     (. )  
@@ -304,11 +498,9 @@ int16_t coolant_function(uint8_t mode)
   return 0;   //no correction if CLT sensor is turned off
 
  if (mode) //work mode
-  return simple_interpolation(fcs.ta_clt, _GB(f_tmp[fcs.ta_i]), _GB(f_tmp[fcs.ta_i1]),
-        PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16);
+  return simple_interpolation_w(_GB(f_tmp[fcs.ta_i]), _GB(f_tmp[fcs.ta_i1]), fcs.ta_w, 16);
  else //idling mode
-  return simple_interpolation(fcs.ta_clt, _GB(f_tmp_idl[fcs.ta_i]), _GB(f_tmp_idl[fcs.ta_i1]),
-        PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16);
+  return simple_interpolation_w(_GB(f_tmp_idl[fcs.ta_i]), _GB(f_tmp_idl[fcs.ta_i1]), fcs.ta_w, 16);
 }
 
 int16_t crkclt_function(void)
@@ -316,8 +508,7 @@ int16_t crkclt_function(void)
  if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_USE))
   return 0;   //no correction if CLT sensor is turned off
 
- return simple_interpolation(fcs.ta_clt, (int8_t)PGM_GET_BYTE(&fw_data.exdata.cts_crkcorr[fcs.ta_i]), (int8_t)PGM_GET_BYTE(&fw_data.exdata.cts_crkcorr[fcs.ta_i1]),
-        PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16);
+ return simple_interpolation_w((int8_t)PGM_GET_BYTE(&fw_data.exdata.cts_crkcorr[fcs.ta_i]), (int8_t)PGM_GET_BYTE(&fw_data.exdata.cts_crkcorr[fcs.ta_i1]), fcs.ta_w, 16);
 }
 
 //Idling regulator
@@ -494,27 +685,14 @@ uint16_t accumulation_time(uint8_t mode)
 #endif
 
 #if defined(THERMISTOR_CS) || defined(AIRTEMP_SENS) || !defined(SECU3T)
-int16_t thermistor_lookup(uint16_t adcvalue, int16_t _PGM *lutab)
+int16_t thermistor_lookup(uint16_t adcvalue, int16_t _PGM *lutab, uint8_t id)
 {
- int16_t i, i1;
-
- //Voltage value at the start of axis in ADC discretes
- uint16_t v_start = PGM_GET_WORD(&lutab[THERMISTOR_LOOKUP_TABLE_SIZE]);
- //Voltage value at the end of axis in ADC discretes
- uint16_t v_end = PGM_GET_WORD(&lutab[THERMISTOR_LOOKUP_TABLE_SIZE+1]);
-
- uint16_t v_step = (v_end - v_start) / (THERMISTOR_LOOKUP_TABLE_SIZE - 1);
+ static uaxis_t ax[TLA_NUM];  //each sensor has its own curve
 
- if (adcvalue < v_start)
-  adcvalue = v_start;
+ //Voltage values at the start and at the end of axis in ADC discretes
+ uaxis_lookup(&ax[id], adcvalue, PGM_GET_WORD(&lutab[THERMISTOR_LOOKUP_TABLE_SIZE]), PGM_GET_WORD(&lutab[THERMISTOR_LOOKUP_TABLE_SIZE+1]), THERMISTOR_LOOKUP_TABLE_SIZE);
 
- i = (adcvalue - v_start) / v_step;
-
- if (i >= THERMISTOR_LOOKUP_TABLE_SIZE-1) i = i1 = THERMISTOR_LOOKUP_TABLE_SIZE-1;
- else i1 = i + 1;
-
- return (simple_interpolation(adcvalue, (int16_t)PGM_GET_WORD(&lutab[i]), (int16_t)PGM_GET_WORD(&lutab[i1]), //<--values in table are signed
-        (i * v_step) + v_start, v_step, 16)) >> 4;
+ return (simple_interpolation_w((int16_t)PGM_GET_WORD(&lutab[ax[id].i]), (int16_t)PGM_GET_WORD(&lutab[ax[id].i1]), ax[id].w, 16)) >> 4; //<--values in table are signed
 }
 #endif
 
@@ -615,37 +793,32 @@ uint16_t inj_cranking_pw(void)
  if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_USE))
   return 1000;   //coolant temperature sensor is not enabled, default is 3.2mS
 
- return simple_interpolation(fcs.ta_clt, _GWU(inj_cranking[fcs.ta_i]), _GWU(inj_cranking[fcs.ta_i1]),  //<--values in table are unsigned
-        PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 1) /*>> 0*/;
+ return simple_interpolation_w(_GWU(inj_cranking[fcs.ta_i]), _GWU(inj_cranking[fcs.ta_i1]), fcs.ta_w, 1) /*>> 0*/;  //<--values in table are unsigned
 }
 
 void calc_ve_afr(void)
 {
- uint8_t use_grid = CHECKBIT(d.param.func_flags, FUNC_LDAX_GRID);
  if (d.sens.carb || (!d.sens.gas && !PGM_GET_WORD(&fw_data.exdata.idl_ve)) || (d.sens.gas && !PGM_GET_WORD(&fw_data.exdata.idl_ve_g)))
-  //look into VE table
-  fcs.vecurr = bilinear_interpolation(fcs.la_rpm, fcs.la_load,
+ { //look into VE table
+  if (!CHECKBIT(fcs.lc_valid, LC_VE))
+   lc_set(LC_VE,
         _GWU12(inj_ve,fcs.la_l,fcs.la_f),   //values in table are unsigned (12-bit!)
         _GWU12(inj_ve,fcs.la_lp1,fcs.la_f),
         _GWU12(inj_ve,fcs.la_lp1,fcs.la_fp1),
-        _GWU12(inj_ve,fcs.la_l,fcs.la_fp1),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l]) : (fcs.la_grad * fcs.la_l),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_l]) : fcs.la_grad, 8) >> 3;
+        _GWU12(inj_ve,fcs.la_l,fcs.la_fp1));
+  fcs.vecurr = lc_interpolation(LC_VE, 8) >> 3;
+ }
  else
   fcs.vecurr = d.sens.gas ? PGM_GET_WORD(&fw_data.exdata.idl_ve_g) : PGM_GET_WORD(&fw_data.exdata.idl_ve);
 
  //look into AFR table
- fcs.afrcurr = bilinear_interpolation(fcs.la_rpm, fcs.la_load,
+ if (!CHECKBIT(fcs.lc_valid, LC_AFR))
+  lc_set(LC_AFR,
         _GBU(inj_afr[fcs.la_l][fcs.la_f]),  //values in table are unsigned
         _GBU(inj_afr[fcs.la_lp1][fcs.la_f]),
         _GBU(inj_afr[fcs.la_lp1][fcs.la_fp1]),
-        _GBU(inj_afr[fcs.la_l][fcs.la_fp1]),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l]) : (fcs.la_grad * fcs.la_l),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_l]) : fcs.la_grad, 16);
+        _GBU(inj_afr[fcs.la_l][fcs.la_fp1]));
+ fcs.afrcurr = lc_interpolation(LC_AFR, 16);
  fcs.afrcurr+=(8*256);
 
  d.corr.afr = fcs.afrcurr >> 1; //update value of AFR
@@ -658,35 +831,12 @@ void calc_ve_afr(void)
  */
 static int16_t inj_corrected_mat(void)
 {
- int16_t i, i1; uint16_t x = d.sens.rxlaf;
- //x contains value of air flow * 32
-
- //air flow value at the start of axis
- uint16_t x_start = _GWU(inj_iatclt_corr[INJ_IATCLT_CORR_SIZE]);
- //air flow value at the end of axis
- uint16_t x_end = _GWU(inj_iatclt_corr[INJ_IATCLT_CORR_SIZE+1]);
-
- //additionally divide x by 2, because simple_interpolation is limited to 32767
- x = x >> 1;
- x_start = x_start >> 1;
- x_end = x_end >> 1;
-
- uint16_t x_step = (x_end - x_start) / (INJ_IATCLT_CORR_SIZE - 1);
-
- if (x < x_start)
-  x = x_start;
-
+ static uaxis_t ax;
+ //x contains value of air flow * 32, air flow values at the start and at the end of axis are in the table
+ //additionally divide values by 2, because step of axis is limited to 32767
  uint16_t coeff = 0;
- if (x_step > 0)
- {
-  i = (x - x_start) / x_step;
-
-  if (i >= INJ_IATCLT_CORR_SIZE-1) i = i1 = INJ_IATCLT_CORR_SIZE-1;
-  else i1 = i + 1;
-
-  coeff = (simple_interpolation(x, _GWU(inj_iatclt_corr[i]), _GWU(inj_iatclt_corr[i1]), //<--values in table are unsigned
-          (i * x_step) + x_start, x_step, 2));
- }
+ if (uaxis_lookup(&ax, d.sens.rxlaf >> 1, _GWU(inj_iatclt_corr[INJ_IATCLT_CORR_SIZE]) >> 1, _GWU(inj_iatclt_corr[INJ_IATCLT_CORR_SIZE+1]) >> 1, INJ_IATCLT_CORR_SIZE))
+  coeff = simple_interpolation_w(_GWU(inj_iatclt_corr[ax.i]), _GWU(inj_iatclt_corr[ax.i1]), ax.w, 2); //<--values in table are unsigned
 
  //Corrected MAT = (CLT - IAT) * coefficient(load*rpm) + IAT,
  //at this point coefficient is multiplied by 16384
@@ -734,7 +884,7 @@ uint16_t inj_base_pw(void)
  pw32 = (pw32 * fcs.vecurr) >> 11;
 
  //apply AFR
- pw32=(pw32 * nr_1x_afr(fcs.afrcurr << 2)) >> 15; //apply AFR table
+ pw32=(pw32 * afr_reciprocal(fcs.afrcurr << 2)) >> 15; //apply AFR table
 
  //return restricted value (16 bit)
  return ((pw32 > 65535) ? 65535 : pw32);
@@ -742,16 +892,14 @@ uint16_t inj_base_pw(void)
 
 int16_t inj_timing_lookup(void)
 {
- uint8_t use_grid = CHECKBIT(d.param.func_flags, FUNC_LDAX_GRID);
- int16_t it = bilinear_interpolation(fcs.la_rpm, fcs.la_load,
+ int16_t it;
+ if (!CHECKBIT(fcs.lc_valid, LC_INJTIM))
+  lc_set(LC_INJTIM,
         _GWU12(inj_timing,fcs.la_l,fcs.la_f),
         _GWU12(inj_timing,fcs.la_lp1,fcs.la_f),
         _GWU12(inj_timing,fcs.la_lp1,fcs.la_fp1),
-        _GWU12(inj_timing,fcs.la_l,fcs.la_fp1),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l]) : (fcs.la_grad * fcs.la_l),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_l]) : fcs.la_grad, 8);
+        _GWU12(inj_timing,fcs.la_l,fcs.la_fp1));
+ it = lc_interpolation(LC_INJTIM, 8);
  if (it > ROUND(720.0*16))
   it-=ROUND(720.0*16);
  return (it << 1);
@@ -813,8 +961,7 @@ uint8_t inj_aftstr_en(void)
  if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_USE))
   return 0;   //coolant temperature sensor is not enabled (or not installed), no afterstart enrichment
 
- return simple_interpolation(fcs.ta_clt, _GBU(inj_aftstr[fcs.ta_i]), _GBU(inj_aftstr[fcs.ta_i1]),  //<--values in table are unsigned
-        PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16) >> 4;
+ return simple_interpolation_w(_GBU(inj_aftstr[fcs.ta_i]), _GBU(inj_aftstr[fcs.ta_i1]), fcs.ta_w, 16) >> 4;  //<--values in table are unsigned
 }
 
 uint8_t inj_warmup_en(void)
@@ -822,8 +969,7 @@ uint8_t inj_warmup_en(void)
  if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_USE))
   return 128;   //coolant temperature sensor is not enabled (or not installed), no warmup enrichment
 
- return simple_interpolation(fcs.ta_clt, _GBU(inj_warmup[fcs.ta_i]), _GBU(inj_warmup[fcs.ta_i1]),  //<--values in table are unsigned
-        PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16) >> 4;
+ return simple_interpolation_w(_GBU(inj_warmup[fcs.ta_i]), _GBU(inj_warmup[fcs.ta_i1]), fcs.ta_w, 16) >> 4;  //<--values in table are unsigned
 }
 
 int16_t inj_ae_tps_lookup(int16_t tpsdot)
@@ -924,55 +1070,19 @@ uint16_t inj_idlreg_rigidity(uint16_t targ_map, uint16_t targ_rpm)
 
 uint16_t inj_iacmixtcorr_lookup(void)
 {
- int16_t i, i1, x = d.choke_pos << 6; //value * 128
-
- //IAC pos. value at the start of axis
- uint16_t x_start = _GW(inj_iac_corr[INJ_IAC_CORR_SIZE]);
- //IAC pos. value at the end of axis
- uint16_t x_end = _GW(inj_iac_corr[INJ_IAC_CORR_SIZE+1]);
-
- uint16_t x_step = (x_end - x_start) / (INJ_IAC_CORR_SIZE - 1);
-
- if (x < x_start)
-  x = x_start;
+ static uaxis_t ax, ax_w;
 
+ //IAC pos. (value * 128) values at the start and at the end of axis are in the table
  int16_t corr = 0;
- if (x_step > 0)
- {
-  i = (x - x_start) / x_step;
-
-  if (i >= INJ_IAC_CORR_SIZE-1) i = i1 = INJ_IAC_CORR_SIZE-1;
-  else i1 = i + 1;
-
-  corr = (simple_interpolation(x, _GW(inj_iac_corr[i]), _GW(inj_iac_corr[i1]), //<--values in table are unsigned
-         (i * x_step) + x_start, x_step, 2)) >> 1;
- }
+ if (uaxis_lookup(&ax, d.choke_pos << 6, _GW(inj_iac_corr[INJ_IAC_CORR_SIZE]), _GW(inj_iac_corr[INJ_IAC_CORR_SIZE+1]), INJ_IAC_CORR_SIZE))
+  corr = (simple_interpolation_w(_GW(inj_iac_corr[ax.i]), _GW(inj_iac_corr[ax.i1]), ax.w, 2)) >> 1; //<--values in table are unsigned
 
  //Calculate weight coefficient:
 
- x = d.sens.tps << 6; //value * 128
-
- //IAC pos. value at the start of axis
- x_start = (_GBU(inj_iac_corr_w[INJ_IAC_CORR_W_SIZE])) << 6;
- //IAC pos. value at the end of axis
- x_end = (_GBU(inj_iac_corr_w[INJ_IAC_CORR_W_SIZE+1])) << 6;
-
- x_step = (x_end - x_start) / (INJ_IAC_CORR_W_SIZE - 1);
-
- if (x < x_start)
-  x = x_start;
-
+ //TPS (value * 128) values at the start and at the end of axis are in the table
  uint16_t corr_w = 0;
- if (x_step > 0)
- {
-  i = (x - x_start) / x_step;
-
-  if (i >= INJ_IAC_CORR_W_SIZE-1) i = i1 = INJ_IAC_CORR_W_SIZE-1;
-  else i1 = i + 1;
-
-  corr_w = (simple_interpolation(x, _GBU(inj_iac_corr_w[i]), _GBU(inj_iac_corr_w[i1]), //<--values in table are unsigned
-          (i * x_step) + x_start, x_step, 32));
- }
+ if (uaxis_lookup(&ax_w, d.sens.tps << 6, (_GBU(inj_iac_corr_w[INJ_IAC_CORR_W_SIZE])) << 6, (_GBU(inj_iac_corr_w[INJ_IAC_CORR_W_SIZE+1])) << 6, INJ_IAC_CORR_W_SIZE))
+  corr_w = simple_interpolation_w(_GBU(inj_iac_corr_w[ax_w.i]), _GBU(inj_iac_corr_w[ax_w.i1]), ax_w.w, 32); //<--values in table are unsigned
 
  //calculate final value
  return 8192 + (int16_t)(((int32_t)corr * corr_w) >> (8+5));
@@ -986,39 +1096,24 @@ uint16_t inj_idling_rpm(void)
  if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_USE))
   return 900;   //coolant temperature sensor is not enabled (or not installed)
 
- return (simple_interpolation(fcs.ta_clt, _GBU(inj_target_rpm[fcs.ta_i]), _GBU(inj_target_rpm[fcs.ta_i1]),  //<--values in table are unsigned
-         PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16) >> 4) * 10;
+ return (simple_interpolation_w(_GBU(inj_target_rpm[fcs.ta_i]), _GBU(inj_target_rpm[fcs.ta_i1]), fcs.ta_w, 16) >> 4) * 10;  //<--values in table are unsigned
 }
 #endif
 
 uint16_t tpsswt_function(void)
 {
- return simple_interpolation(fcs.la_rpm, _GB(inj_tpsswt[fcs.la_f]), _GB(inj_tpsswt[fcs.la_fp1]),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]), PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]), 16) >> 4;
+ return simple_interpolation_w(_GB(inj_tpsswt[fcs.la_f]), _GB(inj_tpsswt[fcs.la_fp1]), fcs.la_wf, 16) >> 4;
 }
 
 #ifdef PA4_INP_IGNTIM
 int16_t pa4_function(uint16_t adcvalue)
 {
- int16_t i, i1;
-
- //Voltage value at the start of axis in ADC discretes
- uint16_t v_start = ROUND(0.00 / ADC_DISCRETE);
- //Voltage value at the end of axis in ADC discretes
- uint16_t v_end = ROUND(5.00 / ADC_DISCRETE);
-
- uint16_t v_step = (v_end - v_start) / (PA4_LOOKUP_TABLE_SIZE - 1);
-
- if (adcvalue < v_start)
-  adcvalue = v_start;
+ static uaxis_t ax;
 
- i = (adcvalue - v_start) / v_step;
+ //Voltage values at the start and at the end of axis in ADC discretes
+ uaxis_lookup(&ax, adcvalue, ROUND(0.00 / ADC_DISCRETE), ROUND(5.00 / ADC_DISCRETE), PA4_LOOKUP_TABLE_SIZE);
 
- if (i >= PA4_LOOKUP_TABLE_SIZE-1) i = i1 = PA4_LOOKUP_TABLE_SIZE-1;
- else i1 = i + 1;
-
- return  simple_interpolation(adcvalue, (int8_t)PGM_GET_BYTE(&fw_data.exdata.pa4_igntim_corr[i]), (int8_t)PGM_GET_BYTE(&fw_data.exdata.pa4_igntim_corr[i1]), //<--values in table are signed
-        (i * v_step) + v_start, v_step, 16);
+ return simple_interpolation_w((int8_t)PGM_GET_BYTE(&fw_data.exdata.pa4_igntim_corr[ax.i]), (int8_t)PGM_GET_BYTE(&fw_data.exdata.pa4_igntim_corr[ax.i1]), ax.w, 16); //<--values in table are signed
 }
 
 #endif //PA4_INP_IGNTIM
@@ -1033,7 +1128,7 @@ uint16_t gd_ve_afr(void)
 
  corr=(corr * ((uint16_t)d.param.gd_lambda_stoichval)) >> 7; // multiply by stoichiometry AFR value specified by user
 
- corr=(corr * nr_1x_afr(fcs.afrcurr << 2)) >> 15;  //apply AFR value
+ corr=(corr * afr_reciprocal(fcs.afrcurr << 2)) >> 15;  //apply AFR value
 
  return corr; //return correction value * 2048
 }
@@ -1044,23 +1139,25 @@ uint16_t gd_ve_afr(void)
  */
 int16_t gdp_function(void)
 {
- int16_t tps = (TPS_MAGNITUDE(100.0) - d.sens.tps) * 16;
+ int16_t tps = (TPS_MAGNITUDE(100.0) - d.sens.tps) * 16;  //note that tps is additionally multiplied by 16
  int8_t t = (tps / TPS_AXIS_STEP), tp1;
+ int16_t t_pos;
 
  if (t >= (GASDOSE_POS_TPS_SIZE - 1))
   tp1 = t = GASDOSE_POS_TPS_SIZE - 1;
  else
   tp1 = t + 1;
 
- return bilinear_interpolation(fcs.la_rpm, tps,  //note that tps is additionally multiplied by 16
+ t_pos = tps - (TPS_AXIS_STEP*t);
+ if (t_pos > TPS_AXIS_STEP)
+  t_pos = TPS_AXIS_STEP;
+
+ return bilinear_interpolation_w(  //use weight of RPM precalculated in calc_lookup_args()
         PGM_GET_BYTE(&fw_data.exdata.gasdose_pos[t][fcs.la_f]),
         PGM_GET_BYTE(&fw_data.exdata.gasdose_pos[tp1][fcs.la_f]),
         PGM_GET_BYTE(&fw_data.exdata.gasdose_pos[tp1][fcs.la_fp1]),
         PGM_GET_BYTE(&fw_data.exdata.gasdose_pos[t][fcs.la_fp1]),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]),
-        (TPS_AXIS_STEP*t),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]),
-        TPS_AXIS_STEP, 16) >> 4;
+        fcs.la_wf, (((uint32_t)t_pos) << 15) / TPS_AXIS_STEP, 16) >> 4;
 }
 
 #endif //GD_CONTROL
@@ -1069,25 +1166,12 @@ int16_t gdp_function(void)
 #if defined(FUEL_INJECT) || defined(CARB_AFR) || defined(GD_CONTROL)
 int16_t ego_curve_lookup(void)
 {
- int16_t i, i1, voltage = d.sens.lambda1; /*d.sens.inst_add_i1*/
-
- //Voltage value at the start of axis in ADC discretes
- uint16_t v_start = _GWU(inj_ego_curve[INJ_EGO_CURVE_SIZE]);
- //Voltage value at the end of axis in ADC discretes
- uint16_t v_end = _GWU(inj_ego_curve[INJ_EGO_CURVE_SIZE+1]);
+ static uaxis_t ax;
 
- uint16_t v_step = (v_end - v_start) / (INJ_EGO_CURVE_SIZE - 1);
+ //Voltage values at the start and at the end of axis in ADC discretes are in the table
+ uaxis_lookup(&ax, d.sens.lambda1 /*d.sens.inst_add_i1*/, _GWU(inj_ego_curve[INJ_EGO_CURVE_SIZE]), _GWU(inj_ego_curve[INJ_EGO_CURVE_SIZE+1]), INJ_EGO_CURVE_SIZE);
 
- if (voltage < v_start)
-  voltage = v_start;
-
- i = (voltage - v_start) / v_step;
-
- if (i >= INJ_EGO_CURVE_SIZE-1) i = i1 = INJ_EGO_CURVE_SIZE-1;
- else i1 = i + 1;
-
- return (simple_interpolation(voltage, _GWU(inj_ego_curve[i]), _GWU(inj_ego_curve[i1]), //<--values in table are unsigned
-        (i * v_step) + v_start, v_step, 4)) >> 2;
+ return (simple_interpolation_w(_GWU(inj_ego_curve[ax.i]), _GWU(inj_ego_curve[ax.i1]), ax.w, 4)) >> 2; //<--values in table are unsigned
 }
 #endif
 
@@ -1117,25 +1201,12 @@ uint8_t scale_aftstr_enrich(uint16_t enrich_counter)
 
 int16_t barocorr_lookup(void)
 {
- int16_t i, i1, press = d.sens.baro_press;
-
- //Pressure value at the start of axis
- uint16_t p_start = PGM_GET_WORD(&fw_data.exdata.barocorr[BAROCORR_SIZE]);
- //Pressure value at the end of axis
- uint16_t p_end = PGM_GET_WORD(&fw_data.exdata.barocorr[BAROCORR_SIZE+1]);
-
- uint16_t p_step = (p_end - p_start) / (BAROCORR_SIZE - 1);
-
- if (press < p_start)
-  press = p_start;
+ static uaxis_t ax;
 
- i = (press - p_start) / p_step;
+ //Pressure values at the start and at the end of axis are in the table
+ uaxis_lookup(&ax, d.sens.baro_press, PGM_GET_WORD(&fw_data.exdata.barocorr[BAROCORR_SIZE]), PGM_GET_WORD(&fw_data.exdata.barocorr[BAROCORR_SIZE+1]), BAROCORR_SIZE);
 
- if (i >= BAROCORR_SIZE-1) i = i1 = BAROCORR_SIZE-1;
- else i1 = i + 1;
-
- return (simple_interpolation(press, (int16_t)PGM_GET_WORD(&fw_data.exdata.barocorr[i]), (int16_t)PGM_GET_WORD(&fw_data.exdata.barocorr[i1]), //<--values in table are signed
-        (i * p_step) + p_start, p_step, 4)) >> 2;
+ return (simple_interpolation_w((int16_t)PGM_GET_WORD(&fw_data.exdata.barocorr[ax.i]), (int16_t)PGM_GET_WORD(&fw_data.exdata.barocorr[ax.i1]), ax.w, 4)) >> 2; //<--values in table are signed
 }
 
 
@@ -1195,32 +1266,16 @@ uint8_t inj_gts_pwcorr(void)
 
 uint8_t inj_gps_pwcorr(void)
 {
- int16_t i, i1, p = CHECKBIT(d.param.inj_flags, INJFLG_USEDIFFPRESS) ? (d.sens.map2 - d.sens.map) : d.sens.map2;
+ static uaxis_t ax;
+ int16_t p = CHECKBIT(d.param.inj_flags, INJFLG_USEDIFFPRESS) ? (d.sens.map2 - d.sens.map) : d.sens.map2;
 
  if (!IOCFG_CHECK(IOP_MAP2))
   return 128;   //do not use correcton if gas pressure sensor is turned off
 
- //Pressure value at the start of axis
- uint16_t p_start = ((uint16_t)_GBU(inj_gps_corr[INJ_GPS_CORR_SIZE])) * (2 * 64);
- //Pressure value at the end of axis
- uint16_t p_end = ((uint16_t)_GBU(inj_gps_corr[INJ_GPS_CORR_SIZE+1])) * (2 * 64);
-
- uint16_t p_step = (p_end - p_start) / (INJ_GPS_CORR_SIZE - 1);
-
- if (p < p_start)
-  p = p_start;
-
+ //Pressure values at the start and at the end of axis are in the table
  uint8_t coeff = 128; //1.0
- if (p_step > 0)
- {
-  i = (p - p_start) / p_step;
-
-  if (i >= INJ_GPS_CORR_SIZE-1) i = i1 = INJ_GPS_CORR_SIZE-1;
-  else i1 = i + 1;
-
-  coeff = (simple_interpolation(p, _GBU(inj_gps_corr[i]), _GBU(inj_gps_corr[i1]), //<--values in table are unsigned
-          (i * p_step) + p_start, p_step, 64)) >> 6;
- }
+ if (uaxis_lookup(&ax, p, ((uint16_t)_GBU(inj_gps_corr[INJ_GPS_CORR_SIZE])) * (2 * 64), ((uint16_t)_GBU(inj_gps_corr[INJ_GPS_CORR_SIZE+1])) * (2 * 64), INJ_GPS_CORR_SIZE))
+  coeff = (simple_interpolation_w(_GBU(inj_gps_corr[ax.i]), _GBU(inj_gps_corr[ax.i1]), ax.w, 64)) >> 6; //<--values in table are unsigned
  return coeff;
 }
 #endif
@@ -1244,7 +1299,7 @@ int32_t acc_enrich_calc(uint8_t mode, int16_t stoich_val)
 {
  //calculate normal conditions PW, MAP=100kPa, IAT=20.C, AFR=14.7 (petrol) or d.param.gd_lambda_stoichval (gas).
  //For AFR=14.7 and inj_sd_igl_const=86207 we should get result near to 2000.48
- int32_t pwnc = mode ? GD_MAGNITUDE(100.0) : ((((((uint32_t)PWNC_CONST) * nr_1x_afr(stoich_val << 3)) >> 12) * d.param.inj_sd_igl_const[d.sens.gas]) >> 15);
+ int32_t pwnc = mode ? GD_MAGNITUDE(100.0) : ((((((uint32_t)PWNC_CONST) * afr_reciprocal(stoich_val << 3)) >> 12) * d.param.inj_sd_igl_const[d.sens.gas]) >> 15);
  int16_t aef = inj_ae_tps_lookup(d.sens.tpsdot);               //calculate basic AE factor value
 
  if (abs(d.sens.tpsdot) < d.param.inj_ae_tpsdot_thrd)
@@ -1284,8 +1339,7 @@ uint16_t cranking_thrd_rpm(void)
  if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_USE))
   return d.param.starter_off;   //coolant temperature sensor is not enabled (or not installed), use simple constant
 
- return (simple_interpolation(fcs.ta_clt, PGM_GET_BYTE(&fw_data.exdata.cranking_thrd[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.cranking_thrd[fcs.ta_i1]),  //<--values in table are unsigned
-         PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16) >> 4) * 10;
+ return (simple_interpolation_w(PGM_GET_BYTE(&fw_data.exdata.cranking_thrd[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.cranking_thrd[fcs.ta_i1]), fcs.ta_w, 16) >> 4) * 10;  //<--values in table are unsigned
 }
 
 uint16_t cranking_thrd_tmr(void)
@@ -1293,8 +1347,7 @@ uint16_t cranking_thrd_tmr(void)
  if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_USE))
   return PGM_GET_BYTE(&fw_data.exdata.stbl_str_cnt);   //coolant temperature sensor is not enabled (or not installed), use simple constant
 
- return (simple_interpolation(fcs.ta_clt, PGM_GET_BYTE(&fw_data.exdata.cranking_time[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.cranking_time[fcs.ta_i1]),  //<--values in table are unsigned
-         PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16) >> 4) * 10;
+ return (simple_interpolation_w(PGM_GET_BYTE(&fw_data.exdata.cranking_time[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.cranking_time[fcs.ta_i1]), fcs.ta_w, 16) >> 4) * 10;  //<--values in table are unsigned
 }
 
 uint16_t smapaban_thrd_rpm(void)
@@ -1302,8 +1355,7 @@ uint16_t smapaban_thrd_rpm(void)
  if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_USE))
   return d.param.smap_abandon;   //coolant temperature sensor is not enabled (or not installed). use simple constant
 
- return (simple_interpolation(fcs.ta_clt, PGM_GET_BYTE(&fw_data.exdata.smapaban_thrd[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.smapaban_thrd[fcs.ta_i1]),  //<--values in table are unsigned
-         PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16) >> 4) * 10;
+ return (simple_interpolation_w(PGM_GET_BYTE(&fw_data.exdata.smapaban_thrd[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.smapaban_thrd[fcs.ta_i1]), fcs.ta_w, 16) >> 4) * 10;  //<--values in table are unsigned
 }
 
 #ifdef _PLATFORM_M1284_
@@ -1334,27 +1386,26 @@ uint8_t knock_zone_val(void)
 
 uint16_t pwm_function(uint8_t mode)
 {
- uint8_t use_grid = CHECKBIT(d.param.func_flags, FUNC_LDAX_GRID);
  if (0==mode)
- return bilinear_interpolation(fcs.la_rpm, fcs.la_load,
+ {
+  if (!CHECKBIT(fcs.lc_valid, LC_PWM1))
+   lc_set(LC_PWM1,
         _GBU(pwm_duty1[fcs.la_l][fcs.la_f]),   //<-- values are unsigned
         _GBU(pwm_duty1[fcs.la_lp1][fcs.la_f]),
         _GBU(pwm_duty1[fcs.la_lp1][fcs.la_fp1]),
-        _GBU(pwm_duty1[fcs.la_l][fcs.la_fp1]),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l]) : (fcs.la_grad * fcs.la_l),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_l]) : fcs.la_grad, 64) >> 6;
+        _GBU(pwm_duty1[fcs.la_l][fcs.la_fp1]));
+  return lc_interpolation(LC_PWM1, 64) >> 6;
+ }
  else
- return bilinear_interpolation(fcs.la_rpm, fcs.la_load,
+ {
+  if (!CHECKBIT(fcs.lc_valid, LC_PWM2))
+   lc_set(LC_PWM2,
         _GBU(pwm_duty2[fcs.la_l][fcs.la_f]),   //<-- values are unsigned
         _GBU(pwm_duty2[fcs.la_lp1][fcs.la_f]),
         _GBU(pwm_duty2[fcs.la_lp1][fcs.la_fp1]),
-        _GBU(pwm_duty2[fcs.la_l][fcs.la_fp1]),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l]) : (fcs.la_grad * fcs.la_l),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_l]) : fcs.la_grad, 64) >> 6;
+        _GBU(pwm_duty2[fcs.la_l][fcs.la_fp1]));
+  return lc_interpolation(LC_PWM2, 64) >> 6;
+ }
 }
 
 #ifdef SPLIT_ANGLE
@@ -1362,24 +1413,20 @@ uint16_t pwm_function(uint8_t mode)
 // Returns anvance angle value * 32, 2 * 16 = 32.
 int16_t split_function(void)
 {
- uint8_t use_grid = CHECKBIT(d.param.func_flags, FUNC_LDAX_GRID);
- return bilinear_interpolation(fcs.la_rpm, fcs.la_load,
+ if (!CHECKBIT(fcs.lc_valid, LC_SPLIT))
+  lc_set(LC_SPLIT,
         _GB(pwm_duty1[fcs.la_l][fcs.la_f]),   //<-- values are signed
         _GB(pwm_duty1[fcs.la_lp1][fcs.la_f]),
         _GB(pwm_duty1[fcs.la_lp1][fcs.la_fp1]),
-        _GB(pwm_duty1[fcs.la_l][fcs.la_fp1]),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_points[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_points[fcs.la_l]) : (fcs.la_grad * fcs.la_l),
-        PGM_GET_WORD(&fw_data.exdata.rpm_grid_sizes[fcs.la_f]),
-        use_grid ? PGM_GET_WORD(&fw_data.exdata.load_grid_sizes[fcs.la_l]) : fcs.la_grad, 16);
+        _GB(pwm_duty1[fcs.la_l][fcs.la_fp1]));
+ return lc_interpolation(LC_SPLIT, 16);
 }
 #endif
 
 #ifndef SECU3T
 uint8_t grheat_pwm_duty(void)
 {
- return simple_interpolation(fcs.ga_grt, PGM_GET_BYTE(&fw_data.exdata.grheat_duty[fcs.ga_i]), PGM_GET_BYTE(&fw_data.exdata.grheat_duty[fcs.ga_i1]),
-        PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ga_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ga_i]), 16) >> 4;
+ return simple_interpolation_w(PGM_GET_BYTE(&fw_data.exdata.grheat_duty[fcs.ga_i]), PGM_GET_BYTE(&fw_data.exdata.grheat_duty[fcs.ga_i1]), fcs.ga_w, 16) >> 4;
 }
 
 uint16_t grv_delay(void)
@@ -1416,16 +1463,14 @@ uint16_t aftstr_strokes(uint8_t mode)
  if (mode)
  { //gas
   if (0==d.param.inj_aftstr_strokes1)
-   return simple_interpolation(fcs.ta_clt, PGM_GET_BYTE(&fw_data.exdata.inj_aftstr_strk1[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.inj_aftstr_strk1[fcs.ta_i1]),  //<--values in table are unsigned
-         PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16) >> 4;
+   return simple_interpolation_w(PGM_GET_BYTE(&fw_data.exdata.inj_aftstr_strk1[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.inj_aftstr_strk1[fcs.ta_i1]), fcs.ta_w, 16) >> 4;  //<--values in table are unsigned
   else
    return ((uint16_t)d.param.inj_aftstr_strokes1) << 2;
  }
  else
  { //petrol
   if (0==d.param.inj_aftstr_strokes)
-   return simple_interpolation(fcs.ta_clt, PGM_GET_BYTE(&fw_data.exdata.inj_aftstr_strk0[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.inj_aftstr_strk0[fcs.ta_i1]),  //<--values in table are unsigned
-         PGM_GET_WORD(&fw_data.exdata.clt_grid_points[fcs.ta_i]), PGM_GET_WORD(&fw_data.exdata.clt_grid_sizes[fcs.ta_i]), 16) >> 4;
+   return simple_interpolation_w(PGM_GET_BYTE(&fw_data.exdata.inj_aftstr_strk0[fcs.ta_i]), PGM_GET_BYTE(&fw_data.exdata.inj_aftstr_strk0[fcs.ta_i1]), fcs.ta_w, 16) >> 4;  //<--values in table are unsigned
   else
    return ((uint16_t)d.param.inj_aftstr_strokes) << 2;
  }
@@ -99,12 +99,20 @@ uint16_t accumulation_time(uint8_t mode);
 #endif
 
 #if defined(THERMISTOR_CS) || defined(AIRTEMP_SENS) || !defined(SECU3T)
+//Identifiers of the thermistor curves (each curve has its own cached axis)
+#define TLA_CTS        0    //!< coolant temperature sensor
+#define TLA_ATS        1    //!< intake air temperature sensor
+#define TLA_TMP2       2    //!< TMP2 sensor
+#define TLA_GRTS       3    //!< gas reducer's temperature sensor
+#define TLA_NUM        4    //!< number of curves
+
 /**Converts ADC value into phisical magnitude - temperature (given from thermistor)
  * \param adcvalue Voltage from sensor (in ADC discretes)
  * \param lutab Pointer to related look up table
+ * \param id Identifier of curve (TLA_XXX)
  * \return physical magnitude * TEMP_PHYSICAL_MAGNITUDE_MULTIPLIER
  */
-int16_t thermistor_lookup(uint16_t adcvalue, int16_t _PGM *lutab);
+int16_t thermistor_lookup(uint16_t adcvalue, int16_t _PGM *lutab, uint8_t id);
 #endif
 
 #if defined(SM_CONTROL) && !defined(FUEL_INJECT)
@@ -335,6 +343,11 @@ uint8_t inj_airtemp_corr(uint8_t rawmat);
  */
 void calc_lookup_args(void);
 
+/** Invalidates cached corners of maps which use RPM/load grid. Must be called when content
+ * of tables in RAM has been changed (switching of the set of tables is detected automatically)
+ */
+void invalidate_lookup_cache(void);
+
 #if (defined(FUEL_INJECT) || defined(GD_CONTROL)) && !defined(SECU3T)
 /** Calculate PW correction from gas temperature using a lookup table
  * Uses d ECU data structure
@@ -341,6 +341,13 @@ void ckps_reset_error(void)
  CLEARBIT(flags, F_ERROR);
 }
 
+#ifdef DWELL_CONTROL
+uint16_t ckps_get_eq_overruns(void)
+{
+ return 0; //this decoder doesn't use event queue
+}
+#endif
+
 void ckps_use_knock_channel(uint8_t use_knock_channel)
 {
  WRITEBIT(flags, F_USEKNK, use_knock_channel);
@@ -0,0 +1,139 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+/** \file hostio.c
+ * \author Alexey A. Shabelnikov
+ * Register file, EEPROM and FLASH images of the emulated MCU (host build only)
+ */
+
+#include "port/avrio.h"
+
+//8-bit registers
+volatile uint8_t PORTA;
+volatile uint8_t PORTB;
+volatile uint8_t PORTC;
+volatile uint8_t PORTD;
+volatile uint8_t PINA;
+volatile uint8_t PINB;
+volatile uint8_t PINC;
+volatile uint8_t PIND;
+volatile uint8_t DDRA;
+volatile uint8_t DDRB;
+volatile uint8_t DDRC;
+volatile uint8_t DDRD;
+volatile uint8_t TCCR0A;
+volatile uint8_t TCCR0B;
+volatile uint8_t TCNT0;
+volatile uint8_t OCR0A;
+volatile uint8_t OCR0B;
+volatile uint8_t TIMSK0;
+volatile uint8_t TCCR1A;
+volatile uint8_t TCCR1B;
+volatile uint8_t TCCR1C;
+volatile uint8_t TIMSK1;
+volatile uint8_t TCCR2A;
+volatile uint8_t TCCR2B;
+volatile uint8_t TCNT2;
+volatile uint8_t OCR2A;
+volatile uint8_t OCR2B;
+volatile uint8_t TIMSK2;
+volatile uint8_t ASSR;
+volatile uint8_t TCCR3A;
+volatile uint8_t TCCR3B;
+volatile uint8_t TCCR3C;
+volatile uint8_t TIMSK3;
+volatile uint8_t GTCCR;
+volatile uint8_t host_tifr[4];
+volatile uint8_t ADMUX;
+volatile uint8_t ADCSRB;
+volatile uint8_t ACSR;
+volatile uint8_t DIDR0;
+volatile uint8_t EICRA;
+volatile uint8_t EIMSK;
+volatile uint8_t EIFR;
+volatile uint8_t PCICR;
+volatile uint8_t PCMSK0;
+volatile uint8_t PCMSK1;
+volatile uint8_t PCMSK2;
+volatile uint8_t PCMSK3;
+volatile uint8_t SPCR;
+volatile uint8_t SPSR = _BV(SPIF);   //!< SPI transfers complete immediately
+volatile uint8_t SPDR;
+volatile uint8_t UCSRA = _BV(UDRE);   //!< UART data register is always empty
+volatile uint8_t UCSRB;
+volatile uint8_t UCSRC;
+volatile uint8_t UDR;
+volatile uint8_t UBRRL;
+volatile uint8_t UBRRH;
+volatile uint8_t EECR;
+volatile uint8_t EEDR;
+volatile uint8_t WDTCSR;
+volatile uint8_t MCUSR;
+volatile uint8_t MCUCR;
+volatile uint8_t SREG;
+volatile uint8_t GPIOR0;
+volatile uint8_t GPIOR1;
+volatile uint8_t GPIOR2;
+volatile uint8_t TWBR;
+volatile uint8_t TWSR;
+volatile uint8_t TWCR;
+volatile uint8_t TWDR;
+volatile uint8_t TWAR;
+
+//16-bit registers
+volatile uint16_t TCNT1;
+volatile uint16_t OCR1A;
+volatile uint16_t OCR1B;
+volatile uint16_t ICR1;
+volatile uint16_t TCNT3;
+volatile uint16_t OCR3A;
+volatile uint16_t OCR3B;
+volatile uint16_t ICR3;
+volatile uint16_t ADC;
+volatile uint16_t EEAR;
+volatile uint16_t UBRR;
+
+volatile uint8_t host_adcsra;
+
+uint8_t host_flash[HOST_FLASH_SIZE];
+static uint8_t host_eeprom[HOST_EEPROM_SIZE];
+
+volatile uint8_t* host_adcsra_access(void)
+{
+ host_adcsra&= ~_BV(ADSC);
+ return &host_adcsra;
+}
+
+uint8_t host_eeprom_read(uint16_t addr)
+{
+ return host_eeprom[addr % HOST_EEPROM_SIZE];
+}
+
+void host_eeprom_write(uint16_t addr, uint8_t value)
+{
+ host_eeprom[addr % HOST_EEPROM_SIZE] = value;
+}
+
+void host_io_init(void)
+{
+ memset(host_flash, 0xFF, sizeof(host_flash));     //erased FLASH
+ memset(host_eeprom, 0xFF, sizeof(host_eeprom));   //erased EEPROM
+}
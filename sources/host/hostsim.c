@@ -0,0 +1,1411 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+/** \file hostsim.c
+ * \author Alexey A. Shabelnikov
+ * Simulator of the MCU for the host (Linux) build. Runs unmodified MAIN() loop of the
+ * firmware, emulates timers 0-3, ADC, UART transmitter and EEPROM, generates signal of
+ * the crankshaft position sensor (toothed wheel with missing teeth).
+ * Simulated time advances only at the scheduling points: each watchdog reset (at least once
+ * per main loop iteration) consumes configurable number of CPU cycles. Thus, results are
+ * fully deterministic and do not depend on speed of the host. Firmware's code which waits
+ * for interrupts in busy loops (e.g. meas_init()) is served by the stall timer: if there were
+ * no scheduling points during 200us of host time, then simulator advances time from a signal
+ * handler, as real interrupt would do.
+ * Simulator is also used as benchmark of the crank decoders (see bench.sh): signal can be generated
+ * (toothed wheel, cam and REF_S pulses) or replayed from file of recorded events. Report contains
+ * host time spent in the decoder's interrupts per tooth, number of teeth before first spark and
+ * error of the spark timing (measured advance angle relative to the commanded one). For odd-fire
+ * engines TDC angles of all cylinders are given with -T option, spark is measured relative to the
+ * nearest TDC. Shutter of the Hall sensor is described by pairs of edges: even entries of -P list
+ * are falling edges, odd entries are rising edges, decoder receives only edges of selected polarity.
+ * With -C option simulator checks table driven CRC16 functions against bit-serial reference
+ * implementation and reports their speed. With -D option (DELTA_SENSDAT build) simulator checks
+ * delta encoder of SENSOR_DAT packets against decoder using test vectors and random walk.
+ * With -I option simulator checks weights calculated using reciprocals of cell sizes and lookups
+ * on uniform axes against division and interpolation with weights against simple_interpolation(),
+ * also error of 1/AFR calculated using table of reciprocals and using Newton-Raphson method and error
+ * of the inj. PW calculated using product of factors and using multiplication and shift at each stage
+ * (and speed of both methods).
+ */
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "port/avrio.h"
+#include "port/interrupt.h"
+#include "port/intrinsic.h"
+#include "port/port.h"
+#include "bitmask.h"
+#include "ckps.h"
+#include "crc16.h"
+#include "ecudata.h"
+#include "eculogic.h"
+#include "eeprom.h"
+#include "evtbus.h"
+#include "hostsim.h"
+#include "isrprof.h"
+#include "mathemat.h"
+#include "sensdlt.h"
+#include "host/sensdltdec.h"
+
+/**Interrupt vectors of the firmware. Weak, because set of vectors depends on build options */
+#define HOST_VECTORS(V) \
+ V(INT0_vect) V(INT1_vect) V(TIMER2_COMPA_vect) V(TIMER2_COMPB_vect) V(TIMER2_OVF_vect) \
+ V(TIMER1_CAPT_vect) V(TIMER1_COMPA_vect) V(TIMER1_COMPB_vect) V(TIMER1_OVF_vect) \
+ V(TIMER0_COMPA_vect) V(TIMER0_COMPB_vect) V(TIMER0_OVF_vect) V(USART_RXC_vect) \
+ V(USART_UDRE_vect) V(ADC_vect) V(EE_RDY_vect) V(TIMER3_COMPA_vect) V(TIMER3_COMPB_vect) \
+ V(TIMER3_OVF_vect)
+
+#define HOST_DECLARE_VECTOR(v) void isr_##v(void) __attribute__((weak));
+HOST_VECTORS(HOST_DECLARE_VECTOR)
+
+/**Identifiers of vectors, order corresponds to priorities of the real MCU */
+enum
+{
+#define HOST_VECTOR_ID(v) VID_##v,
+ HOST_VECTORS(HOST_VECTOR_ID)
+ VID_NUM
+};
+
+/**Table of vectors (may contain null pointers) */
+static void (*const vectors[VID_NUM])(void) =
+{
+#define HOST_VECTOR_PTR(v) isr_##v,
+ HOST_VECTORS(HOST_VECTOR_PTR)
+};
+
+/**Names of vectors, used in the report */
+static const char* const vector_names[VID_NUM] =
+{
+#define HOST_VECTOR_NAME(v) #v,
+ HOST_VECTORS(HOST_VECTOR_NAME)
+};
+
+/**Vectors used by crank decoders, time spent in them is measured */
+#define DECODER_VECTORS ((1UL << VID_INT0_vect) | (1UL << VID_INT1_vect) | (1UL << VID_TIMER1_CAPT_vect) | \
+ (1UL << VID_TIMER1_COMPA_vect) | (1UL << VID_TIMER1_COMPB_vect) | (1UL << VID_TIMER1_OVF_vect) | \
+ (1UL << VID_TIMER0_COMPA_vect) | (1UL << VID_TIMER3_COMPA_vect))
+
+#define WHEEL_MAX_POS    128         //!< Maximum number of tooth positions on the wheel
+#define SPK_ANGLE_TOL    (ANGLE_MULTIPLIER / 4) //!< smaller changes of commanded advance angle are not transients (0.25 deg.)
+#define TDC_MAX_NUM      8           //!< Maximum number of cylinders in the list of TDC angles (see fw_ex_data_t::tdc_angle)
+#define QUANTUM_CYCLES   32          //!< Minimal step of the simulation (CPU cycles), 1.6us
+#define EE_WRITE_CYCLES  68000       //!< 3.4 ms - time of writing of single byte into EEPROM
+#define ADC_CONV_CYCLES  1664        //!< 13 ADC clocks, prescaler is 128
+
+/**Recorded event of the sensor's input (replay mode) */
+typedef struct
+{
+ uint64_t time;                      //!< time of event in CPU cycles
+ char input;                         //!< 'c' - CKPS (input capture), 'p' - PS (INT1), 'r' - REF_S (INT0)
+}replay_event_t;
+
+/**Describes state of the simulator */
+typedef struct
+{
+ host_sim_cfg_t cfg;                 //!< configuration (command line)
+ uint64_t cycles;                    //!< simulated time in CPU cycles
+ uint32_t pending;                   //!< pending interrupt flags (bit per vector)
+ uint64_t calls[VID_NUM];            //!< counters of ISR calls
+ uint64_t loops;                     //!< number of scheduling points (watchdog resets)
+ uint64_t teeth;                     //!< number of generated teeth
+ uint64_t uart_bytes;                //!< number of transmitted bytes
+ uint64_t ee_writes;                 //!< number of bytes written into EEPROM by interrupt driven process
+ uint64_t next_tooth;                //!< time of next tooth (cycles)
+ double   pos_angle[WHEEL_MAX_POS];  //!< angles of tooth positions on the wheel (deg.)
+ uint8_t  pos_real[WHEEL_MAX_POS];   //!< 0 - missing tooth
+ uint8_t  pos_num;                   //!< number of tooth positions on the wheel
+ double   wheel_deg;                 //!< crankshaft degrees per revolution of the wheel (360 or 720)
+ uint8_t  pos_idx;                   //!< index of the next tooth position
+ uint8_t  odd_rev;                   //!< 1 - second revolution of 720 deg. cycle
+ uint64_t tooth_time;                //!< time of the last passed tooth position (including missing)
+ uint64_t tooth_period;              //!< time between last passed and next tooth positions (cycles)
+ double   tooth_angle;               //!< angle of the last passed tooth position in 720 deg. cycle, <0 - unknown
+ double   tooth_gap;                 //!< angle between last passed and next tooth positions
+ double   tdc[TDC_MAX_NUM];          //!< TDC angles of cylinders in degrees after the first tooth (-T), used if tdc_num != 0
+ uint8_t  tdc_num;                   //!< number of angles in the list of TDCs, 0 - even firing engine
+ replay_event_t* replay;             //!< recorded events (replay mode)
+ uint32_t replay_num;                //!< number of recorded events
+ uint32_t replay_idx;                //!< index of the next event to be replayed
+ uint64_t isr_ns;                    //!< host time spent in the decoder's interrupts (ns)
+ uint64_t ts_ns;                     //!< overhead of the time measurement (ns)
+ uint8_t  ign_prev;                  //!< previous state of ignition outputs
+ uint64_t sparks;                    //!< number of sparks
+ uint64_t sync_teeth;                //!< number of teeth before first spark
+ int16_t  spk_angle;                 //!< commanded advance angle at the beginning of measurement
+ uint8_t  spk_stable;                //!< number of sparks since commanded advance angle has been changed
+ uint64_t spk_num;                   //!< number of measured sparks
+ double   spk_sum;                   //!< sum of spark timing errors (deg.)
+ double   spk_max;                   //!< maximum absolute spark timing error (deg.)
+ uint64_t adc_done;                  //!< time of completion of current ADC conversion
+ uint64_t ee_done;                   //!< time of completion of current EEPROM write
+ uint64_t udr_done;                  //!< time of completion of current UART transmission
+ uint8_t adc_busy;
+ uint8_t ee_busy;
+ uint8_t udr_busy;
+ volatile uint8_t in_sim;            //!< time is being advanced now
+ volatile uint64_t stall_loops;      //!< value of loops seen by the stall timer last time
+ FILE* uart_out;                     //!< file for UART output (optional)
+ struct timespec start;              //!< start of simulation (host time)
+}host_sim_t;
+
+static host_sim_t sim;
+
+static void sim_finish(void);
+
+/**Sets default configuration */
+static void sim_default_cfg(host_sim_cfg_t* p_cfg)
+{
+ uint8_t i;
+ p_cfg->rpm_begin = 3000;
+ p_cfg->rpm_end = 3000;
+ p_cfg->wheel_cogs = 60;
+ p_cfg->miss_cogs = 2;
+ p_cfg->duration_ms = 10000;
+ p_cfg->loop_cycles = 4000;
+ p_cfg->cyl_num = 4;
+ p_cfg->set_params = 0;
+ p_cfg->cam_wheel = 0;
+ p_cfg->both_edges = 0;
+ p_cfg->cam_deg = -1;
+ p_cfg->refs_deg = -1;
+ p_cfg->tdc_deg = -1;
+ p_cfg->tdc_list = NULL;
+ p_cfg->pattern = NULL;
+ for(i = 0; i < 8; ++i)
+  p_cfg->adc[i] = 512;
+ p_cfg->uart_file = NULL;
+ p_cfg->replay_file = NULL;
+}
+
+/**Returns current simulated RPM (linear sweep from begin to end during whole simulation) */
+static uint32_t sim_rpm(void)
+{
+ uint64_t total = ((uint64_t)sim.cfg.duration_ms) * (F_CPU / 1000);
+ int32_t delta = (int32_t)sim.cfg.rpm_end - (int32_t)sim.cfg.rpm_begin;
+ return sim.cfg.rpm_begin + (int32_t)((delta * (int64_t)sim.cycles) / (int64_t)total);
+}
+
+/**Calculates period of crankshaft revolution in CPU cycles */
+static uint64_t sim_rev_period(void)
+{
+ uint32_t rpm = sim_rpm();
+ if (!rpm)
+  return ~0ULL; //engine is stopped
+ return (((uint64_t)F_CPU) * 60) / rpm;
+}
+
+/**Builds list of tooth positions on the wheel: either list of angles (-P) or toothed wheel
+ * with missing teeth (-n, -m). Wheel turns once per crankshaft revolution or once per 720 deg.
+ * cycle if it is placed on the camshaft (-w)
+ * \return 0 - error */
+static uint8_t sim_build_wheel(void)
+{
+ sim.wheel_deg = sim.cfg.cam_wheel ? 720.0 : 360.0;
+ sim.pos_num = 0;
+ if (sim.cfg.pattern)
+ {
+  const char* p = sim.cfg.pattern;
+  char* end;
+  while(*p && sim.pos_num < WHEEL_MAX_POS)
+  {
+   double a = strtod(p, &end);
+   if (end == p || a < 0 || a >= sim.wheel_deg || (sim.pos_num && a <= sim.pos_angle[sim.pos_num-1]))
+    return 0; //angles must be sorted
+   sim.pos_angle[sim.pos_num] = a;
+   sim.pos_real[sim.pos_num++] = 1;
+   p = (*end == ',') ? end + 1 : end;
+  }
+ }
+ else
+ {
+  for(; sim.pos_num < sim.cfg.wheel_cogs && sim.pos_num < WHEEL_MAX_POS; ++sim.pos_num)
+  {
+   sim.pos_angle[sim.pos_num] = (sim.pos_num * sim.wheel_deg) / sim.cfg.wheel_cogs;
+   sim.pos_real[sim.pos_num] = sim.pos_num < (sim.cfg.wheel_cogs - sim.cfg.miss_cogs);
+  }
+ }
+ sim.tooth_angle = -1;
+ return sim.pos_num > 0;
+}
+
+/**Builds list of TDC angles of cylinders (-T) for odd-fire engine. Angles are in firing order,
+ * first angle belongs to the 1st cylinder
+ * \return 0 - error */
+static uint8_t sim_build_tdc(void)
+{
+ const char* p = sim.cfg.tdc_list;
+ char* end;
+ sim.tdc_num = 0;
+ if (!p)
+  return 1; //even firing engine
+ while(*p && sim.tdc_num < TDC_MAX_NUM)
+ {
+  double a = strtod(p, &end);
+  if (end == p || a < 0 || a >= 720.0)
+   return 0;
+  sim.tdc[sim.tdc_num++] = a;
+  p = (*end == ',') ? end + 1 : end;
+ }
+ return !*p && sim.tdc_num == sim.cfg.cyl_num;
+}
+
+/**Get prescaler's division factor for timers 0,1,3 (cs - value of CSn2:0 bits)*/
+static uint16_t presc_t013(uint8_t cs)
+{
+ static const uint16_t div[8] = {0, 1, 8, 64, 256, 1024, 0, 0}; //6,7 - external clock, not supported
+ return div[cs & 7];
+}
+
+/**Get prescaler's division factor for timer 2 (cs - value of CS22:0 bits)*/
+static uint16_t presc_t2(uint8_t cs)
+{
+ static const uint16_t div[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+ return div[cs & 7];
+}
+
+/**Number of timer's ticks which occur during current step */
+static uint32_t timer_ticks(uint16_t div, uint32_t step)
+{
+ if (!div)
+  return 0;
+ return (uint32_t)(((sim.cycles + step) / div) - (sim.cycles / div));
+}
+
+/**Number of CPU cycles until timer makes specified number of ticks */
+static uint64_t cycles_to_ticks(uint16_t div, uint32_t ticks)
+{
+ return ((uint64_t)(ticks - 1)) * div + (div - (sim.cycles % div));
+}
+
+/**Number of ticks until counter reaches specified value */
+static uint32_t ticks_to_value(uint16_t cnt, uint16_t value, uint32_t range)
+{
+ uint32_t t = (value - cnt) & (range - 1);
+ return t ? t : range;
+}
+
+/**Checks whether counter passes compare value when incremented by specified number of ticks */
+static uint8_t compare_match(uint16_t cnt, uint16_t ocr, uint32_t ticks, uint32_t range)
+{
+ return ((uint32_t)((ocr - cnt - 1) & (range - 1))) < ticks;
+}
+
+/**Emulation of 8-bit timer in normal mode */
+static void timer8(volatile uint8_t* tcnt, uint8_t ocra, uint8_t ocrb, uint32_t ticks, uint8_t vida, uint8_t vidb, uint8_t vidovf)
+{
+ if (!ticks)
+  return;
+ if (compare_match(*tcnt, ocra, ticks, 256))
+  sim.pending|= (1UL << vida);
+ if (compare_match(*tcnt, ocrb, ticks, 256))
+  sim.pending|= (1UL << vidb);
+ if ((uint32_t)*tcnt + ticks > 255)
+  sim.pending|= (1UL << vidovf);
+ *tcnt = *tcnt + ticks;
+}
+
+/**Emulation of 16-bit timer in normal mode */
+static void timer16(volatile uint16_t* tcnt, uint16_t ocra, uint16_t ocrb, uint32_t ticks, uint8_t vida, uint8_t vidb, uint8_t vidovf)
+{
+ if (!ticks)
+  return;
+ if (compare_match(*tcnt, ocra, ticks, 65536UL))
+  sim.pending|= (1UL << vida);
+ if (compare_match(*tcnt, ocrb, ticks, 65536UL))
+  sim.pending|= (1UL << vidb);
+ if ((uint32_t)*tcnt + ticks > 65535UL)
+  sim.pending|= (1UL << vidovf);
+ *tcnt = *tcnt + ticks;
+}
+
+/**Writing of logic one into TIFRx register clears corresponding flag */
+static void clear_flags_by_tifr(void)
+{
+ if (host_tifr[0] & _BV(OCF0A)) sim.pending&= ~(1UL << VID_TIMER0_COMPA_vect);
+ if (host_tifr[0] & _BV(OCF0B)) sim.pending&= ~(1UL << VID_TIMER0_COMPB_vect);
+ if (host_tifr[1] & _BV(OCF1A)) sim.pending&= ~(1UL << VID_TIMER1_COMPA_vect);
+ if (host_tifr[1] & _BV(OCF1B)) sim.pending&= ~(1UL << VID_TIMER1_COMPB_vect);
+ if (host_tifr[1] & _BV(ICF1))  sim.pending&= ~(1UL << VID_TIMER1_CAPT_vect);
+ if (host_tifr[2] & _BV(OCF2A)) sim.pending&= ~(1UL << VID_TIMER2_COMPA_vect);
+ if (host_tifr[2] & _BV(OCF2B)) sim.pending&= ~(1UL << VID_TIMER2_COMPB_vect);
+ if (host_tifr[3] & _BV(OCF3A)) sim.pending&= ~(1UL << VID_TIMER3_COMPA_vect);
+ if (host_tifr[3] & _BV(OCF3B)) sim.pending&= ~(1UL << VID_TIMER3_COMPB_vect);
+ host_tifr[0] = host_tifr[1] = host_tifr[2] = host_tifr[3] = 0;
+}
+
+volatile uint8_t* host_tifr_access(uint8_t n)
+{
+ clear_flags_by_tifr();
+ return &host_tifr[n];
+}
+
+/**Checks whether interrupt is enabled by its local enable bit */
+static uint8_t vector_enabled(uint8_t vid)
+{
+ switch(vid)
+ {
+  case VID_TIMER2_COMPA_vect: return CHECKBIT(TIMSK2, OCIE2A);
+  case VID_TIMER2_COMPB_vect: return CHECKBIT(TIMSK2, OCIE2B);
+  case VID_TIMER2_OVF_vect:   return CHECKBIT(TIMSK2, TOIE2);
+  case VID_TIMER1_CAPT_vect:  return CHECKBIT(TIMSK1, ICIE1);
+  case VID_TIMER1_COMPA_vect: return CHECKBIT(TIMSK1, OCIE1A);
+  case VID_TIMER1_COMPB_vect: return CHECKBIT(TIMSK1, OCIE1B);
+  case VID_TIMER1_OVF_vect:   return CHECKBIT(TIMSK1, TOIE1);
+  case VID_TIMER0_COMPA_vect: return CHECKBIT(TIMSK0, OCIE0A);
+  case VID_TIMER0_COMPB_vect: return CHECKBIT(TIMSK0, OCIE0B);
+  case VID_TIMER0_OVF_vect:   return CHECKBIT(TIMSK0, TOIE0);
+  case VID_TIMER3_COMPA_vect: return CHECKBIT(TIMSK3, OCIE3A);
+  case VID_TIMER3_COMPB_vect: return CHECKBIT(TIMSK3, OCIE3B);
+  case VID_TIMER3_OVF_vect:   return CHECKBIT(TIMSK3, TOIE3);
+  case VID_USART_UDRE_vect:   return CHECKBIT(UCSRB, UDRIE);
+  case VID_ADC_vect:          return CHECKBIT(host_adcsra, ADIE);
+  case VID_EE_RDY_vect:       return CHECKBIT(EECR, EERIE);
+  case VID_INT0_vect:         return CHECKBIT(EIMSK, INT0);
+  case VID_INT1_vect:         return CHECKBIT(EIMSK, INT1);
+  default: return 0;
+ }
+}
+
+/**\return host's monotonic time in ns */
+static uint64_t host_ns(void)
+{
+ struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**\return overhead of the time measurement (ns), it is excluded from results */
+static uint64_t host_ns_overhead(void)
+{
+ uint64_t t, best = ~0ULL;
+ int i;
+ for(i = 0; i < 1000; ++i)
+ {
+  t = host_ns();
+  t = host_ns() - t;
+  if (t < best)
+   best = t;
+ }
+ return best;
+}
+
+/**\return Crank angle in degrees after the first tooth of 720 deg. cycle at current time, <0 - unknown */
+static double crank_angle(void)
+{
+ if (sim.tooth_angle < 0 || !sim.tooth_period)
+  return -1;
+ return sim.tooth_angle + (((double)(sim.cycles - sim.tooth_time)) / sim.tooth_period) * sim.tooth_gap;
+}
+
+/**\return TDC of the 1st cylinder in degrees after the first tooth, <0 - unknown */
+static double tdc_angle(void)
+{
+ if (sim.tdc_num)
+  return sim.tdc[0];
+ if (sim.cfg.tdc_deg >= 0)
+  return sim.cfg.tdc_deg;
+ if (sim.cfg.pattern)
+  return -1;
+ //tooth following the missing teeth has number 1, see ckps_set_cogs_btdc()
+ return (d.param.ckps_cogs_btdc - 1) * (sim.wheel_deg / sim.cfg.wheel_cogs);
+}
+
+/**\return 1 if angle a is in the range (from, to] of cycle */
+static uint8_t angle_passed(double from, double to, double a, double cycle)
+{
+ double da = fmod(a - from + cycle, cycle), dt = fmod(to - from + cycle, cycle);
+ return da > 0 && da <= dt;
+}
+
+/**\return Advance angle of the spark at specified crank angle measured from the nearest TDC, folded into -360...360 */
+static double spark_advance(double tdc, double angle)
+{
+ double adv = fmod(tdc - angle + 1440.0, 720.0);
+ return (adv >= 360.0) ? adv - 720.0 : adv;
+}
+
+/**Detects sparks (rising edges of the ignition outputs, SECU-3T pinout) and measures error
+ * of the spark timing relatively to the nearest TDC. TDCs are taken from the list (-T, odd-fire engine)
+ * or even firing is assumed. Phase of the 720 deg. cycle is unknown without cam sensor, so TDCs shifted
+ * by 360 deg. are also considered. Sparks during transients are not measured: decoder latches advance
+ * angle before the spark, odd-fire decoder does it even one cycle before, so sparks of one whole
+ * engine cycle after change of the commanded angle (more than SPK_ANGLE_TOL) are skipped */
+static void spark_check(void)
+{
+ uint8_t outs = ((PORTD >> PD4) & 1) | (((PORTD >> PD5) & 1) << 1) | ((PORTC & 3) << 2);
+ uint8_t edge = sim.cfg.both_edges ? (outs ^ sim.ign_prev) : (outs & ~sim.ign_prev);
+ double angle, tdc, err, e;
+ uint8_t i, cyl = d.param.ckps_engine_cyl;
+ sim.ign_prev = outs;
+ if (!edge || !sim.teeth || !sim.isr_ns)
+  return; //no spark or outputs are being initialized
+
+ if (!sim.sparks++)
+  sim.sync_teeth = sim.teeth;
+
+ if (abs(d.corr.curr_angle - sim.spk_angle) > SPK_ANGLE_TOL)
+ {
+  sim.spk_angle = d.corr.curr_angle;
+  sim.spk_stable = 0;
+ }
+ angle = crank_angle();
+ tdc = tdc_angle();
+ if (sim.spk_stable <= cyl)
+  ++sim.spk_stable;
+ if (sim.spk_stable <= cyl || angle < 0 || tdc < 0 || !cyl)
+  return;
+
+ err = 720.0;
+ for(i = 0; i < (sim.tdc_num ? sim.tdc_num : cyl); ++i)
+ {
+  double t = sim.tdc_num ? sim.tdc[i] : tdc + (i * 720.0) / cyl;
+  e = spark_advance(t, angle) - ((double)d.corr.curr_angle) / ANGLE_MULTIPLIER;
+  if (fabs(e) < fabs(err))
+   err = e;
+  e = spark_advance(t + 360.0, angle) - ((double)d.corr.curr_angle) / ANGLE_MULTIPLIER;
+  if (fabs(e) < fabs(err))
+   err = e;
+ }
+ ++sim.spk_num;
+ sim.spk_sum+= err;
+ if (fabs(err) > sim.spk_max)
+  sim.spk_max = fabs(err);
+}
+
+/**Executes pending interrupts in order of their priorities. As real MCU does, clears I flag
+ * before calling of handler and sets it after return (RETI)*/
+static void dispatch_interrupts(void)
+{
+ uint8_t vid;
+ for(vid = 0; vid < VID_NUM && CHECKBIT(SREG, 7); ++vid)
+ {
+  if (!(sim.pending & (1UL << vid)) || !vector_enabled(vid))
+   continue;
+  sim.pending&= ~(1UL << vid);
+  ++sim.calls[vid];
+  if (vectors[vid])
+  {
+   SREG&= ~0x80;
+   if (DECODER_VECTORS & (1UL << vid))
+   {
+    uint64_t t;
+    spark_check(); //changes of outputs made outside of decoder's interrupts are not sparks
+    t = host_ns();
+    vectors[vid]();
+    t = host_ns() - t;
+    sim.isr_ns+= (t > sim.ts_ns) ? t - sim.ts_ns : 0;
+    spark_check();
+   }
+   else
+    vectors[vid]();
+   clear_flags_by_tifr(); //handler could write into TIFRx
+   SREG|= 0x80;
+  }
+  if (vid == VID_USART_UDRE_vect && CHECKBIT(UCSRB, TXEN))
+  { //byte has been written into UDR
+   sim.udr_busy = 1;
+   sim.udr_done = sim.cycles + host_sim_uart_byte_cycles();
+   ++sim.uart_bytes;
+   if (sim.uart_out)
+    fputc(UDR, sim.uart_out);
+  }
+  vid = 0xFF; //start from the highest priority again (incremented to 0)
+ }
+}
+
+/**Emulation of peripherals which are not timers */
+static void peripherals(void)
+{
+ //ADC, conversion is started by setting of ADSC bit
+ if (!sim.adc_busy && CHECKBIT(host_adcsra, ADSC))
+ {
+  sim.adc_busy = 1;
+  sim.adc_done = sim.cycles + ADC_CONV_CYCLES;
+ }
+ if (sim.adc_busy && sim.cycles >= sim.adc_done)
+ {
+  sim.adc_busy = 0;
+  ADC = sim.cfg.adc[ADMUX & 7];
+  host_adcsra&= ~_BV(ADSC);
+  sim.pending|= (1UL << VID_ADC_vect);
+ }
+
+ //EEPROM, writing is started by setting of EEPE bit
+ if (!sim.ee_busy && CHECKBIT(EECR, EEPE))
+ {
+  host_eeprom_write(EEAR, EEDR);
+  ++sim.ee_writes;
+  sim.ee_busy = 1;
+  sim.ee_done = sim.cycles + EE_WRITE_CYCLES;
+ }
+ if (sim.ee_busy && sim.cycles >= sim.ee_done)
+ {
+  sim.ee_busy = 0;
+  EECR&= ~(_BV(EEPE) | _BV(EEMPE));
+ }
+ if (!sim.ee_busy)
+  sim.pending|= (1UL << VID_EE_RDY_vect); //level interrupt
+
+ //UART transmitter
+ if (sim.udr_busy && sim.cycles >= sim.udr_done)
+  sim.udr_busy = 0;
+ UCSRA|= _BV(UDRE);
+ if (!sim.udr_busy)
+  sim.pending|= (1UL << VID_USART_UDRE_vect); //level interrupt
+}
+
+/**Replay of recorded events of sensor's inputs */
+static void replay_events(void)
+{
+ while (sim.replay_idx < sim.replay_num && sim.replay[sim.replay_idx].time <= sim.cycles)
+ {
+  replay_event_t* p_ev = &sim.replay[sim.replay_idx++];
+  if (p_ev->input == 'c')
+  {
+   ICR1 = TCNT1 - (uint16_t)((sim.cycles - p_ev->time) / presc_t013(TCCR1B));
+   sim.pending|= (1UL << VID_TIMER1_CAPT_vect);
+   ++sim.teeth;
+  }
+  else if (p_ev->input == 'p')
+   sim.pending|= (1UL << VID_INT1_vect);
+  else if (p_ev->input == 'r')
+   sim.pending|= (1UL << VID_INT0_vect);
+ }
+ sim.next_tooth = (sim.replay_idx < sim.replay_num) ? sim.replay[sim.replay_idx].time : ~0ULL;
+}
+
+/**Generation of crankshaft position sensor signal (input capture of timer 1), cam sensor's
+ * signal (INT1) and reference sensor's signal (INT0)*/
+static void ckp_sensor(void)
+{
+ if (sim.replay)
+ {
+  replay_events();
+  return;
+ }
+
+ while (sim.next_tooth <= sim.cycles)
+ {
+  uint64_t rev = sim_rev_period();
+  double angle, gap;
+  uint8_t idx = sim.pos_idx;
+  if (rev == ~0ULL)
+  {
+   sim.next_tooth = sim.cycles + F_CPU / 100; //check again after 10ms
+   sim.tooth_angle = -1;
+   break;
+  }
+
+  if (sim.pos_real[idx]
+#ifdef HALL_SYNC
+   //listed angles are alternately falling and rising edges of Hall sensor (first is falling), only selected edge is captured
+   && (!sim.cfg.pattern || !(idx & 1) == !CHECKBIT(TCCR1B, ICES1))
+#endif
+     )
+  { //real tooth
+   ICR1 = TCNT1 - (uint16_t)((sim.cycles - sim.next_tooth) / presc_t013(TCCR1B));
+   sim.pending|= (1UL << VID_TIMER1_CAPT_vect);
+   ++sim.teeth;
+  }
+
+  angle = sim.pos_angle[idx] + (sim.odd_rev ? 360.0 : 0);
+  if (sim.tooth_angle >= 0)
+  {
+   if (sim.cfg.cam_deg >= 0 && angle_passed(sim.tooth_angle, angle, sim.cfg.cam_deg, 720.0))
+    sim.pending|= (1UL << VID_INT1_vect);
+   if (sim.cfg.refs_deg >= 0 && angle_passed(fmod(sim.tooth_angle, 360.0), fmod(angle, 360.0), sim.cfg.refs_deg, 360.0))
+    sim.pending|= (1UL << VID_INT0_vect);
+  }
+
+  if (++sim.pos_idx >= sim.pos_num)
+  {
+   sim.pos_idx = 0;
+   if (!sim.cfg.cam_wheel)
+    sim.odd_rev^= 1;
+   gap = sim.pos_angle[0] + sim.wheel_deg - sim.pos_angle[idx];
+  }
+  else
+   gap = sim.pos_angle[sim.pos_idx] - sim.pos_angle[idx];
+
+  sim.tooth_angle = angle;
+  sim.tooth_gap = gap;
+  sim.tooth_time = sim.next_tooth;
+  sim.tooth_period = (uint64_t)((gap * rev) / 360.0);
+  sim.next_tooth+= sim.tooth_period;
+ }
+}
+
+/**Updates nearest event time using timer's state, mask has layout of TIMSKx (bit 0 - overflow, 1 - COMPA, 2 - COMPB) */
+static void timer_next_event(uint64_t* p_next, uint16_t div, uint16_t cnt, uint16_t ocra, uint16_t ocrb, uint32_t range, uint8_t mask)
+{
+ uint64_t t;
+ if (!div)
+  return; //timer is stopped
+ if (mask & 2)
+ {
+  t = cycles_to_ticks(div, ticks_to_value(cnt, ocra, range));
+  if (t < *p_next) *p_next = t;
+ }
+ if (mask & 4)
+ {
+  t = cycles_to_ticks(div, ticks_to_value(cnt, ocrb, range));
+  if (t < *p_next) *p_next = t;
+ }
+ if (mask & 1)
+ {
+  t = cycles_to_ticks(div, ticks_to_value(cnt, 0, range));
+  if (t < *p_next) *p_next = t;
+ }
+}
+
+/**Calculates number of CPU cycles until the nearest event (interrupt), so simulator can skip
+ * periods of time when nothing happens*/
+static uint64_t sim_next_event(void)
+{
+ uint64_t next = ~0ULL;
+ timer_next_event(&next, presc_t013(TCCR0B), TCNT0, OCR0A, OCR0B, 256, TIMSK0 >> TOIE0);
+ timer_next_event(&next, presc_t013(TCCR1B), TCNT1, OCR1A, OCR1B, 65536UL, TIMSK1 >> TOIE1);
+ timer_next_event(&next, presc_t2(TCCR2B), TCNT2, OCR2A, OCR2B, 256, TIMSK2 >> TOIE2);
+ timer_next_event(&next, presc_t013(TCCR3B), TCNT3, OCR3A, OCR3B, 65536UL, TIMSK3 >> TOIE3);
+ if (presc_t013(TCCR1B) && sim.next_tooth - sim.cycles < next)
+  next = sim.next_tooth > sim.cycles ? sim.next_tooth - sim.cycles : 0;
+ if (sim.adc_busy && sim.adc_done - sim.cycles < next)
+  next = sim.adc_done - sim.cycles;
+ if (CHECKBIT(host_adcsra, ADSC) && !sim.adc_busy)
+  next = 0;
+ if (sim.ee_busy && sim.ee_done - sim.cycles < next)
+  next = sim.ee_done - sim.cycles;
+ if (sim.udr_busy && sim.udr_done - sim.cycles < next)
+  next = sim.udr_done - sim.cycles;
+ return next;
+}
+
+/**Advances simulated time by specified number of CPU cycles */
+static void sim_advance(uint32_t cycles)
+{
+ uint64_t end = sim.cycles + cycles;
+ sim.in_sim = 1;
+ while(sim.cycles < end)
+ {
+  uint64_t step = sim_next_event();
+  if (step < QUANTUM_CYCLES)
+   step = QUANTUM_CYCLES;
+  if (step > end - sim.cycles)
+   step = end - sim.cycles;
+  clear_flags_by_tifr();
+  timer8(&TCNT0, OCR0A, OCR0B, timer_ticks(presc_t013(TCCR0B), step), VID_TIMER0_COMPA_vect, VID_TIMER0_COMPB_vect, VID_TIMER0_OVF_vect);
+  timer16(&TCNT1, OCR1A, OCR1B, timer_ticks(presc_t013(TCCR1B), step), VID_TIMER1_COMPA_vect, VID_TIMER1_COMPB_vect, VID_TIMER1_OVF_vect);
+  timer8(&TCNT2, OCR2A, OCR2B, timer_ticks(presc_t2(TCCR2B), step), VID_TIMER2_COMPA_vect, VID_TIMER2_COMPB_vect, VID_TIMER2_OVF_vect);
+  timer16(&TCNT3, OCR3A, OCR3B, timer_ticks(presc_t013(TCCR3B), step), VID_TIMER3_COMPA_vect, VID_TIMER3_COMPB_vect, VID_TIMER3_OVF_vect);
+  sim.cycles+= step;
+  if (presc_t013(TCCR1B))
+   ckp_sensor();
+  peripherals();
+  dispatch_interrupts();
+ }
+ sim.in_sim = 0;
+}
+
+/**Checks whether simulation must be finished */
+static void sim_check_end(void)
+{
+ if (sim.cycles >= ((uint64_t)sim.cfg.duration_ms) * (F_CPU / 1000))
+  sim_finish();
+ if (sim.replay && sim.replay_idx >= sim.replay_num)
+  sim_finish(); //all recorded events have been replayed
+}
+
+/**Stall timer handler. Advances time if firmware waits for interrupt in a busy loop */
+static void stall_handler(int sig)
+{
+ (void)sig;
+ if (sim.in_sim)
+  return;
+ if (sim.stall_loops != sim.loops)
+ { //there were scheduling points
+  sim.stall_loops = sim.loops;
+  return;
+ }
+ sim_advance(sim.cfg.loop_cycles);
+ sim_check_end();
+}
+
+/**Prints results of simulation and terminates process */
+static void sim_finish(void)
+{
+ struct timespec now;
+ double host_s, sim_s;
+ uint8_t vid;
+
+ signal(SIGALRM, SIG_IGN); //stall timer must not interrupt output of results
+
+ clock_gettime(CLOCK_MONOTONIC, &now);
+ host_s = (now.tv_sec - sim.start.tv_sec) + (now.tv_nsec - sim.start.tv_nsec) / 1e9;
+ sim_s = ((double)sim.cycles) / F_CPU;
+
+ printf("simulated time:   %.3f s\n", sim_s);
+ printf("host time:        %.3f s\n", host_s);
+ printf("main loop passes: %llu (%.0f/s of host time)\n", (unsigned long long)sim.loops, sim.loops / host_s);
+ printf("teeth:            %llu (%.0f/s of host time)\n", (unsigned long long)sim.teeth, sim.teeth / host_s);
+ printf("UART bytes:       %llu\n", (unsigned long long)sim.uart_bytes);
+ printf("EEPROM writes:    %llu\n", (unsigned long long)sim.ee_writes);
+ if (sim.replay)
+  printf("RPM:              %u (replay)\n", d.sens.frequen);
+ else
+  printf("RPM:              %u (simulated: %u)\n", d.sens.frequen, sim_rpm());
+ printf("advance angle:    %.2f deg\n", d.corr.curr_angle / 32.0);
+ printf("engine mode:      %u\n", d.engine_mode);
+ printf("decoder:          %.1f ns/tooth of host time\n", sim.teeth ? ((double)sim.isr_ns) / sim.teeth : 0.0);
+ printf("sparks:           %llu (first after %llu teeth)\n", (unsigned long long)sim.sparks, (unsigned long long)sim.sync_teeth);
+ if (sim.spk_num)
+  printf("spark error:      mean %.2f deg, max %.2f deg (%llu sparks)\n", sim.spk_sum / sim.spk_num, sim.spk_max, (unsigned long long)sim.spk_num);
+#ifdef DWELL_CONTROL
+ printf("queue overruns:   %u\n", ckps_get_eq_overruns());
+#endif
+ for(vid = 0; vid < VID_NUM; ++vid)
+  if (sim.calls[vid])
+   printf("ISR %-18s %llu\n", vector_names[vid], (unsigned long long)sim.calls[vid]);
+#ifdef ISR_PROFILER
+ {
+  static const char* ipc_names[IPC_NUMBER] = {"CKPS latency", "CKPS duration", "VST duration", "spark error"};
+  uint8_t ch;
+  for(ch = 0; ch < IPC_NUMBER; ++ch)
+   printf("%-17s min %u, max %u, p99 %u ticks (%u samples, %u lost)\n", ipc_names[ch], isrprof_stat[ch].min,
+          isrprof_stat[ch].max, isrprof_p99(ch), isrprof_stat[ch].count, isrprof_stat[ch].lost);
+ }
+#endif
+#ifdef EVENT_PROFILER
+ {
+  static const char* evt_names[EVT_NUMBER] = {"stroke", "cog changed", "engine stopped"};
+  uint8_t ev, i;
+  for(ev = 0; ev < EVT_NUMBER; ++ev)
+   for(i = 0; i < evtbus_get_subs_num(ev) && i < EVTPROF_MAX_SUBS; ++i)
+    printf("%-14s #%u: %u calls, mean %.1f, max %u ticks\n", evt_names[ev], i, evtprof_stat[ev][i].count,
+           evtprof_stat[ev][i].count ? ((double)evtprof_stat[ev][i].sum) / evtprof_stat[ev][i].count : 0.0, evtprof_stat[ev][i].max);
+ }
+#endif
+
+ if (sim.uart_out)
+  fclose(sim.uart_out);
+ exit(0);
+}
+
+uint32_t host_sim_uart_byte_cycles(void)
+{
+ uint16_t ubrr = (((uint16_t)UBRRH) << 8) | UBRRL;
+ return (CHECKBIT(UCSRA, U2X) ? 8UL : 16UL) * (ubrr + 1) * 10; //start + 8 data + stop bits
+}
+
+uint64_t host_sim_cycles(void)
+{
+ return sim.cycles;
+}
+
+void host_watchdog_reset(void)
+{
+ ++sim.loops;
+ sim_advance(sim.cfg.loop_cycles);
+ sim_check_end();
+}
+
+void host_delay_cycles(uint32_t cycles)
+{
+ sim_advance(cycles);
+}
+
+uint16_t host_free_timer(void)
+{
+ struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return (uint16_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+void host_call_address(uint32_t addr)
+{
+ printf("jump to 0x%05X (boot loader), simulation stopped\n", (unsigned)addr);
+ sim_finish();
+}
+
+/**Writes parameters with overridden configuration of the wheel into the EEPROM and opens the
+ * "default EEPROM" jumper, so firmware will use these parameters instead of default ones */
+static void sim_set_params(void)
+{
+ params_t par;
+ uint16_t i;
+ memcpy(&par, &fw_data.def_param, sizeof(params_t));
+ par.ckps_cogs_num = sim.cfg.wheel_cogs;
+ par.ckps_miss_num = sim.cfg.miss_cogs;
+ par.ckps_engine_cyl = sim.cfg.cyl_num;
+ par.crc = crc16((uint8_t*)&par, sizeof(params_t) - PAR_CRC_SIZE);
+ for(i = 0; i < sizeof(params_t); ++i)
+  host_eeprom_write(EEPROM_PARAM_START + i, ((uint8_t*)&par)[i]);
+ PINC|= _BV(PINC2);
+}
+
+#ifdef ODDFIRE_ALGO
+/**Writes list of TDC angles (-T) into the firmware's data, so odd-fire decoder will use them */
+static void sim_set_tdc(void)
+{
+ uint8_t i;
+ for(i = 0; i < sim.tdc_num; ++i)
+  fw_data.exdata.tdc_angle[i] = (uint16_t)((sim.tdc[i] * ANGLE_MULTIPLIER) + 0.5);
+}
+#endif
+
+/**Loads file of recorded events. Each line contains time in microseconds and input: c - CKPS,
+ * p - PS (cam sensor), r - REF_S. Lines beginning with # are ignored.
+ * \return 0 - error */
+static uint8_t sim_load_replay(const char* name)
+{
+ char line[128], input;
+ double time_us;
+ uint32_t size = 0;
+ FILE* f = fopen(name, "r");
+ if (!f)
+ {
+  perror(name);
+  return 0;
+ }
+ while(fgets(line, sizeof(line), f))
+ {
+  if (line[0] == '#' || sscanf(line, "%lf %c", &time_us, &input) != 2)
+   continue;
+  if (sim.replay_num == size)
+  {
+   size = size ? size * 2 : 4096;
+   sim.replay = realloc(sim.replay, size * sizeof(replay_event_t));
+  }
+  sim.replay[sim.replay_num].time = (uint64_t)(time_us * (F_CPU / 1000000));
+  sim.replay[sim.replay_num].input = input;
+  ++sim.replay_num;
+ }
+ fclose(f);
+ if (!sim.replay_num)
+  fprintf(stderr, "%s: no events\n", name);
+ return sim.replay_num > 0;
+}
+
+/**Bit-serial CRC16 (polynomial 0xA001), reference implementation for sim_crc_check()
+ * \param crc Previous value of the CRC
+ * \param data Byte of data
+ * \return updated value of the CRC
+ */
+static uint16_t crc16_ref(uint16_t crc, uint8_t data)
+{
+ uint8_t i = 8;
+ crc ^= data;
+ do
+ {
+  if (crc & 1)
+   crc = (crc >> 1) ^ 0xA001;
+  else
+   crc >>= 1;
+ } while(--i);
+ return crc;
+}
+
+/**Checks CRC16 functions (crc16(), crc16f(), upd_crc16f()) against bit-serial reference
+ * implementation and measures their speed
+ * \return 0 - mismatch found
+ */
+static uint8_t sim_crc_check(void)
+{
+ static uint8_t buf[32768];
+ uint32_t i, j, errors = 0;
+ uint16_t crc, ref;
+ uint64_t t, t_ref;
+
+ srand(1);
+ for(i = 0; i < sizeof(buf); ++i)
+  buf[i] = rand();
+ for(i = 0; i < CODE_SIZE; ++i)
+  host_flash[i] = rand();
+
+ //RAM: different sizes and alignments
+ for(i = 0; i < 600; ++i)
+ {
+  uint16_t len = (i < 300) ? i : (rand() % sizeof(buf) / 2);
+  uint8_t* p = buf + (rand() % (sizeof(buf) / 2));
+  for(ref = 0xFFFF, j = 0; j < len; ++j)
+   ref = crc16_ref(ref, p[j]);
+  if (crc16(p, len) != ref)
+   ++errors;
+ }
+
+ //ROM: whole code area at once and by blocks (as deferred check does)
+ for(ref = 0xFFFF, i = 0; i < CODE_SIZE; ++i)
+  ref = crc16_ref(ref, host_flash[i]);
+ if (crc16f(0, CODE_SIZE) != ref)
+  ++errors;
+ for(crc = 0xFFFF, i = 0; i < CODE_SIZE; i+=128)
+  crc = upd_crc16f(crc, (uint8_t _HPGM*)(uintptr_t)i, (CODE_SIZE - i) > 128 ? 128 : (CODE_SIZE - i));
+ if (crc != ref)
+  ++errors;
+
+ //speed
+ t = host_ns();
+ for(i = 0; i < 16; ++i)
+  crc = crc16(buf, sizeof(buf));
+ t = host_ns() - t;
+ t_ref = host_ns();
+ for(i = 0; i < 16; ++i)
+  for(ref = 0xFFFF, j = 0; j < sizeof(buf); ++j)
+   ref = crc16_ref(ref, buf[j]);
+ t_ref = host_ns() - t_ref;
+ if (crc != ref)
+  ++errors;
+
+ printf("CRC16 check:      %s (%u mismatches)\n", errors ? "FAILED" : "OK", (unsigned)errors);
+ printf("CRC16 speed:      %.2f ns/byte (bit-serial: %.2f ns/byte)\n",
+        (double)t / (16.0 * sizeof(buf)), (double)t_ref / (16.0 * sizeof(buf)));
+ return !errors;
+}
+
+#ifdef FUEL_INJECT
+#define FPW_SPEED_SETS 4096                       //!< number of sets of factors used to measure speed of inj. PW calculation
+static uint16_t fpw_speed_base[FPW_SPEED_SETS];   //!< base PW of each set
+static uint16_t fpw_speed_f[FPW_SPEED_SETS][FPW_NUM]; //!< factors of each set, in order of stages used by sim_interp_check()
+static volatile int32_t fpw_sink;                 //!< prevents calculations from being optimized out
+
+/**Calculates inj. PW as it was done before fpw_corr(): 32-bit PW is multiplied and shifted at each stage
+ * \param base Base PW
+ * \param f Factors of stages (IFR, air density, warmup, afterstart, lambda, IAC mixture, baro, gas temp., gas press.)
+ * \return PW
+ */
+static int32_t fpw_per_stage(uint16_t base, const uint16_t* f)
+{
+ uint32_t pw = base;
+ pw = (pw * f[0]) >> 8;
+ pw = (pw * f[1]) >> 7;
+ pw = (pw * f[2]) >> 7;
+ pw = (pw * f[3]) >> 7;
+ pw = (pw * f[4]) >> 9;
+ pw = (pw * f[5]) >> 13;
+ pw = (pw * f[6]) >> 12;
+ pw = (pw * f[7]) >> 7;
+ pw = (pw * f[8]) >> 7;
+ return pw;
+}
+#endif
+
+/**Checks interpolation_weight() and uaxis_lookup() against division and simple_interpolation_w()
+ * against simple_interpolation() using random cells, axes, positions and function values
+ * \return 0 - mismatch found or error exceeds its bound
+ */
+static uint8_t sim_interp_check(void)
+{
+ cell_rcp_t rc = {0};
+ uaxis_t ax = {0};
+ uint8_t size = 16;
+ uint32_t i, errors = 0, max_err[3] = {0};
+#if defined(FUEL_INJECT) || defined(GD_CONTROL)
+ uint32_t afr_err = 0, nr_err = 0;
+#endif
+#ifdef FUEL_INJECT
+ double fpw_err = 0, seq_err = 0;
+ uint64_t fpw_t = 0, seq_t = 0;
+#endif
+
+ srand(1);
+ for(i = 0; i < 3000000; ++i)
+ {
+  //small sizes (as on the CLT axis) and big sizes (as on the RPM axis), cell changes rarely
+  int16_t size = (i % 1000) ? rc.size : (i % 2000) ? 1 + (rand() % 200) : 1 + (rand() % 32767);
+  int16_t pos = (size > 0) ? rand() % (size + 1) : 0;
+  uint8_t k = i % 3, m = (k < 2) ? 16 : 1;  //signed bytes, unsigned bytes, words
+  int16_t a1 = (k == 0) ? (int8_t)rand() : (k == 1) ? (uint8_t)rand() : (int16_t)rand();
+  int16_t a2 = (k == 0) ? (int8_t)rand() : (k == 1) ? (uint8_t)rand() : (int16_t)rand();
+  uint16_t w;
+  int32_t err, bound;
+  if (!size)
+   size = 1;
+
+  w = interpolation_weight(&rc, pos, size);
+  if (w != (((uint32_t)pos) << 15) / size)
+   ++errors;
+
+  //truncation of weight gives less than |a2 - a1| * m / 32768, plus 1 LSB of the result
+  err = abs((int16_t)(simple_interpolation_w(a1, a2, w, m) - simple_interpolation(pos, a1, a2, 0, size, m)));
+  bound = 1 + (abs(a2 - a1) * m) / 32768;
+  if (err > bound)
+   ++errors;
+  if ((uint32_t)err > max_err[k])
+   max_err[k] = err;
+ }
+
+ //uniform axes, axis changes rarely (as when table is edited)
+ for(i = 0; i < 3000000; ++i)
+ {
+  uint16_t start = ax.start, end = ax.end, x = rand(), step, ri, ri1, rw = 0;
+  uint8_t valid;
+  if (!(i % 1000))
+  { //size of table is constant, so it changes only together with axis
+   size = 2 + (rand() % 31);
+   start = (i % 3000) ? rand() % 1024 : rand();
+   end = (i % 2000) ? start + (rand() % 8192) : rand();
+  }
+  if (i % 3)
+   x = start + (rand() % (end - start + 100)); //mostly within axis
+
+  //reference implementation, as in the lookup functions
+  step = (end - start) / (size - 1);
+  valid = step > 0 && step < 32768;
+  ri = ri1 = 0;
+  if (valid)
+  {
+   uint16_t xr = (x < start) ? start : x;
+   ri = (xr - start) / step;
+   if (ri >= size - 1)
+    ri = ri1 = size - 1;
+   else
+   {
+    ri1 = ri + 1;
+    rw = (((uint32_t)(xr - start - (ri * step))) << 15) / step;
+   }
+  }
+
+  if (uaxis_lookup(&ax, x, start, end, size) != valid || ax.i != ri || ax.i1 != ri1 || ax.w != rw)
+   ++errors;
+ }
+
+#if defined(FUEL_INJECT) || defined(GD_CONTROL)
+ { //1/AFR, AFR = 8...24 (value * 1024), result * 32768, chord and rounding of the table give 2 LSB
+  uint32_t x;
+  for(x = 8192; x <= 24576; ++x)
+  {
+   uint32_t e = abs((int32_t)afr_reciprocal(x) - (int32_t)((33554432UL + x / 2) / x));
+   if (e > afr_err)
+    afr_err = e;
+   e = abs((int32_t)nr_1x_afr(x) - (int32_t)((33554432UL + x / 2) / x));
+   if (e > nr_err)
+    nr_err = e;
+  }
+  if (afr_err > 2)
+   ++errors;
+ }
+#endif
+
+#ifdef FUEL_INJECT
+ { //inj. PW: product of factors (fpw_corr()) against PW multiplied and shifted at each stage, as it was done before
+  static const struct { uint8_t stage, shift; uint16_t min, max; } fpw_stages[] = {
+   {FPW_IFR, 8, 192, 512},      {FPW_AIRDEN, 7, 0, 255},  {FPW_WARMUP, 7, 0, 255},  {FPW_AFTSTR, 7, 128, 383},
+   {FPW_LAMBDA, 9, 256, 768},   {FPW_IACMIX, 13, 0, 16383}, {FPW_BARO, 12, 0, 8191}, {FPW_GASTEMP, 7, 0, 255},
+   {FPW_GASPRESS, 7, 0, 255}};
+  for(i = 0; i < 1000000; ++i)
+  {
+   uint16_t base = 1 + (rand() % 65535);
+   int64_t seq = base;   //64 bits: overflow of the 32-bit PW at extreme factors is not a rounding error
+   double exact = base, k = 1.0;
+   uint8_t s;
+   fpw_begin(base);
+   for(s = 0; s < sizeof(fpw_stages) / sizeof(fpw_stages[0]); ++s)
+   { //half of stages are not used (factor 1.0), as in real configurations
+    uint16_t f = (rand() & 1) ? (1 << fpw_stages[s].shift) : fpw_stages[s].min + (rand() % (fpw_stages[s].max - fpw_stages[s].min + 1));
+    fpw_corr(fpw_stages[s].stage, f, fpw_stages[s].shift);
+    seq = (seq * f) >> fpw_stages[s].shift;
+    k*= (double)f / (1 << fpw_stages[s].shift);
+   }
+   exact*= k;
+   if (k >= 16.0 || exact < 312.0)
+    continue;  //product is restricted to 16.0 by design, PW below 1ms is dominated by LSB
+   k = fabs(fpw_end(0) - exact) / exact;
+   if (k > fpw_err)
+    fpw_err = k;
+   k = fabs(seq - exact) / exact;
+   if (k > seq_err)
+    seq_err = k;
+  }
+  if (fpw_err > seq_err)
+   ++errors;
+
+  //speed: same sets of factors for both methods, all stages are used
+  for(i = 0; i < FPW_SPEED_SETS; ++i)
+  {
+   uint8_t s;
+   fpw_speed_base[i] = 1 + (rand() % 65535);
+   for(s = 0; s < FPW_NUM; ++s)
+    fpw_speed_f[i][s] = fpw_stages[s].min + (rand() % (fpw_stages[s].max - fpw_stages[s].min + 1));
+  }
+  fpw_t = host_ns();
+  for(i = 0; i < 64 * FPW_SPEED_SETS; ++i)
+  {
+   const uint16_t* f = fpw_speed_f[i % FPW_SPEED_SETS];
+   uint8_t s;
+   fpw_begin(fpw_speed_base[i % FPW_SPEED_SETS]);
+   for(s = 0; s < FPW_NUM; ++s)
+    fpw_corr(fpw_stages[s].stage, f[s], fpw_stages[s].shift);
+   fpw_sink+= fpw_end(0);
+  }
+  fpw_t = host_ns() - fpw_t;
+  seq_t = host_ns();
+  for(i = 0; i < 64 * FPW_SPEED_SETS; ++i)
+   fpw_sink+= fpw_per_stage(fpw_speed_base[i % FPW_SPEED_SETS], fpw_speed_f[i % FPW_SPEED_SETS]);
+  seq_t = host_ns() - seq_t;
+ }
+#endif
+
+ printf("Interpolation check: %s (%u mismatches, max. error %u/%u/%u LSB for bytes/unsigned bytes/words)\n", errors ? "FAILED" : "OK",
+        (unsigned)errors, (unsigned)max_err[0], (unsigned)max_err[1], (unsigned)max_err[2]);
+#if defined(FUEL_INJECT) || defined(GD_CONTROL)
+ printf("1/AFR error:      %u LSB (Newton-Raphson: %u LSB)\n", (unsigned)afr_err, (unsigned)nr_err);
+#endif
+#ifdef FUEL_INJECT
+ printf("Inj. PW error:    %.3f%% (per-stage multiply and shift: %.3f%%)\n", fpw_err * 100.0, seq_err * 100.0);
+ printf("Inj. PW speed:    %.1f ns/PW of host time (per-stage multiply and shift: %.1f ns/PW)\n",
+        (double)fpw_t / (64.0 * FPW_SPEED_SETS), (double)seq_t / (64.0 * FPW_SPEED_SETS));
+#endif
+ return !errors;
+}
+
+#ifdef DELTA_SENSDAT
+static uint8_t dlt_out[SENSDLT_MAX_SIZE + 2]; //!< encoded frame
+static uint8_t dlt_len;                       //!< size of encoded frame
+
+/**Callback for sensdlt_encode(), collects encoded frame */
+static void dlt_put(uint8_t b)
+{
+ if (dlt_len < sizeof(dlt_out))
+  dlt_out[dlt_len++] = b;
+}
+
+/**Encodes frame
+ * \param enc state of the encoder
+ * \param raw payload
+ * \param size size of payload
+ */
+static void dlt_encode(sensdlt_t* enc, const uint8_t* raw, uint8_t size)
+{
+ memcpy(sensdlt_get_buf(enc), raw, size);
+ dlt_len = 0;
+ sensdlt_encode(enc, size, dlt_put);
+}
+
+/**Checks delta encoder of SENSOR_DAT packets: fixed test vectors, then random walk of
+ * sensor values with lost packets (decoder must restore each frame or wait for key frame)
+ * \return 0 - mismatch found
+ */
+static uint8_t sim_sensdlt_check(void)
+{
+ static const uint8_t v[3][5] = {{0x12,0x34,0x00,0x10,0x7F}, {0x12,0x35,0x00,0x0F,0x7F}, {0x92,0x35,0x00,0x0F,0x7F}};
+ static const uint8_t e0[] = {0x80,0x05,0x12,0x34,0x00,0x10,0x7F}; //key frame
+ static const uint8_t e1[] = {0x01,0x03,0x02,0x01};                //+1, -1
+ static const uint8_t e2[] = {0x02,0x01,0xFF,0xFF,0x03};           //-32768
+ static sensdlt_t enc;
+ static sensdltdec_t dec;
+ uint8_t raw[SENSDLT_MAX_SIZE], size = 60;
+ uint32_t i, j, errors = 0, lost = 0, waited = 0, max_wait = 0, wait = 0, enc_bytes = 0, raw_bytes = 0;
+
+ //test vectors
+ sensdlt_reset(&enc);
+ sensdlt_dec_reset(&dec);
+ dlt_encode(&enc, v[0], 5);
+ errors+= (dlt_len != sizeof(e0) || memcmp(dlt_out, e0, sizeof(e0)) || sensdlt_decode(&dec, dlt_out, dlt_len) != 5);
+ dlt_encode(&enc, v[1], 5);
+ errors+= (dlt_len != sizeof(e1) || memcmp(dlt_out, e1, sizeof(e1)) || sensdlt_decode(&dec, dlt_out, dlt_len) != 5);
+ dlt_encode(&enc, v[2], 5);
+ errors+= (dlt_len != sizeof(e2) || memcmp(dlt_out, e2, sizeof(e2)) || sensdlt_decode(&dec, dlt_out, dlt_len) != 5);
+ errors+= !!memcmp(dec.raw, v[2], 5);
+ dlt_encode(&enc, v[2], 5);  //lost frame
+ dlt_encode(&enc, v[1], 5);
+ errors+= (sensdlt_decode(&dec, dlt_out, dlt_len) != 0);
+
+ //random walk: slowly changing words, noisy words, flags and rare jumps, size changes
+ srand(1);
+ sensdlt_reset(&enc);
+ sensdlt_dec_reset(&dec);
+ for(j = 0; j < SENSDLT_MAX_SIZE; ++j)
+  raw[j] = rand();
+ for(i = 0; i < 100000; ++i)
+ {
+  for(j = 0; j < size / 2; ++j)
+  {
+   uint16_t w = (raw[j*2] << 8) | raw[j*2+1];
+   uint8_t r = rand() % 100;
+   if (j % 4 == 0 && r < 50)
+    w+= (rand() % 9) - 4;
+   else if (j % 4 == 1 && r < 10)
+    w+= (rand() % 3) - 1;
+   else if (r == 0)
+    w = rand();
+   raw[j*2] = w >> 8;
+   raw[j*2+1] = w & 0xFF;
+  }
+  if (i % 5000 == 4999)
+   size = 50 + (rand() % 40);
+  dlt_encode(&enc, raw, size);
+  raw_bytes+= size;
+  enc_bytes+= dlt_len;
+  if (rand() % 100 == 0)
+  {
+   ++lost;
+   continue;
+  }
+  if (sensdlt_decode(&dec, dlt_out, dlt_len))
+  { //decoded frame must match
+   errors+= (dec.size != size || memcmp(dec.raw, raw, size));
+   if (wait > max_wait)
+    max_wait = wait;
+   wait = 0;
+  }
+  else
+  { //decoder may wait only for key frame
+   errors+= !!(dlt_out[0] & SENSDLT_KEY_FLAG);
+   ++waited, ++wait;
+  }
+ }
+
+ printf("SENSDLT check:    %s (%u mismatches)\n", errors ? "FAILED" : "OK", (unsigned)errors);
+ printf("SENSDLT ratio:    %.1f%% (%u lost, %u skipped, max. %u frames to key frame)\n",
+        100.0 * enc_bytes / raw_bytes, (unsigned)lost, (unsigned)waited, (unsigned)max_wait);
+ return !errors;
+}
+#endif
+
+/**Prints usage information */
+static void usage(const char* name)
+{
+ printf("Usage: %s [options]\n"
+        " -r rpm    RPM at the beginning of simulation (default 3000)\n"
+        " -R rpm    RPM at the end of simulation (default = beginning)\n"
+        " -n num    number of teeth on the wheel including missing (default 60)\n"
+        " -m num    number of missing teeth (default 2)\n"
+        " -t ms     duration of simulation in ms (default 10000)\n"
+        " -l cyc    CPU cycles consumed by one main loop pass (default 4000)\n"
+        " -a ch=val value of ADC channel 0...7 (default 512)\n"
+        " -u file   write UART output into file\n"
+        " -y num    number of cylinders (default 4)\n"
+        " -p        write wheel configuration (-n, -m, -y) into parameters\n"
+        " -P list   wheel with teeth at listed angles, e.g. 0,180,330 (instead of -n, -m), for Hall\n"
+        "           decoder angles of falling and rising edges alternate (first is falling)\n"
+        " -w        wheel is on the camshaft (one revolution per 720 deg. cycle)\n"
+        " -c deg    generate cam pulse (PS) at angle of 720 deg. cycle\n"
+        " -s deg    generate REF_S pulse at angle of revolution\n"
+        " -b deg    TDC of the 1st cylinder in degrees after the first tooth (default from parameters)\n"
+        " -T list   TDCs of all cylinders in degrees after the first tooth, e.g. 114,384,564,654 (odd-fire)\n"
+        " -E        both edges of ignition outputs are sparks (2 channel igniter)\n"
+        " -f file   replay recorded events (lines: time_us c|p|r)\n"
+        " -C        check and benchmark CRC16 functions, then exit\n"
+        " -I        check interpolation with reciprocals of cell sizes, then exit\n"
+#ifdef DELTA_SENSDAT
+        " -D        check delta encoder of SENSOR_DAT packets, then exit\n"
+#endif
+        , name);
+}
+
+int main(int argc, char** argv)
+{
+ int opt;
+ uint8_t rpm_end_set = 0;
+
+ sim_default_cfg(&sim.cfg);
+ while((opt = getopt(argc, argv, "r:R:n:m:t:l:a:u:y:pP:wc:s:b:T:Ef:CDIh")) != -1)
+ {
+  switch(opt)
+  {
+   case 'r': sim.cfg.rpm_begin = atoi(optarg); break;
+   case 'R': sim.cfg.rpm_end = atoi(optarg); rpm_end_set = 1; break;
+   case 'n': sim.cfg.wheel_cogs = atoi(optarg); break;
+   case 'm': sim.cfg.miss_cogs = atoi(optarg); break;
+   case 't': sim.cfg.duration_ms = atoi(optarg); break;
+   case 'l': sim.cfg.loop_cycles = atoi(optarg); break;
+   case 'a':
+   {
+    unsigned ch, val;
+    if (sscanf(optarg, "%u=%u", &ch, &val) != 2 || ch > 7)
+    {
+     usage(argv[0]);
+     return 1;
+    }
+    sim.cfg.adc[ch] = val & 0x3FF;
+    break;
+   }
+   case 'u': sim.cfg.uart_file = optarg; break;
+   case 'y': sim.cfg.cyl_num = atoi(optarg); break;
+   case 'p': sim.cfg.set_params = 1; break;
+   case 'P': sim.cfg.pattern = optarg; break;
+   case 'w': sim.cfg.cam_wheel = 1; break;
+   case 'c': sim.cfg.cam_deg = atoi(optarg); break;
+   case 's': sim.cfg.refs_deg = atoi(optarg); break;
+   case 'b': sim.cfg.tdc_deg = atoi(optarg); break;
+   case 'T': sim.cfg.tdc_list = optarg; break;
+   case 'E': sim.cfg.both_edges = 1; break;
+   case 'f': sim.cfg.replay_file = optarg; break;
+   case 'C': sim.cfg.crc_check = 1; break;
+   case 'I': sim.cfg.interp_check = 1; break;
+#ifdef DELTA_SENSDAT
+   case 'D': sim.cfg.sensdlt_check = 1; break;
+#endif
+   default:
+    usage(argv[0]);
+    return 1;
+  }
+ }
+ if (!rpm_end_set)
+  sim.cfg.rpm_end = sim.cfg.rpm_begin;
+ if (!sim.cfg.wheel_cogs || sim.cfg.miss_cogs >= sim.cfg.wheel_cogs || !sim.cfg.loop_cycles || !sim.cfg.cyl_num || !sim_build_wheel() || !sim_build_tdc())
+ {
+  usage(argv[0]);
+  return 1;
+ }
+
+ if (sim.cfg.uart_file && !(sim.uart_out = fopen(sim.cfg.uart_file, "wb")))
+ {
+  perror(sim.cfg.uart_file);
+  return 1;
+ }
+
+ if (sim.cfg.replay_file && !sim_load_replay(sim.cfg.replay_file))
+  return 1;
+
+ host_io_init();
+ if (sim.cfg.crc_check)
+  return sim_crc_check() ? 0 : 1;
+ if (sim.cfg.interp_check)
+  return sim_interp_check() ? 0 : 1;
+#ifdef DELTA_SENSDAT
+ if (sim.cfg.sensdlt_check)
+  return sim_sensdlt_check() ? 0 : 1;
+#endif
+ if (sim.cfg.set_params)
+  sim_set_params();
+#ifdef ODDFIRE_ALGO
+ sim_set_tdc();
+#endif
+ sim.ts_ns = host_ns_overhead();
+ clock_gettime(CLOCK_MONOTONIC, &sim.start);
+
+ {
+  struct itimerval tv = {{0, 200}, {0, 200}};
+  signal(SIGALRM, stall_handler);
+  setitimer(ITIMER_REAL, &tv, NULL);
+ }
+
+ secu3_main(); //never returns, simulation is stopped from host_watchdog_reset()
+ return 0;
+}
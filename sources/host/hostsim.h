@@ -0,0 +1,67 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+/** \file hostsim.h
+ * \author Alexey A. Shabelnikov
+ * Simulator of the MCU for the host (Linux) build
+ */
+
+#ifndef _HOSTSIM_H_
+#define _HOSTSIM_H_
+
+#include <stdint.h>
+
+/**Configuration of simulation */
+typedef struct
+{
+ uint16_t rpm_begin;                 //!< RPM at the beginning of simulation
+ uint16_t rpm_end;                   //!< RPM at the end of simulation (linear sweep)
+ uint8_t  wheel_cogs;                //!< number of teeth on the wheel (including missing)
+ uint8_t  miss_cogs;                 //!< number of missing teeth
+ uint32_t duration_ms;               //!< duration of simulation in ms
+ uint32_t loop_cycles;               //!< CPU cycles consumed by one main loop pass
+ uint8_t  cyl_num;                   //!< number of cylinders (used when wheel parameters are overridden)
+ uint8_t  set_params;                //!< write wheel configuration into parameters stored in the EEPROM
+ uint8_t  cam_wheel;                 //!< wheel is on the camshaft (one revolution per 720 deg. cycle)
+ uint8_t  both_edges;                //!< both edges of ignition outputs are sparks
+ int16_t  cam_deg;                   //!< angle of the cam pulse (PS input) in 720 deg. cycle, -1 - no pulse
+ int16_t  refs_deg;                  //!< angle of the REF_S pulse in revolution, -1 - no pulse
+ int16_t  tdc_deg;                   //!< TDC of the 1st cylinder in degrees after the first tooth, -1 - from parameters
+ const char* tdc_list;               //!< list of TDC angles of all cylinders (odd-fire engine), may be NULL (even firing)
+ const char* pattern;                //!< list of angles of teeth, may be NULL (toothed wheel with missing teeth is used)
+ uint16_t adc[8];                    //!< values of ADC channels
+ const char* uart_file;              //!< name of file for UART output, may be NULL
+ const char* replay_file;            //!< name of file with recorded events to replay, may be NULL
+ uint8_t  crc_check;                 //!< check and benchmark CRC16 functions instead of simulation
+ uint8_t  interp_check;              //!< check interpolation with reciprocals of cell sizes instead of simulation
+ uint8_t  sensdlt_check;             //!< check delta encoder of SENSOR_DAT packets instead of simulation
+}host_sim_cfg_t;
+
+/**Entry point of the firmware (see MAIN() in port/port.h) */
+void secu3_main(void);
+
+/**\return Number of CPU cycles required for transmission of one byte via UART */
+uint32_t host_sim_uart_byte_cycles(void);
+
+/**\return Current simulated time in CPU cycles */
+uint64_t host_sim_cycles(void);
+
+#endif //_HOSTSIM_H_
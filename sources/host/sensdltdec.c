@@ -0,0 +1,87 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file sensdltdec.c
+ * \author Alexey A. Shabelnikov
+ * Implementation of the decoder of the SENSDLT_DAT packets.
+ */
+
+#include <string.h>
+#include "sensdltdec.h"
+
+void sensdlt_dec_reset(sensdltdec_t* s)
+{
+ s->size = 0;
+}
+
+uint8_t sensdlt_decode(sensdltdec_t* s, const uint8_t* in, uint8_t len)
+{
+ const uint8_t* end = in + len;
+ uint8_t hdr, words, i;
+ const uint8_t* bitmap;
+
+ if (!len)
+  return 0;
+ hdr = *in++;
+
+ if (hdr & SENSDLT_KEY_FLAG)
+ {
+  uint8_t size;
+  if (in == end || !(size = *in++) || size > SENSDLT_MAX_SIZE || (end - in) != size)
+   return s->size = 0;
+  memcpy(s->raw, in, size);
+  if (size & 1)
+   s->raw[size] = 0; //pad last word (SENSDLT_MAX_SIZE is even)
+  s->seq = ((hdr & SENSDLT_SEQ_MASK) + 1) & SENSDLT_SEQ_MASK;
+  return s->size = size;
+ }
+
+ if (!s->size || hdr != s->seq)
+  return s->size = 0; //wait for key frame
+
+ words = (s->size + 1) >> 1;
+ bitmap = in;
+ in+= (words + 7) >> 3;
+ if (in > end)
+  return s->size = 0;
+ for(i = 0; i < words; ++i)
+ {
+  uint16_t z = 0, w;
+  uint8_t shift = 0;
+  if (!(bitmap[i >> 3] & (1 << (i & 7))))
+   continue;
+  do
+  {
+   if (in == end || shift > 14)
+    return s->size = 0;
+   z|= ((uint16_t)(*in & 0x7F)) << shift;
+   shift+= 7;
+  }while(*in++ & 0x80);
+  w = ((((uint16_t)s->raw[i*2]) << 8) | s->raw[i*2+1]) + ((z >> 1) ^ (uint16_t)-(int16_t)(z & 1));
+  s->raw[i*2] = w >> 8;
+  s->raw[i*2+1] = w & 0xFF;
+ }
+ if (in != end)
+  return s->size = 0;
+ s->seq = (s->seq + 1) & SENSDLT_SEQ_MASK;
+ return s->size;
+}
@@ -0,0 +1,57 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file sensdltdec.h
+ * \author Alexey A. Shabelnikov
+ * Decoder of the SENSDLT_DAT packets (see sensdlt.h for description of format). It is used
+ * by the host simulator for self-check and may be used as reference by the PC software.
+ */
+
+#ifndef _SENSDLTDEC_H_
+#define _SENSDLTDEC_H_
+
+#include <stdint.h>
+#include "sensdlt.h"
+
+/**Describes state of the decoder */
+typedef struct
+{
+ uint8_t raw[SENSDLT_MAX_SIZE];     //!< payload of the last decoded frame
+ uint8_t size;                      //!< size of payload, 0 - decoder waits for key frame
+ uint8_t seq;                       //!< expected sequence number of the next frame
+}sensdltdec_t;
+
+/**Resets decoder, so it will wait for key frame
+ * \param s pointer to state of the decoder
+ */
+void sensdlt_dec_reset(sensdltdec_t* s);
+
+/**Decodes one frame (unstuffed data of the SENSDLT_DAT packet, without descriptor)
+ * \param s pointer to state of the decoder
+ * \param in encoded frame
+ * \param len length of encoded frame in bytes
+ * \return size of decoded payload (placed into s->raw), 0 - frame is malformed or delta frame
+ * can not be applied (key frame was not received yet or sequence number is not continuous)
+ */
+uint8_t sensdlt_decode(sensdltdec_t* s, const uint8_t* in, uint8_t len);
+
+#endif //_SENSDLTDEC_H_
@@ -30,7 +30,7 @@
 #include <stdint.h>
 
 /**Wrap macro from port/pgmspace.h. for getting function pointers from program memory */
-#define _IOREM_GPTR(ptr) PGM_GET_WORD(ptr)
+#define _IOREM_GPTR(ptr) PGM_GET_FPTR(ptr)
 
 /**Init specified I/O
  * io_id - ID of I/O to be initialized
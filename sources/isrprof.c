@@ -0,0 +1,112 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file isrprof.c
+ * \author Alexey A. Shabelnikov
+ * Implementation of the interrupt profiler.
+ */
+
+#ifdef ISR_PROFILER
+
+#include "port/avrio.h"
+#include "port/port.h"
+#include <stdint.h>
+#include "isrprof.h"
+
+isrprof_ring_t isrprof_ring[IPC_NUMBER];
+
+isrprof_stat_t isrprof_stat[IPC_NUMBER];
+
+/**Read counters of ring buffers, index is IPC_xxx */
+static uint8_t isrprof_rd[IPC_NUMBER];
+
+void isrprof_init(void)
+{
+ uint8_t i, j;
+ for(i = 0; i < IPC_NUMBER; ++i)
+ {
+  isrprof_stat[i].min = 255;
+  isrprof_stat[i].max = 0;
+  isrprof_stat[i].count = 0;
+  isrprof_stat[i].lost = 0;
+  for(j = 0; j < ISRPROF_HIST_SIZE; ++j)
+   isrprof_stat[i].hist[j] = 0;
+  isrprof_rd[i] = isrprof_ring[i].wr;
+ }
+}
+
+void isrprof_process(void)
+{
+ uint8_t ch, n, v, j;
+ for(ch = 0; ch < IPC_NUMBER; ++ch)
+ {
+  isrprof_stat_t* p_st = &isrprof_stat[ch];
+  n = isrprof_ring[ch].wr - isrprof_rd[ch]; //8-bit read is atomic
+  if (n > ISRPROF_RING_SIZE)
+  { //overrun, oldest samples were overwritten
+   uint16_t lost = p_st->lost + (n - ISRPROF_RING_SIZE);
+   p_st->lost = (lost < p_st->lost) ? 0xFFFF : lost;
+   isrprof_rd[ch]+= n - ISRPROF_RING_SIZE;
+   n = ISRPROF_RING_SIZE;
+  }
+
+  for(; n; --n)
+  {
+   v = isrprof_ring[ch].buff[isrprof_rd[ch]++ & (ISRPROF_RING_SIZE-1)];
+
+   if (p_st->count == 0xFFFF)
+   { //avoid overflow: halve histogram, so it becomes a moving window
+    p_st->count>>= 1;
+    for(j = 0; j < ISRPROF_HIST_SIZE; ++j)
+     p_st->hist[j]>>= 1;
+   }
+
+   if (v < p_st->min)
+    p_st->min = v;
+   if (v > p_st->max)
+    p_st->max = v;
+   ++p_st->hist[(v < (ISRPROF_HIST_SIZE-1)) ? v : (ISRPROF_HIST_SIZE-1)];
+   ++p_st->count;
+  }
+ }
+}
+
+uint8_t isrprof_p99(uint8_t ch)
+{
+ isrprof_stat_t* p_st = &isrprof_stat[ch];
+ uint16_t rest = p_st->count / 100; //number of samples above 99th percentile
+ uint8_t i = ISRPROF_HIST_SIZE-1;
+
+ if (!p_st->count)
+  return 0;
+
+ //go from the upper bin down until more than 1% of samples are passed
+ while(i && p_st->hist[i] <= rest)
+ {
+  rest-= p_st->hist[i];
+  --i;
+ }
+ //last bin is open-ended, so use worst case as the upper bound
+ return (i == (ISRPROF_HIST_SIZE-1)) ? p_st->max : i;
+}
+
+#endif //ISR_PROFILER
@@ -0,0 +1,120 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file isrprof.h
+ * \author Alexey A. Shabelnikov
+ * Interrupt profiler. Measures latency and execution time of the time-critical interrupts
+ * (CKP sensor's input capture, system timer) and error of the spark timing (difference between
+ * programmed and actual time of the spark). Interrupts put samples into the ring buffers and main
+ * loop collects them into histograms, so the worst case and 99th percentile can be obtained.
+ * All values are in ticks of timer 1 (3.2us).
+ */
+
+#ifndef _ISRPROF_H_
+#define _ISRPROF_H_
+
+#ifdef ISR_PROFILER
+
+#include <stdint.h>
+
+//Channels of the profiler
+#define IPC_CKPS_LAT    0     //!< latency of the TIMER1_CAPT_vect (entry time relative to ICR1)
+#define IPC_CKPS_DUR    1     //!< execution time of the TIMER1_CAPT_vect
+#define IPC_VST_DUR     2     //!< execution time of the TIMER2_OVF_vect (including nested interrupts)
+#define IPC_SPARK_ERR   3     //!< spark error (entry time of the compare interrupt relative to the programmed time)
+#define IPC_NUMBER      4     //!< number of channels
+
+#define ISRPROF_RING_SIZE 32  //!< size of ring buffer, must be power of 2
+#define ISRPROF_HIST_SIZE 32  //!< number of histogram's bins: 0, 1, 2...30 ticks, last bin is 31 ticks and more
+
+/**Ring buffer of a channel. Written from interrupts, read from the main loop */
+typedef struct
+{
+ uint8_t buff[ISRPROF_RING_SIZE];        //!< samples in ticks of timer 1 (saturated to 255)
+ volatile uint8_t wr;                    //!< free-running write counter
+}isrprof_ring_t;
+
+/**Statistics of a channel */
+typedef struct
+{
+ uint8_t min;                            //!< minimum value since reset
+ uint8_t max;                            //!< worst case since reset
+ uint16_t count;                         //!< number of samples in the histogram
+ uint16_t lost;                          //!< number of samples lost because of ring buffer's overrun
+ uint16_t hist[ISRPROF_HIST_SIZE];       //!< histogram, one bin per tick
+}isrprof_stat_t;
+
+/**Ring buffers of all channels, index is IPC_xxx */
+extern isrprof_ring_t isrprof_ring[IPC_NUMBER];
+
+/**Statistics of all channels, index is IPC_xxx */
+extern isrprof_stat_t isrprof_stat[IPC_NUMBER];
+
+/**Puts sample into the ring buffer of specified channel. Must be called with disabled interrupts.
+ * ch Index of channel (IPC_xxx)
+ * v Value in ticks, values greater than 255 are saturated
+ */
+#define ISRPROF_PUT(ch, v) { \
+    uint16_t _v = (v); \
+    isrprof_ring[ch].buff[isrprof_ring[ch].wr & (ISRPROF_RING_SIZE-1)] = (_v > 255) ? 255 : _v; \
+    ++isrprof_ring[ch].wr; }
+
+/**Takes timestamp of the entry into interrupt. Must be placed at the beginning of ISR */
+#define ISRPROF_ENTER() uint16_t isrprof_t0 = TCNT1
+
+/**Stores difference between entry timestamp and specified reference time (e.g. programmed time
+ * of event). Negative values (event fired earlier) are stored as 0.
+ * ch Index of channel (IPC_xxx)
+ * ref Reference time in ticks of timer 1
+ */
+#define ISRPROF_LATENCY(ch, ref) { \
+    int16_t _d = (int16_t)(isrprof_t0 - (uint16_t)(ref)); \
+    ISRPROF_PUT(ch, (_d < 0) ? 0 : _d); }
+
+/**Stores execution time of interrupt (from entry timestamp till now)
+ * ch Index of channel (IPC_xxx)
+ */
+#define ISRPROF_LEAVE(ch) ISRPROF_PUT(ch, TCNT1 - isrprof_t0)
+
+/**Initialization of profiler's state */
+void isrprof_init(void);
+
+/**Collects samples from the ring buffers into histograms. Must be called from the main loop
+ * frequently enough to prevent overrun of the ring buffers.
+ */
+void isrprof_process(void);
+
+/**Calculates 99th percentile of specified channel
+ * \param ch Index of channel (IPC_xxx)
+ * \return value in ticks of timer 1, 0 if there are no samples
+ */
+uint8_t isrprof_p99(uint8_t ch);
+
+#else //profiler is not used
+
+#define ISRPROF_ENTER()
+#define ISRPROF_LATENCY(ch, ref)
+#define ISRPROF_LEAVE(ch)
+
+#endif //ISR_PROFILER
+
+#endif //_ISRPROF_H_
@@ -0,0 +1,124 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+/** \file loopprof.c
+ * \author Alexey A. Shabelnikov
+ * Implementation of the main loop profiler.
+ */
+
+#if defined(LOOP_PROFILER) || defined(EVENT_PROFILER)
+
+#include "port/port.h"
+#include <stdint.h>
+#include "loopprof.h"
+#include "vstimer.h"
+
+void prof_update(prof_stat_t* p_st, uint16_t time)
+{
+ if (p_st->count == 0xFFFF)
+ { //avoid overflow: halve accumulated values, so statistics becomes a moving window
+  p_st->sum>>= 1;
+  p_st->count>>= 1;
+ }
+ if (time > p_st->max)
+  p_st->max = time;
+ p_st->sum+= time;
+ ++p_st->count;
+}
+
+#endif //LOOP_PROFILER || EVENT_PROFILER
+
+#ifdef LOOP_PROFILER
+
+lprof_stat_t lprof_stat[LPS_NUMBER];
+
+/**State variables */
+typedef struct
+{
+ uint16_t t_stage;                       //!< timestamp of the beginning of current stage
+ uint16_t t_loop;                        //!< timestamp of the beginning of current iteration
+ uint8_t started;                        //!< set after first call of lprof_begin()
+}lprof_state_t;
+
+lprof_state_t lprof = {0,0,0};
+
+/**Updates statistics of specified stage
+ * \param p_st Pointer to the statistics
+ * \param time Measured time in ticks
+ */
+static void lprof_update(lprof_stat_t* p_st, uint16_t time)
+{
+ uint8_t bin = 0, i;
+ uint16_t v = time;
+
+ if (p_st->s.count == 0xFFFF)
+ { //histogram is halved together with the rest of statistics (see prof_update())
+  for(i = 0; i < LPROF_HIST_SIZE; ++i)
+   p_st->hist[i]>>= 1;
+ }
+
+ if (!p_st->s.count || time < p_st->min)
+  p_st->min = time;
+ prof_update(&p_st->s, time);
+
+ //index of bin is the number of significant bits
+ while(v && bin < (LPROF_HIST_SIZE-1))
+ {
+  v>>= 1;
+  ++bin;
+ }
+ if (p_st->hist[bin] < 0xFFFF)
+  ++p_st->hist[bin];
+}
+
+void lprof_init(void)
+{
+ uint8_t i, j;
+ for(i = 0; i < LPS_NUMBER; ++i)
+ {
+  lprof_stat[i].min = 0xFFFF;
+  lprof_stat[i].s.max = 0;
+  lprof_stat[i].s.sum = 0;
+  lprof_stat[i].s.count = 0;
+  for(j = 0; j < LPROF_HIST_SIZE; ++j)
+   lprof_stat[i].hist[j] = 0;
+ }
+ lprof.started = 0;
+}
+
+void lprof_begin(void)
+{
+ uint16_t t = s_timer_ftc();
+ if (lprof.started)
+  lprof_update(&lprof_stat[LPS_LOOP], t - lprof.t_loop);
+ lprof.started = 1;
+ lprof.t_loop = t;
+ lprof.t_stage = t;
+}
+
+void lprof_stage(uint8_t stage)
+{
+ uint16_t t = s_timer_ftc();
+ lprof_update(&lprof_stat[stage], t - lprof.t_stage);
+ lprof.t_stage = t;
+}
+
+#endif //LOOP_PROFILER
@@ -0,0 +1,111 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+/** \file loopprof.h
+ * \author Alexey A. Shabelnikov
+ * Main loop profiler. Measures execution time of each stage of the main loop using
+ * free-running timer 1 (tick = 3.2us) and accumulates statistics: min, max, mean and
+ * log2 histogram.
+ */
+
+#ifndef _LOOPPROF_H_
+#define _LOOPPROF_H_
+
+#if defined(LOOP_PROFILER) || defined(EVENT_PROFILER)
+
+#include <stdint.h>
+
+/**Statistics of measured time, common for the main loop and event bus profilers. Times are in ticks
+ * of timer 1 (3.2us, see s_timer_ftc()) */
+typedef struct
+{
+ uint16_t count;                         //!< number of measurements
+ uint16_t max;                           //!< maximum time
+ uint32_t sum;                           //!< sum of times, mean = sum / count
+}prof_stat_t;
+
+/**Updates statistics with new measured time. When count reaches 0xFFFF, accumulated values are
+ * halved, so statistics becomes a moving window
+ * \param p_st Pointer to the statistics
+ * \param time Measured time in ticks
+ */
+void prof_update(prof_stat_t* p_st, uint16_t time);
+
+#endif //LOOP_PROFILER || EVENT_PROFILER
+
+#ifdef LOOP_PROFILER
+
+//Stages of the main loop (see secu3.c)
+#define LPS_COGCHG      0     //!< cog changed & engine stopped notifications
+#define LPS_SOP         1     //!< sop_execute_operations()
+#define LPS_CE          2     //!< ce_check_engine()
+#define LPS_UART        3     //!< process_uart_interface()
+#define LPS_SAVEPAR     4     //!< save_param_if_need()
+#define LPS_INSTFRQ     5     //!< ckps_calculate_instant_freq()
+#define LPS_MEASAVG     6     //!< meas_average_measured_values()
+#define LPS_DISCRETE    7     //!< meas_take_discrete_inputs()
+#define LPS_LOOKUP      8     //!< calc_lookup_args()
+#define LPS_ECULOGIC    9     //!< eculogic_system_state_machine()
+#define LPS_CTRLUNITS  10     //!< control_engine_units()
+#define LPS_IGNCTRL    11     //!< dwell time and ignition cut off
+#define LPS_STROKE     12     //!< operations executed once per engine stroke
+#define LPS_SETANGLE   13     //!< ckps_set_advance_angle(), injection settings and fuel flow
+#define LPS_MISC       14     //!< diagnostics, OBD, watchdog and deferred CRC
+#define LPS_LOOP       15     //!< whole iteration of the main loop
+#define LPS_NUMBER     16     //!< number of stages
+
+#define LPROF_HIST_SIZE 10    //!< number of histogram's bins: 0, 1, 2-3, 4-7, ... 256 and more ticks
+
+/**Statistics of a single stage. All times are in ticks of timer 1 (3.2us) */
+typedef struct
+{
+ prof_stat_t s;                          //!< number of measurements, maximum and sum of times
+ uint16_t min;                           //!< minimum time
+ uint16_t hist[LPROF_HIST_SIZE];         //!< log2 histogram
+}lprof_stat_t;
+
+/**Statistics of all stages, index is LPS_xxx */
+extern lprof_stat_t lprof_stat[LPS_NUMBER];
+
+/**Initialization of profiler's state */
+void lprof_init(void);
+
+/**Must be called at the beginning of each iteration of the main loop. Also finishes
+ * measurement of the whole iteration (LPS_LOOP)
+ */
+void lprof_begin(void);
+
+/**Finishes measurement of specified stage and starts measurement of the next one
+ * \param stage Index of stage (LPS_xxx)
+ */
+void lprof_stage(uint8_t stage);
+
+#define LPROF_BEGIN() lprof_begin()          //!< wrapper
+#define LPROF_STAGE(s) lprof_stage(s)        //!< wrapper
+
+#else //profiler is not used
+
+#define LPROF_BEGIN()
+#define LPROF_STAGE(s)
+
+#endif //LOOP_PROFILER
+
+#endif //_LOOPPROF_H_
@@ -25,6 +25,7 @@
  */
 
 #include "port/port.h"
+#include "port/pgmspace.h"
 #include <stdlib.h>
 #include "mathemat.h"
 
@@ -42,11 +43,85 @@ int16_t bilinear_interpolation(int16_t x, int16_t y, int16_t a1, int16_t a2, int
  return (a14 + ((((int32_t)(a23 - a14)) * (y - y_s)) / y_l));
 }
 
+int16_t bilinear_interpolation_w(int16_t a1, int16_t a2, int16_t a3, int16_t a4, uint16_t w_x, uint16_t w_y, uint8_t m)
+{
+ int16_t a23,a14;
+ a23 = (a2 * m) + ((((int32_t)(a3 - a2) * m) * w_x) >> 15);
+ a14 = (a1 * m) + ((((int32_t)(a4 - a1) * m) * w_x) >> 15);
+ return (a14 + ((((int32_t)(a23 - a14)) * w_y) >> 15));
+}
+
 int16_t simple_interpolation(int16_t x, int16_t a1, int16_t a2, int16_t x_s, int16_t x_l, uint8_t m)
 {
  return ((a1 * m) + (((int32_t)(a2 - a1) * m) * (x - x_s)) / x_l);
 }
 
+int16_t simple_interpolation_w(int16_t a1, int16_t a2, uint16_t w, uint8_t m)
+{
+ int32_t d = ((int32_t)(a2 - a1)) * m;
+ //quotient is truncated toward zero, as in simple_interpolation()
+ if (d < 0)
+  return (a1 * m) - ((((uint32_t)-d) * w) >> 15);
+ return (a1 * m) + ((((uint32_t)d) * w) >> 15);
+}
+
+uint16_t interpolation_weight(cell_rcp_t* p_rcp, int16_t pos, int16_t size)
+{
+ uint16_t w;
+ if (size < 1)
+  return 0;
+ if (pos < 0)
+  pos = 0;
+ else if (pos > size)
+  pos = size;
+
+ if (size != p_rcp->size || !p_rcp->rcp)
+ { //cell has changed, recalculate reciprocal
+  p_rcp->size = size;
+  p_rcp->rcp = 0x80000000UL / size;
+ }
+
+ //(pos << 15) / size, reciprocal is truncated, so quotient may be less by one
+ w = (((uint32_t)pos) * p_rcp->rcp) >> 16;
+ if ((((uint32_t)(w + 1)) * size) <= (((uint32_t)pos) << 15))
+  ++w;
+ return w;
+}
+
+uint8_t uaxis_lookup(uaxis_t* p_ax, uint16_t x, uint16_t start, uint16_t end, uint8_t size)
+{
+ uint16_t off, q;
+ if (start != p_ax->start || end != p_ax->end || !p_ax->rc.rcp)
+ { //axis has changed (e.g. table has been edited), recalculate step and its reciprocal
+  p_ax->start = start, p_ax->end = end;
+  p_ax->step = (end - start) / (size - 1);
+  p_ax->rc.rcp = 0;  //remains 0 if step is invalid
+  interpolation_weight(&p_ax->rc, 0, p_ax->step);
+ }
+
+ p_ax->i = p_ax->i1 = 0, p_ax->w = 0;
+ if (!p_ax->rc.rcp)
+  return 0; //step is 0 or greater than 32767
+
+ if (x < start)
+  x = start;
+ off = x - start;
+
+ //off / step, 65536 / step is truncated, so quotient may be less by two
+ q = (((uint32_t)off) * (p_ax->rc.rcp >> 15)) >> 16;
+ while((off - (q * p_ax->step)) >= p_ax->step)
+  ++q;
+
+ if (q >= (size - 1))
+  p_ax->i = p_ax->i1 = size - 1;
+ else
+ {
+  p_ax->i = q, p_ax->i1 = q + 1;
+  p_ax->w = interpolation_weight(&p_ax->rc, off - (q * p_ax->step), p_ax->step);
+ }
+ return 1;
+}
+
 void restrict_value_to(int16_t *io_value, int16_t i_bottom_limit, int16_t i_top_limit)
 {
  if (*io_value > i_top_limit)
@@ -80,6 +155,39 @@ uint16_t nr_1x_afr(uint16_t x)
  return r;
 }
 
+#define AFR_RCP_START 8192     //!< first point of the table of reciprocals, 8.0 * 1024
+#define AFR_RCP_SHIFT 8        //!< step between points is 256 (0.25 * 1024)
+#define AFR_RCP_SIZE  65       //!< number of points, 8.0...24.0
+
+/**Table of reciprocals for afr_reciprocal(), 32768 / AFR, AFR = 8.0, 8.25 ... 24.0 */
+PGM_DECLARE(static uint16_t afr_rcp_table[AFR_RCP_SIZE]) =
+{
+ 4096,3972,3855,3745,3641,3542,3449,3361,
+ 3277,3197,3121,3048,2979,2913,2849,2789,
+ 2731,2675,2621,2570,2521,2473,2427,2383,
+ 2341,2300,2260,2222,2185,2149,2114,2081,
+ 2048,2016,1986,1956,1928,1900,1872,1846,
+ 1820,1796,1771,1748,1725,1702,1680,1659,
+ 1638,1618,1598,1579,1560,1542,1524,1507,
+ 1489,1473,1456,1440,1425,1409,1394,1380,
+ 1365
+};
+
+uint16_t afr_reciprocal(uint16_t x)
+{
+ uint8_t i;
+ uint16_t r1, r2;
+ if (x < AFR_RCP_START || x >= (AFR_RCP_START + ((AFR_RCP_SIZE - 1) << AFR_RCP_SHIFT)))
+  return nr_1x_afr(x); //out of range of the table
+
+ x-= AFR_RCP_START;
+ i = x >> AFR_RCP_SHIFT;
+ r1 = PGM_GET_WORD(&afr_rcp_table[i]);
+ r2 = PGM_GET_WORD(&afr_rcp_table[i + 1]);
+ //reciprocal decreases, interpolate with rounding
+ return r1 - ((((uint32_t)(r1 - r2)) * (x & ((1 << AFR_RCP_SHIFT) - 1)) + (1 << (AFR_RCP_SHIFT - 1))) >> AFR_RCP_SHIFT);
+}
+
 #endif //FUEL_INJECT || GD_CONTROL
 
 #if defined(FUEL_INJECT) || defined(GD_CONTROL)
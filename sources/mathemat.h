@@ -56,6 +56,70 @@ int16_t simple_interpolation(int16_t x,int16_t a1,int16_t a2,int16_t x_s,int16_t
  */
 int16_t bilinear_interpolation(int16_t x,int16_t y,int16_t a1,int16_t a2,int16_t a3,int16_t a4,int16_t x_s,int16_t y_s,int16_t x_l,int16_t y_l, uint8_t m);
 
+/** f(x,y) liniar interpolation for function with two arguments, uses precalculated weights of arguments.
+ * Corners are the same as for bilinear_interpolation()
+ * \param a1 function value at the beginning of interval (1 corner)
+ * \param a2 function value at the beginning of interval (2 corner)
+ * \param a3 function value at the beginning of interval (3 corner)
+ * \param a4 function value at the beginning of interval (4 corner)
+ * \param w_x position of first argument in the interval, (x - x_s) / x_l * 32768 (0...32768)
+ * \param w_y position of second argument in the interval, (y - y_s) / y_l * 32768 (0...32768)
+ * \param m function multiplier
+ * \return interpolated value of function * m
+ */
+int16_t bilinear_interpolation_w(int16_t a1,int16_t a2,int16_t a3,int16_t a4,uint16_t w_x,uint16_t w_y, uint8_t m);
+
+/** f(x) liniar interpolation for function with single argument, uses precalculated weight of argument
+ * \param a1 function value at the beginning of interval
+ * \param a2 function value at the end of interval
+ * \param w position of argument in the interval, (x - x_s) / x_l * 32768 (0...32768)
+ * \param m function multiplier, |a2 - a1| * m must not exceed 65535
+ * \return interpolated value of function * m
+ */
+int16_t simple_interpolation_w(int16_t a1,int16_t a2,uint16_t w, uint8_t m);
+
+/** Cached reciprocal of the size of a grid cell */
+typedef struct
+{
+ int16_t size;          //!< size of cell for which reciprocal has been calculated
+ uint32_t rcp;          //!< reciprocal, 2^31 / size
+}cell_rcp_t;
+
+/** Calculates weight of argument in the cell, i.e. pos / size * 32768. Division is replaced by
+ * multiplication by the reciprocal of the cell size, which is recalculated only when size changes.
+ * Result is exactly the same as of division.
+ * \param p_rcp pointer to the cached reciprocal (it will be updated if size differs)
+ * \param pos position of argument in the cell (x - x_s), restricted to 0...size
+ * \param size size of cell (x_l)
+ * \return weight (0...32768)
+ */
+uint16_t interpolation_weight(cell_rcp_t* p_rcp, int16_t pos, int16_t size);
+
+/** State of uniform axis of 1D lookup table: points are evenly spaced between the start and the end values.
+ * Step and its reciprocal are recalculated only when start or end value changes */
+typedef struct
+{
+ uint16_t start;        //!< value at the start of axis for which step has been calculated
+ uint16_t end;          //!< value at the end of axis for which step has been calculated
+ uint16_t step;         //!< distance between points, (end - start) / (size - 1)
+ cell_rcp_t rc;         //!< cached reciprocal of step
+ uint8_t i;             //!< result: index of point at the beginning of interval
+ uint8_t i1;            //!< result: index of point at the end of interval (i + 1 or i after the last point)
+ uint16_t w;            //!< result: position of argument in the interval, value * 32768
+}uaxis_t;
+
+/** Finds interval on the uniform axis of 1D lookup table and position of argument in it without
+ * divisions (unless axis has changed). Argument is restricted to the start of axis. Results are
+ * stored in i, i1 and w fields and can be passed to simple_interpolation_w().
+ * \param p_ax pointer to the state of axis
+ * \param x argument value
+ * \param start value at the start of axis
+ * \param end value at the end of axis
+ * \param size number of points on the axis
+ * \return 0 - axis is invalid (step is 0 or too big), results point to the first point, 1 - OK
+ */
+uint8_t uaxis_lookup(uaxis_t* p_ax, uint16_t x, uint16_t start, uint16_t end, uint8_t size);
+
 /** Restricts specified value to specified limits
  * \param io_value pointer to value to be restricted. This parameter will also receive result.
  * \param i_bottom_limit bottom limit
@@ -69,6 +133,13 @@ void restrict_value_to(int16_t *io_value, int16_t i_bottom_limit, int16_t i_top_
  * \return 1/x * 32768
  */
 uint16_t nr_1x_afr(uint16_t x);
+
+/**Calculate 1/x function using table of reciprocals (step of AFR is 0.25) and linear interpolation.
+ * Falls back to nr_1x_afr() if x is out of range of the table
+ * \param x  8...24, value * 1024
+ * \return 1/x * 32768
+ */
+uint16_t afr_reciprocal(uint16_t x);
 #endif
 
 #if defined(FUEL_INJECT) || defined(GD_CONTROL)
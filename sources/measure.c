@@ -79,37 +79,103 @@
 
 #define CIRCBUFFMAX 8                          //!< Maximum size of ring buffer in items
 
+/**Gets type of filter used for corresponding input (see MEAS_FLT_xxx in tables.h)*/
+#define INPFLT(idx) (PGM_GET_BYTE(&fw_data.exdata.inp_flt[idx]))
+
 /**Describes ring buffer for one input*/
 typedef struct
 {
  uint16_t buff[CIRCBUFFMAX];                    //!< Ring buffer
+ uint32_t sum;                                  //!< Running sum of items in ring buffer (or accumulator of exponential filter)
+ uint16_t hist[2];                              //!< Two previous raw samples, used by median filter
  uint8_t ai;                                    //!< index in buffer
+ uint8_t num;                                   //!< Size of ring buffer the running sum corresponds to, 0 - not initialized yet
 }meas_input_t;
 
 /**Ring buffers for all inputs */
-meas_input_t meas[INPUTNUM] = {{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0},{{0},0}};
+meas_input_t meas[INPUTNUM] = {{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},
+                               {{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0},{{0},0,{0},0,0}};
+
+/**Divides value by size of ring buffer. We use shifts instead of division for the most used sizes
+ * \param sum Value to be divided
+ * \param num Size of ring buffer
+ * \return sum / num
+ */
+static uint16_t div_avnum(uint32_t sum, uint8_t num)
+{
+ if (num==4)
+  return sum >> 2;
+ if (num==8)
+  return sum >> 3;
+ return sum / num; //default
+}
 
+/**Returns median of three values
+ * \param a,b,c Input values
+ * \return median value
+ */
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+{
+ if (a > b)
+ { uint16_t t = a; a = b; b = t; }
+ //now a <= b
+ if (c < a)
+  return a;
+ if (c > b)
+  return b;
+ return c;
+}
+
+/**Puts new sample into the ring buffer of specified input and updates running sum
+ * \param idx Index of input (see xxx_INPIDX)
+ * \param value New sample
+ * \return sample which was put into the ring buffer (value passed through the median filter if it is selected)
+ */
 static uint16_t update_buffer(uint8_t idx, uint16_t value)
 {
- meas[idx].buff[meas[idx].ai] = value;
- (meas[idx].ai==0) ? (meas[idx].ai = AVNUM(idx) - 1): meas[idx].ai--;
+ meas_input_t* p = &meas[idx];
+ uint8_t num = AVNUM(idx), flt = INPFLT(idx);
+
+ if (p->num != num)
+ { //size of the buffer has been changed (or first call), start from the current sample
+  uint8_t i = 0;
+  for(; i < CIRCBUFFMAX; ++i)
+   p->buff[i] = (i < num) ? value : 0; //prefill with the first sample, so average is valid immediately
+  p->sum = ((uint32_t)value) * num;
+  p->ai = 0;
+  p->hist[0] = p->hist[1] = value;
+  p->num = num;
+ }
+
+ if (MEAS_FLT_EMA == flt)
+ { //exponential filter, time constant is equal to the number of averages
+  p->sum = p->sum - div_avnum(p->sum, num) + value;
+  return value;
+ }
+
+ if (MEAS_FLT_MED3 == flt)
+ { //reject single spikes
+  uint16_t med = median3(value, p->hist[0], p->hist[1]);
+  p->hist[1] = p->hist[0];
+  p->hist[0] = value;
+  value = med;
+ }
+
+ p->sum = p->sum - p->buff[p->ai] + value;
+ p->buff[p->ai] = value;
+ (p->ai==0) ? (p->ai = num - 1): p->ai--;
  return value;
 }
 
+/**Returns averaged value of specified input
+ * \param idx Index of input (see xxx_INPIDX)
+ * \return average of ring buffer or output of exponential filter
+ */
 static uint16_t average_buffer(uint8_t idx)
 {
- uint8_t i = AVNUM(idx) - 1;  uint32_t sum = 0;
- do
- {
-  sum+=meas[idx].buff[i];
- }while(i--);
-
- //We use shifts instead of division.
- if (AVNUM(idx)==4)
-  return sum >> 2;
- if (AVNUM(idx)==8)
-  return sum >> 3;
- return sum / AVNUM(idx); //default
+ if (!meas[idx].num)
+  return 0; //buffer has not been updated yet
+ return div_avnum(meas[idx].sum, meas[idx].num);
 }
 
 void meas_init_ports(void)
@@ -137,7 +203,14 @@ void meas_update_values_buffers(uint8_t rpm_only, ce_sett_t _PGM *cesd)
  if (rpm_only)
   return;
 
+#ifdef CYL_MAP_SAMPLING
+ //MAP is sampled synchronously with crank angle, so average over one engine cycle has no pulsations and
+ //we can use short ring buffer (small number of averages) for it
+ update_buffer(MAP_INPIDX, adc_get_map_value_cycavg());
+ rawval = adc_get_map_value();
+#else
  rawval = update_buffer(MAP_INPIDX, adc_get_map_value());
+#endif
 
 #ifdef SEND_INST_VAL
  rawval = ce_is_error(ECUERROR_MAP_SENSOR_FAIL) && PGM_GET_BYTE(&cesd->map_v_flg) ? PGM_GET_WORD(&cesd->map_v_em) : adc_compensate(_RESDIV(rawval, 2, 1), d.param.map_adc_factor, d.param.map_adc_correction);
@@ -235,7 +308,7 @@ void meas_average_measured_values(ce_sett_t _PGM *cesd)
   if (!CHECKBIT(d.param.tmp_flags, TMPF_CLT_MAP)) //use linear sensor
    d.sens.temperat = temp_adc_to_c(ce_is_error(ECUERROR_TEMP_SENSOR_FAIL) && PGM_GET_BYTE(&cesd->cts_v_flg) ? PGM_GET_WORD(&cesd->cts_v_em) : d.sens.temperat_raw);
   else //use lookup table (actual for thermistor sensors)
-   d.sens.temperat = thermistor_lookup(ce_is_error(ECUERROR_TEMP_SENSOR_FAIL) && PGM_GET_BYTE(&cesd->cts_v_flg) ? PGM_GET_WORD(&cesd->cts_v_em) : d.sens.temperat_raw, fw_data.exdata.cts_curve);
+   d.sens.temperat = thermistor_lookup(ce_is_error(ECUERROR_TEMP_SENSOR_FAIL) && PGM_GET_BYTE(&cesd->cts_v_flg) ? PGM_GET_WORD(&cesd->cts_v_em) : d.sens.temperat_raw, fw_data.exdata.cts_curve, TLA_CTS);
 #endif
  }
  else                                       //CTS is not used
@@ -297,7 +370,7 @@ void meas_average_measured_values(ce_sett_t _PGM *cesd)
 
 #ifdef AIRTEMP_SENS
  if (IOCFG_CHECK(IOP_AIR_TEMP))
-  d.sens.air_temp = thermistor_lookup(d.sens.add_i2, fw_data.exdata.ats_curve);   //ADD_I2 input selected as MAT sensor
+  d.sens.air_temp = thermistor_lookup(d.sens.add_i2, fw_data.exdata.ats_curve, TLA_ATS);   //ADD_I2 input selected as MAT sensor
  else
   d.sens.air_temp = 0; //input is not selected
 #endif
@@ -322,13 +395,13 @@ void meas_average_measured_values(ce_sett_t _PGM *cesd)
 
 #ifndef SECU3T //SECU-3i
  if (IOCFG_CHECK(IOP_TMP2))
-  d.sens.tmp2 = thermistor_lookup(d.sens.add_i3, fw_data.exdata.tmp2_curve); //ADD_I3 input selected as TMP2 sensor
+  d.sens.tmp2 = thermistor_lookup(d.sens.add_i3, fw_data.exdata.tmp2_curve, TLA_TMP2); //ADD_I3 input selected as TMP2 sensor
  else
   d.sens.tmp2 = 0; //input is not selected
 
 #ifdef MCP3204
  if (IOCFG_CHECK(IOP_GRTEMP))
-  d.sens.grts = thermistor_lookup(d.sens.add_i6, fw_data.exdata.grts_curve); //ADD_I6 input selected as GRTEMP sensor
+  d.sens.grts = thermistor_lookup(d.sens.add_i6, fw_data.exdata.grts_curve, TLA_GRTS); //ADD_I6 input selected as GRTEMP sensor
  else
   d.sens.grts = 0; //input is not selected
 #endif
@@ -375,17 +448,11 @@ void meas_init(void)
 static void select_table_set(uint8_t set_index)
 {
  if (set_index > (TABLES_NUMBER_PGM-1))
- {
-  d.mm_ptr8 = mm_get_byte_ram;
-  d.mm_ptr16 = mm_get_word_ram;
-  d.mm_ptr12 = mm_get_w12_ram;
- }
+  d.mm_ram = 1;
  else
  {
   d.fn_dat = &fw_data.tables[set_index];
-  d.mm_ptr8 = mm_get_byte_pgm;
-  d.mm_ptr16 = mm_get_word_pgm;
-  d.mm_ptr12 = mm_get_w12_pgm;
+  d.mm_ram = 0;
  }
 }
 #endif
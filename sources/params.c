@@ -34,6 +34,7 @@
 #include "crc16.h"
 #include "ecudata.h"
 #include "eeprom.h"
+#include "funconv.h"
 #include "ioconfig.h"
 #include "jumper.h"
 #include "params.h"
@@ -86,6 +87,7 @@ void reset_eeprom_params(void)
 
  while(!eeprom_is_idle() && --i)
  {
+  eeprom_process();
   wdt_reset_timer();
   _DELAY_US(1000);      //1ms
  }
@@ -154,6 +156,7 @@ void load_specified_tables_into_ram(uint8_t index)
   MEMCPY_P(&d.tables_ram, &fw_data.tables[index], sizeof(f_data_t));
  else
   eeprom_read(&d.tables_ram, EEPROM_REALTIME_TABLES_START, sizeof(f_data_t));
+ invalidate_lookup_cache();
 
  //notification will be sent about that new set of tables has been loaded
  sop_set_operation(SOP_SEND_NC_TABLSET_LOADED);
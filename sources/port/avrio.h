@@ -121,6 +121,9 @@
  #define PSRSYNC 0
 #endif
 
+#elif defined(__linux__) //Host build
+ #include "hostio.h"   //emulated register file
+
 #else //AVR GCC
  #include <avr/io.h>    //device IO
 
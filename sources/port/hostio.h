@@ -0,0 +1,522 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+/** \file hostio.h
+ * \author Alexey A. Shabelnikov
+ * Emulated I/O registers and bits of ATmega1284 used by the host (Linux) build.
+ * Registers are plain variables defined in host/hostio.c. Simulator (host/hostsim.c)
+ * advances timers, fires interrupt vectors and provides values of analog inputs.
+ */
+
+#ifndef _SECU3_HOSTIO_H_
+#define _SECU3_HOSTIO_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _BV
+ #define _BV(bit) (1 << (bit))
+#endif
+
+//8-bit registers
+extern volatile uint8_t PORTA;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t PORTC;
+extern volatile uint8_t PORTD;
+extern volatile uint8_t PINA;
+extern volatile uint8_t PINB;
+extern volatile uint8_t PINC;
+extern volatile uint8_t PIND;
+extern volatile uint8_t DDRA;
+extern volatile uint8_t DDRB;
+extern volatile uint8_t DDRC;
+extern volatile uint8_t DDRD;
+extern volatile uint8_t TCCR0A;
+extern volatile uint8_t TCCR0B;
+extern volatile uint8_t TCNT0;
+extern volatile uint8_t OCR0A;
+extern volatile uint8_t OCR0B;
+extern volatile uint8_t TIMSK0;
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint8_t TCCR1C;
+extern volatile uint8_t TIMSK1;
+extern volatile uint8_t TCCR2A;
+extern volatile uint8_t TCCR2B;
+extern volatile uint8_t TCNT2;
+extern volatile uint8_t OCR2A;
+extern volatile uint8_t OCR2B;
+extern volatile uint8_t TIMSK2;
+extern volatile uint8_t ASSR;
+extern volatile uint8_t TCCR3A;
+extern volatile uint8_t TCCR3B;
+extern volatile uint8_t TCCR3C;
+extern volatile uint8_t TIMSK3;
+extern volatile uint8_t GTCCR;
+extern volatile uint8_t ADMUX;
+extern volatile uint8_t ADCSRB;
+extern volatile uint8_t ACSR;
+extern volatile uint8_t DIDR0;
+extern volatile uint8_t EICRA;
+extern volatile uint8_t EIMSK;
+extern volatile uint8_t EIFR;
+extern volatile uint8_t PCICR;
+extern volatile uint8_t PCMSK0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t PCMSK2;
+extern volatile uint8_t PCMSK3;
+extern volatile uint8_t SPCR;
+extern volatile uint8_t SPSR;
+extern volatile uint8_t SPDR;
+extern volatile uint8_t UCSRA;
+extern volatile uint8_t UCSRB;
+extern volatile uint8_t UCSRC;
+extern volatile uint8_t UDR;
+extern volatile uint8_t UBRRL;
+extern volatile uint8_t UBRRH;
+extern volatile uint8_t EECR;
+extern volatile uint8_t EEDR;
+extern volatile uint8_t WDTCSR;
+extern volatile uint8_t MCUSR;
+extern volatile uint8_t MCUCR;
+extern volatile uint8_t SREG;
+extern volatile uint8_t GPIOR0;
+extern volatile uint8_t GPIOR1;
+extern volatile uint8_t GPIOR2;
+extern volatile uint8_t TWBR;
+extern volatile uint8_t TWSR;
+extern volatile uint8_t TWCR;
+extern volatile uint8_t TWDR;
+extern volatile uint8_t TWAR;
+
+//16-bit registers
+extern volatile uint16_t TCNT1;
+extern volatile uint16_t OCR1A;
+extern volatile uint16_t OCR1B;
+extern volatile uint16_t ICR1;
+extern volatile uint16_t TCNT3;
+extern volatile uint16_t OCR3A;
+extern volatile uint16_t OCR3B;
+extern volatile uint16_t ICR3;
+extern volatile uint16_t ADC;
+extern volatile uint16_t EEAR;
+extern volatile uint16_t UBRR;
+
+//Writing of logic one into TIFRx clears flag. Written value is applied on the next access, thus flags are read as 0
+extern volatile uint8_t host_tifr[4];
+volatile uint8_t* host_tifr_access(uint8_t n);
+#define TIFR0 (*host_tifr_access(0))
+#define TIFR1 (*host_tifr_access(1))
+#define TIFR2 (*host_tifr_access(2))
+#define TIFR3 (*host_tifr_access(3))
+
+//ADSC is cleared on each access, thus conversions started by polling code complete immediately
+extern volatile uint8_t host_adcsra;
+volatile uint8_t* host_adcsra_access(void);
+#define ADCSRA (*host_adcsra_access())
+
+//Bits of registers
+//TCCR0A
+#define WGM00 0
+#define WGM01 1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+//TCCR0B
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM02 3
+#define FOC0B 6
+#define FOC0A 7
+//TIMSK0
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+//TIFR0
+#define TOV0 0
+#define OCF0A 1
+#define OCF0B 2
+//TCCR1A
+#define WGM10 0
+#define WGM11 1
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+//TCCR1B
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define ICES1 6
+#define ICNC1 7
+//TIMSK1
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1 5
+//TIFR1
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+#define ICF1 5
+//TCCR2A
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+//TCCR2B
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define FOC2B 6
+#define FOC2A 7
+//TIMSK2
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+//TIFR2
+#define TOV2 0
+#define OCF2A 1
+#define OCF2B 2
+//ASSR
+#define TCR2BUB 0
+#define TCR2AUB 1
+#define OCR2BUB 2
+#define OCR2AUB 3
+#define TCN2UB 4
+#define AS2 5
+#define EXCLK 6
+//TCCR3A
+#define WGM30 0
+#define WGM31 1
+#define COM3B0 4
+#define COM3B1 5
+#define COM3A0 6
+#define COM3A1 7
+//TCCR3B
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define WGM32 3
+#define WGM33 4
+#define ICES3 6
+#define ICNC3 7
+//TIMSK3
+#define TOIE3 0
+#define OCIE3A 1
+#define OCIE3B 2
+#define ICIE3 5
+//TIFR3
+#define TOV3 0
+#define OCF3A 1
+#define OCF3B 2
+#define ICF3 5
+//GTCCR
+#define PSRSYNC 0
+#define PSRASY 1
+#define TSM 7
+//ADMUX
+#define MUX0 0
+#define MUX1 1
+#define MUX2 2
+#define MUX3 3
+#define MUX4 4
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+//ADCSRA
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+//ADCSRB
+#define ADTS0 0
+#define ADTS1 1
+#define ADTS2 2
+#define ACME 6
+//ACSR
+#define ACIS0 0
+#define ACIS1 1
+#define ACIC 2
+#define ACIE 3
+#define ACI 4
+#define ACO 5
+#define ACBG 6
+#define ACD 7
+//EICRA
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+#define ISC20 4
+#define ISC21 5
+//EIMSK
+#define INT0 0
+#define INT1 1
+#define INT2 2
+//EIFR
+#define INTF0 0
+#define INTF1 1
+#define INTF2 2
+//PCICR
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define PCIE3 3
+//SPCR
+#define SPR0 0
+#define SPR1 1
+#define CPHA 2
+#define CPOL 3
+#define MSTR 4
+#define DORD 5
+#define SPE 6
+#define SPIE 7
+//SPSR
+#define SPI2X 0
+#define WCOL 6
+#define SPIF 7
+//UCSRA
+#define MPCM 0
+#define U2X 1
+#define UPE 2
+#define DOR 3
+#define FE 4
+#define UDRE 5
+#define TXC 6
+#define RXC 7
+//UCSRB
+#define TXB8 0
+#define RXB8 1
+#define UCSZ2 2
+#define TXEN 3
+#define RXEN 4
+#define UDRIE 5
+#define TXCIE 6
+#define RXCIE 7
+//UCSRC
+#define UCPOL 0
+#define UCSZ0 1
+#define UCSZ1 2
+#define USBS 3
+#define UPM0 4
+#define UPM1 5
+#define UMSEL0 6
+#define UMSEL1 7
+//EECR
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+#define EEPM0 4
+#define EEPM1 5
+//WDTCSR
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE 3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+#define WDIF 7
+//MCUSR
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define JTRF 4
+//MCUCR
+#define IVCE 0
+#define IVSEL 1
+#define PUD 4
+#define BODSE 6
+#define BODS 7
+
+//Port bits
+#define PA0 0
+#define PA1 1
+#define PA2 2
+#define PA3 3
+#define PA4 4
+#define PA5 5
+#define PA6 6
+#define PA7 7
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PC7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+#define DDA0 0
+#define DDA1 1
+#define DDA2 2
+#define DDA3 3
+#define DDA4 4
+#define DDA5 5
+#define DDA6 6
+#define DDA7 7
+#define DDB0 0
+#define DDB1 1
+#define DDB2 2
+#define DDB3 3
+#define DDB4 4
+#define DDB5 5
+#define DDB6 6
+#define DDB7 7
+#define DDC0 0
+#define DDC1 1
+#define DDC2 2
+#define DDC3 3
+#define DDC4 4
+#define DDC5 5
+#define DDC6 6
+#define DDC7 7
+#define DDD0 0
+#define DDD1 1
+#define DDD2 2
+#define DDD3 3
+#define DDD4 4
+#define DDD5 5
+#define DDD6 6
+#define DDD7 7
+#define PINA0 0
+#define PINA1 1
+#define PINA2 2
+#define PINA3 3
+#define PINA4 4
+#define PINA5 5
+#define PINA6 6
+#define PINA7 7
+#define PINB0 0
+#define PINB1 1
+#define PINB2 2
+#define PINB3 3
+#define PINB4 4
+#define PINB5 5
+#define PINB6 6
+#define PINB7 7
+#define PINC0 0
+#define PINC1 1
+#define PINC2 2
+#define PINC3 3
+#define PINC4 4
+#define PINC5 5
+#define PINC6 6
+#define PINC7 7
+#define PIND0 0
+#define PIND1 1
+#define PIND2 2
+#define PIND3 3
+#define PIND4 4
+#define PIND5 5
+#define PIND6 6
+#define PIND7 7
+
+//Aliases used by the firmware (same as for real MCU, see avrio.h)
+#define RXEN0 RXEN
+#define TXEN0 TXEN
+#define UDRE0 UDRE
+#define RXC0 RXC
+#define RXCIE0 RXCIE
+#define UDRIE0 UDRIE
+#define UCSZ00 UCSZ0
+#define UCSZ01 UCSZ1
+#define U2X0 U2X
+#define UDR0 UDR
+#define UBRR0L UBRRL
+#define UBRR0H UBRRH
+#define UCSR0A UCSRA
+#define UCSR0B UCSRB
+#define UCSR0C UCSRC
+
+//Emulated EEPROM and FLASH
+#define HOST_EEPROM_SIZE 4096
+#define HOST_FLASH_SIZE  131072UL
+
+#define FLASHEND (HOST_FLASH_SIZE - 1)
+#define E2END    (HOST_EEPROM_SIZE - 1)
+
+extern uint8_t host_flash[HOST_FLASH_SIZE];
+
+/**Initialization of emulated memories (erased state) */
+void host_io_init(void);
+
+uint8_t host_eeprom_read(uint16_t addr);
+void host_eeprom_write(uint16_t addr, uint8_t value);
+
+/**Read byte from program space. Small addresses are mapped to the emulated FLASH image,
+ * other addresses are ordinary pointers to constant data
+ */
+static inline uint8_t host_pgm_get_byte(const void* addr)
+{
+ if ((uintptr_t)addr < HOST_FLASH_SIZE)
+  return host_flash[(uintptr_t)addr];
+ return *((const uint8_t*)addr);
+}
+
+static inline uint16_t host_pgm_get_word(const void* addr)
+{
+ return host_pgm_get_byte(addr) | (((uint16_t)host_pgm_get_byte((const uint8_t*)addr + 1)) << 8);
+}
+
+static inline uint32_t host_pgm_get_dword(const void* addr)
+{
+ return host_pgm_get_word(addr) | (((uint32_t)host_pgm_get_word((const uint8_t*)addr + 2)) << 16);
+}
+
+//Hooks implemented by the simulator
+void host_watchdog_reset(void);
+void host_delay_cycles(uint32_t cycles);
+void host_call_address(uint32_t addr);
+/**Free-running 16-bit timer based on host's clock, tick = 1ns. Used for profiling of the firmware's
+ * code on the host, because emulated timers do not advance between scheduling points */
+uint16_t host_free_timer(void);
+
+#endif //_SECU3_HOSTIO_H_
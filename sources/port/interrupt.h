@@ -33,6 +33,11 @@
  #define PRAGMA_QUOTE(x) _Pragma(#x)
  #define ISR(vec) PRAGMA_QUOTE(vector=vec) __interrupt void isr_##vec(void) 
 
+#elif defined(__linux__) //Host build
+ //Interrupt vectors become ordinary functions, so simulator can call them
+ //directly (e.g. isr_TIMER1_CAPT_vect()). See port/hostio.h
+ #define ISR(vec) void isr_##vec(void)
+
 #else //GCC
  #include <avr/interrupt.h>
 
@@ -43,6 +43,26 @@
  //accepts byte address!
  #define CALL_ADDRESS(addr) ((void (*)())((addr)/2))()
 
+#elif defined(__linux__) //Host build
+ #include "hostio.h"
+
+ #define __EEGET(val, addr) (val) = host_eeprom_read(addr)
+ #define __EEPUT(addr, val) host_eeprom_write(addr, val)
+
+ //abstracting intrinsics. Global interrupt flag is the I bit of emulated SREG
+ #define _ENABLE_INTERRUPT() (SREG |= 0x80)
+ #define _DISABLE_INTERRUPT() (SREG &= ~0x80)
+ #define _SAVE_INTERRUPT() SREG
+ #define _RESTORE_INTERRUPT(s) SREG = (s)
+ #define _NO_OPERATION() ((void)0)
+ #define _DELAY_CYCLES(cycles) host_delay_cycles(cycles)
+ #define _DELAY_US(us) host_delay_cycles((us) * (F_CPU / 1000000UL))
+ //Watchdog is reset at least once per main loop iteration, simulator uses it as its scheduling point
+ #define _WATCHDOG_RESET() host_watchdog_reset()
+
+ //accepts byte address!
+ #define CALL_ADDRESS(addr) host_call_address(addr)
+
 #else //AVR GCC
  #include <avr/eeprom.h>       //__EEGET(), __EEPUT() etc
 
@@ -51,11 +51,36 @@ __flash__ variable@sect_name
  #define PGM_GET_BYTE(addr) *(addr)
  #define PGM_GET_WORD(addr) *(addr)
  #define PGM_GET_DWORD(addr) *(addr)
+ #define PGM_GET_FPTR(addr) *(addr)
  #define MEMCPY_P(dest, src, len) memcpy_P(dest, src, len)
 
  #define _PGM __flash__
  #define _HPGM __hugeflash__
 
+#elif defined(__linux__) //Host build
+ #include <string.h>
+ #include <stdint.h>
+ #include "hostio.h"
+
+ //There is no separate program space on the host, linker decides where to place objects
+ #define PGM_FIXED_ADDR_OBJ(variable, sect_name) variable
+
+ //Declare variable in "FLASH"
+ #define PGM_DECLARE(x) const x
+
+ //Plain reads. Small addresses (e.g. CRC of the code area) are redirected to the emulated FLASH image
+ #define PGM_GET_BYTE(addr) host_pgm_get_byte((const void*)(addr))
+ #define PGM_GET_WORD(addr) host_pgm_get_word((const void*)(addr))
+ #define PGM_GET_DWORD(addr) host_pgm_get_dword((const void*)(addr))
+ //Function pointers are wider than 16 bits on host
+ #define PGM_GET_FPTR(addr) (*(addr))
+ #define MEMCPY_P(dest, src, len) memcpy(dest, src, len)
+
+ #define _PGM const
+ #define _HPGM const
+
+ typedef uint32_t pgmsize_t;
+
 #else //AVR GCC
  #include <avr/pgmspace.h>
 
@@ -69,11 +94,13 @@ __flash__ variable@sect_name
   #define PGM_GET_BYTE(addr) pgm_read_byte_far(addr)
   #define PGM_GET_WORD(addr) pgm_read_word_far(addr)
   #define PGM_GET_DWORD(addr) pgm_read_dword_far(addr)
+  #define PGM_GET_FPTR(addr) pgm_read_word_far(addr)
   #define MEMCPY_P(dest, src, len) memcpy_PF(dest, (uint_farptr_t)(src), len)
  #else //644
   #define PGM_GET_BYTE(addr) pgm_read_byte(addr)
   #define PGM_GET_WORD(addr) pgm_read_word(addr)
   #define PGM_GET_DWORD(addr) pgm_read_dword(addr)
+  #define PGM_GET_FPTR(addr) pgm_read_word(addr)
   #define MEMCPY_P(dest, src, len) memcpy_P(dest, src, len)
  #endif
 
@@ -41,6 +41,14 @@
   #error "avrio.h: Wrong platform identifier!"
  #endif
 
+#elif defined(__linux__) // Host build (simulator), GCC on Linux
+ //Firmware's entry point is called by the simulator's main(), see host/hostsim.c
+ #define MAIN() void secu3_main(void)
+
+ //Simulate the biggest platform
+ #define _PLATFORM_M1284_
+ #define F_CPU 20000000UL
+
 #elif defined(__GNUC__) // GNU Compiler
  //main() can be void if -ffreestanding compiler option specified.
  #define MAIN() __attribute__ ((OS_main)) void main(void)
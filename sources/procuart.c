@@ -33,6 +33,7 @@
 #include "camsens.h"
 #include "ce_errors.h"
 #include "ckps.h"
+#include "datalog.h"
 #include "diagnost.h"
 #include "ecudata.h"
 #include "injector.h"
@@ -267,11 +268,15 @@ void process_uart_interface(void)
   uart_notify_processed();
  }
 
- //periodically send frames with data
- if (!uart_is_sender_busy())
+ //periodically send frames with data. Next frame is built while previous one is still being transmitted
+ if (uart_is_tx_buff_free())
  {
   uint8_t desc = uart_get_send_mode();
-  if (desc == SILENT && !silent)
+#ifdef DELTA_SENSDAT
+  if (desc == SENSDLT_DAT)
+   desc = SENSOR_DAT; //same data, but delta encoded
+#endif
+  if (desc == SILENT && !silent && !uart_is_sender_busy())
   {
    uart_transmitter(0); //turn off transmitter
    silent = 1;
@@ -282,7 +287,11 @@ void process_uart_interface(void)
    silent = 0;
   }
 
-  if (s_timer_is_action(send_packet_interval_counter) && !silent)
+  if ((s_timer_is_action(send_packet_interval_counter)
+#ifdef DATA_LOGGER
+      || (desc == DLOGBL_DAT && datalog_is_block_ready()) //don't wait, otherwise ring buffer may overflow
+#endif
+      ) && !silent)
   {
    //----------------------------------
    if (startup_packets > 0)
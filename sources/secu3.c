@@ -40,12 +40,14 @@
 #include "choke.h"
 #include "ckps.h"
 #include "crc16.h"
+#include "datalog.h"
 #include "diagnost.h"
 #include "ecudata.h"
 #include "eculogic.h"
 #include "eeprom.h"
 #include "egosheat.h"
 #include "evap.h"
+#include "evtbus.h"
 #include "gasdose.h"
 #include "pwrvalve.h"
 #include "fuelpump.h"
@@ -57,9 +59,11 @@
 #include "injector.h"
 #include "intkheat.h"
 #include "ioconfig.h"
+#include "isrprof.h"
 #include "knklogic.h"
 #include "knock.h"
 #include "lambda.h"
+#include "loopprof.h"
 #include "magnitude.h"
 #include "measure.h"
 #include "mathemat.h"
@@ -84,6 +88,9 @@
 #else
 #define ENGINE_ROTATION_TIMEOUT_VALUE 20    //!< timeout value used to determine that engine is stopped (this value must not exceed 25)
 #endif
+#ifdef STROKE_SYNC_CALC
+#define CALC_TIMEOUT_VALUE            5     //!< timeout value used to perform calculations when engine is stopped or RPM is very low
+#endif
 
 /**Control of certain units of engine
  * Uses d ECU data structure
@@ -182,30 +189,70 @@ void check_firmware_integrity(void)
 }
 
 #ifdef DEFERRED_CRC
-#define DCFC_BLOCK_SIZE 128
+#define DCFC_STEP_SIZE     32     //!< number of bytes hashed between checks of the time budget
+#define DCFC_MAX_BLOCK     1024   //!< maximum number of bytes hashed per one call
+#define DCFC_LOOP_TARGET   313    //!< target duration of the main loop iteration including CRC, ticks of timer 1 (~1ms)
+#define DCFC_MAX_SKIPS     8      //!< if there was no slack during this number of calls, then one step is hashed anyway
+
+/**Calculates CRC of the firmware's code by parts, using slack of the main loop. Time spent by the
+ * rest of the main loop since previous call is measured and CRC is calculated during remaining part of
+ * DCFC_LOOP_TARGET. So, check is finished fast when engine is stopped or idling and pauses under heavy
+ * load (but never stops completely, see DCFC_MAX_SKIPS). Progress and speed are stored in d.fwcrc_xxx
+ */
 void deferred_check_firmware_crc(void)
 {
  static uint16_t fwcrc = 0xFFFF;
- static uint8_t _HPGM* ptr = 0;
+ static pgmsize_t pos = 0;     //offset of the next byte to be hashed
  static uint8_t finished = 0;
+ static uint16_t t_end = 0;    //timestamp of the end of previous call
+ static uint16_t t_start = 0;  //value of the system 10ms counter at the beginning of check
+ static uint8_t skips = 0;
+ uint16_t t_beg, budget, work, n, d_left;
+
+ if (finished || !CHECKBIT(PGM_GET_BYTE(&fw_data.def_param.bt_flags), BTF_CHK_FWCRC))
+  return;
+
+ t_beg = s_timer_ftc();
+ if (!pos)
+ { //first call, there is no measured time of the main loop yet
+  t_start = s_timer_gtc();
+  work = 0;
+ }
+ else
+  work = t_beg - t_end;         //time spent by the rest of the main loop
+ budget = (work < DCFC_LOOP_TARGET) ? DCFC_LOOP_TARGET - work : 0;
 
- if (!finished && CHECKBIT(PGM_GET_BYTE(&fw_data.def_param.bt_flags), BTF_CHK_FWCRC))
+ if (!budget && ++skips < DCFC_MAX_SKIPS)
  {
-  uint32_t d = (CODE_SIZE) - ((uint32_t)ptr);
-  if (d > DCFC_BLOCK_SIZE)
-  {
-   fwcrc = upd_crc16f(fwcrc, ptr, DCFC_BLOCK_SIZE);
-  }
-  else
-  {
-   fwcrc = upd_crc16f(fwcrc, ptr, d);
-   finished = 1;
-   if (fwcrc != PGM_GET_WORD(&fw_data.code_crc))
-    ce_set_error(ECUERROR_PROGRAM_CODE_BROKEN);
-   ce_enable_errors_clearing();
-  }
-  ptr+=DCFC_BLOCK_SIZE;
+  t_end = s_timer_ftc();
+  return;                       //no slack, pause
+ }
+ skips = 0;
+
+ n = 0;
+ do
+ {
+  d_left = ((CODE_SIZE) - pos > DCFC_STEP_SIZE) ? DCFC_STEP_SIZE : (CODE_SIZE) - pos;
+  fwcrc = upd_crc16f(fwcrc, ((uint8_t _HPGM*)0) + pos, d_left);
+  pos+= d_left;
+  n+= d_left;
+ }while(pos < (CODE_SIZE) && n < DCFC_MAX_BLOCK && (uint16_t)(s_timer_ftc() - t_beg) < budget);
+
+ //update progress (%) and achieved speed (bytes per ms)
+ {
+  uint16_t elapsed = (s_timer_gtc() - t_start) + 1; //10ms units
+  d.fwcrc_progress = (((uint32_t)pos) * 100) / (CODE_SIZE);
+  d.fwcrc_speed = ((uint32_t)pos) / (elapsed * 10UL);
  }
+
+ if (pos >= (CODE_SIZE))
+ {
+  finished = 1;
+  if (fwcrc != PGM_GET_WORD(&fw_data.code_crc))
+   ce_set_error(ECUERROR_PROGRAM_CODE_BROKEN);
+  ce_enable_errors_clearing();
+ }
+ t_end = s_timer_ftc();
 }
 #endif
 
@@ -351,8 +398,8 @@ void init_modules(void)
  //TODO: redundant code fragment
  ckps_set_inj_timing(param_inj_timing(0), d.inj_pw, d.param.inj_anglespec & 0xF); //use inj.timing on cranking, petrol
  inject_init_state();
+ inject_set_num_squirts(d.param.inj_config[0] & 0xF); //petrol, must be set before number of cylinders (used in division)
  inject_set_cyl_number(d.param.ckps_engine_cyl);
- inject_set_num_squirts(d.param.inj_config[0] & 0xF); //petrol
  inject_set_config(d.param.inj_config[0] >> 4, CHECKBIT(d.param.inj_flags, INJFLG_SECINJROWSWT));//petrol
 #endif
 #if defined(PHASE_SENSOR) && !defined(PHASED_IGNITION)
@@ -386,6 +433,19 @@ void init_modules(void)
  //Initialize measurement's unit and perform several measure cycles for setting of ring buffers to correct values
  meas_init();
 
+#ifdef LOOP_PROFILER
+ lprof_init();
+#endif
+#ifdef ISR_PROFILER
+ isrprof_init();
+#endif
+#ifdef EVENT_PROFILER
+ evtprof_init();
+#endif
+#ifdef DATA_LOGGER
+ datalog_init();
+#endif
+
 #ifdef FUEL_INJECT
  //must be called after meas_init()
  inject_set_fuelcut(!d.sys_locked && !engine_blowing_cond());
@@ -425,6 +485,9 @@ MAIN()
  //Start watchdog timer!
  wdt_start_timer();
 
+ //Read errors saved in the EEPROM journal, must precede load_eeprom_params()
+ ce_init_saved_errors();
+
  //Read all system parameters
  load_eeprom_params();
 
@@ -451,18 +514,15 @@ MAIN()
  //------------------------------------------------------------------------
  while(1)
  {
+  LPROF_BEGIN();
+
+  //update virtual timers
+  s_timer_process();
+
   if (ckps_is_cog_changed())
   {
    s_timer_set(engine_rotation_timeout_counter, ENGINE_ROTATION_TIMEOUT_VALUE);
-   eculogic_cog_changed_notification();
-   #ifdef INTK_HEATING
-   intkheat_cog_changed_notification();
-   #endif
-   vent_cog_changed_notification();
-#ifndef SECU3T
-   grheat_cog_changed_notification();
-   grvalve_cog_changed_notification();
-#endif
+   evtbus_dispatch(EVT_COG_CHANGED);
   }
 
   if (s_timer_is_action(engine_rotation_timeout_counter))
@@ -473,14 +533,7 @@ MAIN()
 #endif
    ckps_init_state_variables();
    cams_init_state_variables();
-   eculogic_eng_stopped_notification(); //set cranking mode
-#if defined(FUEL_INJECT) || defined(CARB_AFR) || defined(GD_CONTROL)
-   lambda_eng_stopped_notification();
-#endif
-   starter_eng_stopped_notification();
-#ifndef SECU3T
-   grvalve_eng_stopped_notification();
-#endif
+   evtbus_dispatch(EVT_ENG_STOPPED); //set cranking mode and notify other modules
    knklogic_init(&retard_state);
 
    if (d.param.knock_use_knock_channel)
@@ -500,29 +553,52 @@ MAIN()
    s_timer_set(force_measure_timeout_counter, FORCE_MEASURE_TIMEOUT_VALUE);
    meas_update_values_buffers(0, &fw_data.exdata.cesd);
   }
+  LPROF_STAGE(LPS_COGCHG);
 
   //----------continious execution-----------------------------------------
   //note: order of calls matters! Pay special attention if you are going to change it!
   //process and execute suspended operations
   sop_execute_operations();
+  //compare data being saved with EEPROM, so only changed bytes will be written
+  eeprom_process();
+  LPROF_STAGE(LPS_SOP);
   //Detection and recording of errors (checking engine)
   ce_check_engine(&ce_control_time_counter);
+  LPROF_STAGE(LPS_CE);
   //processing of ingoing and outgoing data via UART
   process_uart_interface();
+  LPROF_STAGE(LPS_UART);
   //detection of changes in parameters and its saving
   save_param_if_need();
+  LPROF_STAGE(LPS_SAVEPAR);
   //calculation of instant RPM
   d.sens.inst_frq = ckps_calculate_instant_freq();
+  LPROF_STAGE(LPS_INSTFRQ);
   //averaging of phisical magnitudes stored in the circular buffers
   meas_average_measured_values(&fw_data.exdata.cesd);
+  LPROF_STAGE(LPS_MEASAVG);
   //read discrete inputs of the system and switching of fuel type (sets of maps)
   meas_take_discrete_inputs();
-  //calculate arguments for lookup tables
-  calc_lookup_args();
-  //System's state machine core (dispatcher of modes)
-  eculogic_system_state_machine();
+  LPROF_STAGE(LPS_DISCRETE);
+#ifdef STROKE_SYNC_CALC
+  //Perform calculations once per engine stroke, at the tooth defined by fw_ex_data_t::calc_angle, so results are based on
+  //the freshest data and are ready before latching. Timer provides calculations when engine is stopped or RPM is very low.
+  if (ckps_is_calc_event_r() || s_timer_is_action(calc_timeout_counter))
+  {
+   s_timer_set(calc_timeout_counter, CALC_TIMEOUT_VALUE);
+#endif
+   //calculate arguments for lookup tables
+   calc_lookup_args();
+   LPROF_STAGE(LPS_LOOKUP);
+   //System's state machine core (dispatcher of modes)
+   eculogic_system_state_machine();
+   LPROF_STAGE(LPS_ECULOGIC);
+#ifdef STROKE_SYNC_CALC
+  }
+#endif
   //control peripheral devices (actuators)
   control_engine_units();
+  LPROF_STAGE(LPS_CTRLUNITS);
 
 #ifdef DWELL_CONTROL
 #if defined(HALL_SYNC) || defined(CKPS_NPLUS1)
@@ -548,6 +624,7 @@ MAIN()
    else
     ckps_enable_ignition(1);
   }
+  LPROF_STAGE(LPS_IGNCTRL);
 
   //------------------------------------------------------------------------
 
@@ -557,11 +634,8 @@ MAIN()
    meas_update_values_buffers(0, &fw_data.exdata.cesd);
    s_timer_set(force_measure_timeout_counter, FORCE_MEASURE_TIMEOUT_VALUE);
 
-   eculogic_stroke_event_notification();
-
-   ce_stroke_event_notification();
-
-   starter_stroke_event_notification();
+   //notify modules: ECU logic, CE, starter, lambda, gas doser, air conditioner
+   evtbus_dispatch(EVT_STROKE);
 
 #ifdef FUEL_INJECT
 #ifdef GD_CONTROL
@@ -572,19 +646,6 @@ MAIN()
 #endif
 #endif
 
-#if defined(FUEL_INJECT) || defined(CARB_AFR) || defined(GD_CONTROL)
-   lambda_stroke_event_notification();
-#endif
-
-
-#ifdef GD_CONTROL
-   gasdose_stroke_event_notification();
-#endif
-
-#ifdef AIRCONDIT
-   aircond_stroke_event_notification();
-#endif
-
    //----------------------------------------------
    if (d.param.knock_use_knock_channel)
    {
@@ -596,7 +657,16 @@ MAIN()
    else
     d.corr.knock_retard = 0;
    //----------------------------------------------
+
+#ifdef DATA_LOGGER
+   //take record of the data logger after all values of this stroke have been calculated
+   datalog_stroke_event_notification();
+#endif
   }
+#ifdef DATA_LOGGER
+  datalog_process();
+#endif
+  LPROF_STAGE(LPS_STROKE);
 
   //save ignition timing for applying in the nearest ignition stroke
   ckps_set_advance_angle(d.corr.curr_angle);
@@ -613,6 +683,7 @@ MAIN()
 #ifdef FUEL_INJECT
   inject_calc_fuel_flow();
 #endif
+  LPROF_STAGE(LPS_SETANGLE);
 
 #ifdef DIAGNOSTICS
   diagnost_process();
@@ -629,6 +700,11 @@ MAIN()
   wdt_reset_timer();
 #endif
 
+#ifdef ISR_PROFILER
+  isrprof_process();
+#endif
+  LPROF_STAGE(LPS_MISC);
+
  }//main loop
  //------------------------------------------------------------------------
 }
@@ -0,0 +1,128 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file sensdlt.c
+ * \author Alexey A. Shabelnikov
+ * Implementation of the delta encoder of the SENSOR_DAT packets.
+ */
+
+#ifdef DELTA_SENSDAT
+
+#include <stdint.h>
+#include "sensdlt.h"
+
+#ifndef UART_BINARY
+ #error "DELTA_SENSDAT option requires UART_BINARY"
+#endif
+
+/**Reads 16-bit big-endian word from the buffer */
+#define GET_WORD(b, i) ((((uint16_t)(b)[(i)*2]) << 8) | (b)[(i)*2+1])
+
+/**Calculates zigzag code of the difference between two words, so small negative
+ * differences also give small codes
+ * \param cur current value of word
+ * \param prev previous value of word
+ * \return code
+ */
+static uint16_t zigzag(uint16_t cur, uint16_t prev)
+{
+ int16_t d = (int16_t)(cur - prev);
+ return (((uint16_t)d) << 1) ^ (uint16_t)(d >> 15);
+}
+
+/**\return number of bytes in varint representation of the code (1...3) */
+static uint8_t varint_len(uint16_t z)
+{
+ return (z < 0x80) ? 1 : ((z < 0x4000) ? 2 : 3);
+}
+
+void sensdlt_reset(sensdlt_t* s)
+{
+ s->size = 0;
+}
+
+uint8_t* sensdlt_get_buf(sensdlt_t* s)
+{
+ return s->buf[s->cur];
+}
+
+void sensdlt_encode(sensdlt_t* s, uint8_t size, void (*put)(uint8_t))
+{
+ uint8_t* cur = s->buf[s->cur];
+ uint8_t* prev = s->buf[s->cur ^ 1];
+ uint8_t words = (size + 1) >> 1, i;
+ uint8_t len = 0xFF; //size of delta frame (header, bitmap, varints), 0xFF - delta frame is not allowed
+
+ if (size & 1)
+  cur[size] = 0; //pad last word
+
+ if (size == s->size && s->count < (SENSDLT_KEY_PERIOD - 1))
+ {
+  len = 1 + ((words + 7) >> 3);
+  for(i = 0; i < words; ++i)
+  {
+   uint16_t z = zigzag(GET_WORD(cur, i), GET_WORD(prev, i));
+   if (z)
+    len+= varint_len(z);
+  }
+ }
+
+ if (len < (size + 2))
+ { //delta frame
+  uint8_t bits = 0;
+  put(s->seq);
+  for(i = 0; i < words; ++i)
+  {
+   if (GET_WORD(cur, i) != GET_WORD(prev, i))
+    bits|= (1 << (i & 7));
+   if ((i & 7) == 7 || i == (words - 1))
+   {
+    put(bits);
+    bits = 0;
+   }
+  }
+  for(i = 0; i < words; ++i)
+  {
+   uint16_t z = zigzag(GET_WORD(cur, i), GET_WORD(prev, i));
+   if (!z)
+    continue;
+   for(; z >= 0x80; z >>= 7)
+    put((z & 0x7F) | 0x80);
+   put(z);
+  }
+  ++s->count;
+ }
+ else
+ { //key frame
+  put(s->seq | SENSDLT_KEY_FLAG);
+  put(size);
+  for(i = 0; i < size; ++i)
+   put(cur[i]);
+  s->count = 0;
+ }
+
+ s->size = size;
+ s->seq = (s->seq + 1) & SENSDLT_SEQ_MASK;
+ s->cur^= 1;
+}
+
+#endif //DELTA_SENSDAT
@@ -0,0 +1,74 @@
+/* SECU-3  - An open source, free engine control unit
+   Copyright (C) 2007 Alexey A. Shabelnikov. Ukraine, Kiev
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   contacts:
+              http://secu-3.org
+              email: shabelnikov@secu-3.org
+*/
+
+
+/** \file sensdlt.h
+ * \author Alexey A. Shabelnikov
+ * Delta encoder of the SENSOR_DAT packets (compact telemetry mode, packet SENSDLT_DAT).
+ * Payload of the packet is treated as array of 16-bit big-endian words. Each frame begins
+ * with header byte: bit 7 - key frame flag, bits 0-6 - sequence number.
+ * Key frame: header, size of payload in bytes, raw payload.
+ * Delta frame: header, bitmap of changed words (bit 0 of the first byte - word 0),
+ * differences of changed words (relative to the previous frame) coded as zigzag varints
+ * (7 bits per byte, least significant group first, bit 7 - continuation flag).
+ * Key frame is sent each SENSDLT_KEY_PERIOD frames, when size of payload changes or when
+ * delta frame would not be smaller. Receiver must skip delta frames until the next key frame
+ * if sequence number is not continuous (e.g. packet was lost).
+ */
+
+#ifndef _SENSDLT_H_
+#define _SENSDLT_H_
+
+#include <stdint.h>
+
+#define SENSDLT_MAX_SIZE   96    //!< maximum size of payload (must be even)
+#define SENSDLT_KEY_PERIOD 16    //!< key frame is sent at least once per this number of frames
+#define SENSDLT_KEY_FLAG   0x80  //!< key frame flag in the header byte
+#define SENSDLT_SEQ_MASK   0x7F  //!< mask of the sequence number in the header byte
+
+/**Describes state of the encoder */
+typedef struct
+{
+ uint8_t buf[2][SENSDLT_MAX_SIZE];  //!< current and previous frames (ping-pong)
+ uint8_t cur;                       //!< index of buffer containing current frame
+ uint8_t size;                      //!< size of the previous frame, 0 - there is no previous frame
+ uint8_t seq;                       //!< sequence number of the next frame
+ uint8_t count;                     //!< number of frames sent since last key frame
+}sensdlt_t;
+
+/**Resets encoder, so next frame will be a key frame
+ * \param s pointer to state of the encoder
+ */
+void sensdlt_reset(sensdlt_t* s);
+
+/**\param s pointer to state of the encoder
+ * \return pointer to buffer (SENSDLT_MAX_SIZE bytes) which must be filled with payload of the current frame
+ */
+uint8_t* sensdlt_get_buf(sensdlt_t* s);
+
+/**Encodes current frame (see sensdlt_get_buf()) and outputs it byte by byte
+ * \param s pointer to state of the encoder
+ * \param size size of payload in bytes (1...SENSDLT_MAX_SIZE)
+ * \param put callback function which outputs one byte of the encoded frame
+ */
+void sensdlt_encode(sensdlt_t* s, uint8_t size, void (*put)(uint8_t));
+
+#endif //_SENSDLT_H_
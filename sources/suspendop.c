@@ -35,35 +35,94 @@
 #include "suspendop.h"
 #include "uart.h"
 #include "ufcodes.h"
+#include "vstimer.h"
 #include "wdt.h"
 
-/**Maximum allowed number of suspended operations */
-#define SUSPENDED_OPERATIONS_SIZE 32
+/**Operations which require EEPROM to be idle */
+#define SOP_EEPROM_OPS (_BV16(SOP_SAVE_PARAMETERS) | _BV16(SOP_SAVE_CE_MERGED_ERRORS) | _BV16(SOP_SAVE_CE_ERRORS) | SOP_EEPROM_TABLSET_OPS)
 
-/**Contains queue of suspended operations. Each operation can appear one time */
-uint8_t suspended_opcodes[SUSPENDED_OPERATIONS_SIZE];
+/**Operations which require UART's transmitter to be free */
+#define SOP_UART_OPS (_BV16(SOP_SEND_NC_RESET_EEPROM) | _BV16(SOP_SEND_NC_PARAMETERS_SAVED) | _BV16(SOP_SEND_NC_CE_ERRORS_SAVED) | \
+                      _BV16(SOP_TRANSMIT_CE_ERRORS) | _BV16(SOP_SEND_FW_SIG_INFO) | SOP_UART_TABLSET_OPS | SOP_UART_DIAG_OPS | SOP_UART_DBGVAR_OPS)
+
+#ifdef REALTIME_TABLES
+ #define SOP_EEPROM_TABLSET_OPS (_BV16(SOP_LOAD_TABLSET) | _BV16(SOP_SAVE_TABLSET))
+ #define SOP_UART_TABLSET_OPS (_BV16(SOP_SEND_NC_TABLSET_LOADED) | _BV16(SOP_SEND_NC_TABLSET_SAVED))
+#else
+ #define SOP_EEPROM_TABLSET_OPS 0
+ #define SOP_UART_TABLSET_OPS 0
+#endif
+
+#ifdef DIAGNOSTICS
+ #define SOP_UART_DIAG_OPS (_BV16(SOP_SEND_NC_ENTER_DIAG) | _BV16(SOP_SEND_NC_LEAVE_DIAG))
+#else
+ #define SOP_UART_DIAG_OPS 0
+#endif
+
+#ifdef DEBUG_VARIABLES
+ #define SOP_UART_DBGVAR_OPS _BV16(SOP_DBGVAR_SENDING)
+#else
+ #define SOP_UART_DBGVAR_OPS 0
+#endif
+
+/**Deadline of saving of merged CE errors, in 10ms ticks. This operation has the lowest priority among EEPROM
+ * operations, so it could wait for long time when EEPROM is heavily used by other operations */
+#define SOP_CE_MERGED_DEADLINE 200
+
+#ifdef DEBUG_VARIABLES
+/**Deadline of sending of debug variables, in 10ms ticks */
+#define SOP_DBGVAR_DEADLINE 50
+#endif
+
+/**Operations which have deadline. Operation which waits longer than its deadline becomes overdue and is
+ * executed before all other runnable operations */
+#define SOP_DEADLINE_OPS (_BV16(SOP_SAVE_CE_MERGED_ERRORS) | SOP_UART_DBGVAR_OPS)
+
+/**Describes state of suspended operations */
+typedef struct
+{
+ uint16_t pending;                  //!< bitmap of pending operations, each operation can appear one time
+ uint16_t overdue;                  //!< bitmap of pending operations which have exceeded their deadlines
+ uint8_t stamp_ce_merged;           //!< time (10ms ticks, low byte) when saving of merged CE errors was set
+#ifdef DEBUG_VARIABLES
+ uint8_t stamp_dbgvar;              //!< time (10ms ticks, low byte) when sending of debug variables was set
+#endif
+}sop_state_t;
+
+/**State variables of suspended operations */
+sop_state_t sop = {0};
 
 /*inline*/
 void sop_set_operation(uint8_t opcode)
 {
- suspended_opcodes[(opcode)] = (opcode);
+ if (!(sop.pending & _BV16(opcode)))
+ { //remember time of the first request of operation having deadline
+  if (opcode == SOP_SAVE_CE_MERGED_ERRORS)
+   sop.stamp_ce_merged = (uint8_t)s_timer_gtc();
+#ifdef DEBUG_VARIABLES
+  else if (opcode == SOP_DBGVAR_SENDING)
+   sop.stamp_dbgvar = (uint8_t)s_timer_gtc();
+#endif
+ }
+ sop.pending|= _BV16(opcode);
 }
 
 /*inline*/
 void sop_reset_operation(uint8_t opcode)
 {
- suspended_opcodes[opcode] = SOP_NA;
+ sop.pending&= ~_BV16(opcode);
+ sop.overdue&= ~_BV16(opcode);
 }
 
 /*inline*/
 uint8_t sop_is_operation_active(uint8_t opcode)
 {
- return (suspended_opcodes[(opcode)] == (opcode));
+ return !!(sop.pending & _BV16(opcode));
 }
 
 void sop_init_operations(void)
 {
- memset(suspended_opcodes, SOP_NA, SUSPENDED_OPERATIONS_SIZE);
+ memset(&sop, 0, sizeof(sop_state_t));
 }
 
 /**Delay 25ms*/
@@ -78,219 +137,185 @@ void delay_25ms(void)
  _DELAY_US(1000);    //1ms
 }
 
-//        .
-void sop_execute_operations(void)
+/**Priority encoder. Finds the highest priority operation (lowest set bit) in the specified bitmap
+ * \param ops bitmap of operations, must not be 0
+ * \return code of operation
+ */
+static uint8_t sop_first_operation(uint16_t ops)
 {
- if (sop_is_operation_active(SOP_SAVE_PARAMETERS))
+ uint8_t b = (uint8_t)ops, i = 0;
+ if (!b)
  {
-  //     ,   EEPROM     - 
-  //     EEPROM       .
-  if (eeprom_is_idle())
-  {
+  b = (uint8_t)(ops >> 8);
+  i = 8;
+ }
+ if (!(b & 0x0F))
+ {
+  b >>= 4;
+  i+= 4;
+ }
+ if (!(b & 0x03))
+ {
+  b >>= 2;
+  i+= 2;
+ }
+ if (!(b & 0x01))
+  ++i;
+ return i;
+}
+
+/**Checks deadlines of pending operations and marks operations which have exceeded them as overdue.
+ * Overdue flag is latched, because age is calculated using 8-bit time stamps
+ */
+static void sop_check_deadlines(void)
+{
+ uint8_t now = (uint8_t)s_timer_gtc();
+ if ((sop.pending & _BV16(SOP_SAVE_CE_MERGED_ERRORS)) && ((uint8_t)(now - sop.stamp_ce_merged)) >= SOP_CE_MERGED_DEADLINE)
+  sop.overdue|= _BV16(SOP_SAVE_CE_MERGED_ERRORS);
+#ifdef DEBUG_VARIABLES
+ if ((sop.pending & _BV16(SOP_DBGVAR_SENDING)) && ((uint8_t)(now - sop.stamp_dbgvar)) >= SOP_DBGVAR_DEADLINE)
+  sop.overdue|= _BV16(SOP_DBGVAR_SENDING);
+#endif
+}
+
+/**Executes specified operation. Resources required by operation must be free
+ * \param opcode code of operation
+ */
+static void sop_run_operation(uint8_t opcode)
+{
+ //""         .
+ sop_reset_operation(opcode);
+
+ switch(opcode)
+ {
+  case SOP_SAVE_PARAMETERS:
    //               EEPROM.
    memcpy(&eeprom_parameters_cache, &d.param, sizeof(params_t));
    eeprom_parameters_cache.crc = crc16((uint8_t*)&eeprom_parameters_cache, sizeof(params_t)-PAR_CRC_SIZE); //calculate check sum
-   eeprom_start_wr_data(OPCODE_EEPROM_PARAM_SAVE, EEPROM_PARAM_START, &eeprom_parameters_cache, sizeof(params_t));
+   eeprom_start_wr_changes(OPCODE_EEPROM_PARAM_SAVE, EEPROM_PARAM_START, &eeprom_parameters_cache, sizeof(params_t)); //only changed bytes
 
    //   ,         EEPROM 
    //      
    ce_clear_error(ECUERROR_EEPROM_PARAM_BROKEN);
+   break;
 
-   //""         .
-   sop_reset_operation(SOP_SAVE_PARAMETERS);
-  }
- }
-
- if (sop_is_operation_active(SOP_SAVE_CE_MERGED_ERRORS))
- {
-  // EEPROM  ,        Cehck Engine.
-  //   EEPROM c      , 
-  //    .      .
-  if (eeprom_is_idle())
-  {
+  case SOP_SAVE_CE_MERGED_ERRORS:
+   //      Cehck Engine.    EEPROM
+   //c      ,      .
    ce_save_merged_errors(0);
+   break;
 
-   //""         .
-   sop_reset_operation(SOP_SAVE_CE_MERGED_ERRORS);
-  }
- }
-
- if (sop_is_operation_active(SOP_SEND_NC_PARAMETERS_SAVED))
- {
-  // ?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_SEND_NC_PARAMETERS_SAVED:
    _AB(d.op_comp_code, 0) = OPCODE_EEPROM_PARAM_SAVE;
    uart_send_packet(OP_COMP_NC);    //    
+   break;
 
-   //""         .
-   sop_reset_operation(SOP_SEND_NC_PARAMETERS_SAVED);
-  }
- }
-
- if (sop_is_operation_active(SOP_SAVE_CE_ERRORS))
- {
-  if (eeprom_is_idle())
-  {
+  case SOP_SAVE_CE_ERRORS:
    ce_save_merged_errors(&d.ecuerrors_saved_transfer);
+   break;
 
-   //""         .
-   sop_reset_operation(SOP_SAVE_CE_ERRORS);
-  }
- }
-
- if (sop_is_operation_active(SOP_SEND_NC_CE_ERRORS_SAVED))
- {
-  // ?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_SEND_NC_CE_ERRORS_SAVED:
    _AB(d.op_comp_code, 0) = OPCODE_CE_SAVE_ERRORS;
    uart_send_packet(OP_COMP_NC);    //    
+   break;
 
-   //""         .
-   sop_reset_operation(SOP_SEND_NC_CE_ERRORS_SAVED);
-  }
- }
-
- if (sop_is_operation_active(SOP_READ_CE_ERRORS))
- {
-  if (eeprom_is_idle())
-  {
-   eeprom_read(&d.ecuerrors_saved_transfer, EEPROM_ECUERRORS_START, sizeof(uint32_t));
+  case SOP_READ_CE_ERRORS:
+   //saved errors are cached in RAM, so EEPROM is not needed
+   d.ecuerrors_saved_transfer = ce_get_saved_errors();
    sop_set_operation(SOP_TRANSMIT_CE_ERRORS);
-   //""         .
-   sop_reset_operation(SOP_READ_CE_ERRORS);
-  }
- }
+   break;
 
- if (sop_is_operation_active(SOP_TRANSMIT_CE_ERRORS))
- {
-  // ?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_TRANSMIT_CE_ERRORS:
    uart_send_packet(CE_SAVED_ERR);    //    
-   //""         .
-   sop_reset_operation(SOP_TRANSMIT_CE_ERRORS);
-  }
- }
+   break;
 
- if (sop_is_operation_active(SOP_SEND_FW_SIG_INFO))
- {
-  // ?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_SEND_FW_SIG_INFO:
    uart_send_packet(FWINFO_DAT);    //    
-   //""         .
-   sop_reset_operation(SOP_SEND_FW_SIG_INFO);
-  }
- }
+   break;
 
 #ifdef REALTIME_TABLES
- if (sop_is_operation_active(SOP_SEND_NC_TABLSET_LOADED))
- {
-  // ?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_SEND_NC_TABLSET_LOADED:
    _AB(d.op_comp_code, 0) = OPCODE_LOAD_TABLSET;
    _AB(d.op_comp_code, 1) = 0; //not used
    uart_send_packet(OP_COMP_NC);    //    
+   break;
 
-   //""         .
-   sop_reset_operation(SOP_SEND_NC_TABLSET_LOADED);
-  }
- }
-
- if (sop_is_operation_active(SOP_LOAD_TABLSET))
- {
-  //TODO: d.op_actn_code may become overwritten while we are waiting here...
-  if (eeprom_is_idle())
+  case SOP_LOAD_TABLSET:
   {
+   //TODO: d.op_actn_code may become overwritten while we are waiting here...
    //bits: aaaabbbb
    // aaaa - not used
    // bbbb - index of tables set to load from, begins from FLASH's indexes
    uint8_t index = (_AB(d.op_actn_code, 1) & 0xF);
    load_specified_tables_into_ram(index);
-   //""         .
-   sop_reset_operation(SOP_LOAD_TABLSET);
+   break;
   }
- }
 
- if (sop_is_operation_active(SOP_SEND_NC_TABLSET_SAVED))
- {
-  // ?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_SEND_NC_TABLSET_SAVED:
    _AB(d.op_comp_code, 0) = OPCODE_SAVE_TABLSET;
    _AB(d.op_comp_code, 1) = 0; //not used
    uart_send_packet(OP_COMP_NC);    //    
+   break;
 
-   //""         .
-   sop_reset_operation(SOP_SEND_NC_TABLSET_SAVED);
-  }
- }
-
- if (sop_is_operation_active(SOP_SAVE_TABLSET))
- {
-  //TODO: d.op_actn_code may become overwritten while we are waiting here...
-  if (eeprom_is_idle())
-  {
-   eeprom_start_wr_data(OPCODE_SAVE_TABLSET, EEPROM_REALTIME_TABLES_START, &d.tables_ram, sizeof(f_data_t));
-
-   //""         .
-   sop_reset_operation(SOP_SAVE_TABLSET);
-  }
- }
-
+  case SOP_SAVE_TABLSET:
+   //TODO: d.op_actn_code may become overwritten while we are waiting here...
+   eeprom_start_wr_changes(OPCODE_SAVE_TABLSET, EEPROM_REALTIME_TABLES_START, &d.tables_ram, sizeof(f_data_t)); //only changed bytes
+   break;
 #endif
 
 #ifdef DEBUG_VARIABLES
- if (sop_is_operation_active(SOP_DBGVAR_SENDING))
- {
-  //Is sender busy ( )?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_DBGVAR_SENDING:
    uart_send_packet(DBGVAR_DAT);    //send packet with debug information
-   //"delete" this operation from list because it has already completed
-   sop_reset_operation(SOP_DBGVAR_SENDING);
-  }
- }
+   break;
 #endif
 
 #ifdef DIAGNOSTICS
- if (sop_is_operation_active(SOP_SEND_NC_ENTER_DIAG))
- {
-  //Is sender busy ( )?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_SEND_NC_ENTER_DIAG:
    _AB(d.op_comp_code, 0) = OPCODE_DIAGNOST_ENTER;
    uart_send_packet(OP_COMP_NC);    //    
-   //"delete" this operation from list because it has already completed
-   sop_reset_operation(SOP_SEND_NC_ENTER_DIAG);
-  }
- }
- if (sop_is_operation_active(SOP_SEND_NC_LEAVE_DIAG))
- {
-  //Is sender busy ( )?
-  if (!uart_is_sender_busy())
-  {
+   break;
+
+  case SOP_SEND_NC_LEAVE_DIAG:
    _AB(d.op_comp_code, 0) = OPCODE_DIAGNOST_LEAVE;
    uart_send_packet(OP_COMP_NC);    //    
    delay_25ms();       //wait 25ms because of pending UART packet
    wdt_reset_device(); //wait for death :-)
-  }
- }
+   break;
 #endif
 
- if (sop_is_operation_active(SOP_SEND_NC_RESET_EEPROM))
- {
-  // ?
-  if (!uart_is_sender_busy())
-  {
+  case SOP_SEND_NC_RESET_EEPROM:
    _AB(d.op_comp_code, 0) = OPCODE_RESET_EEPROM;
    _AB(d.op_comp_code, 1) = 0x55;
    uart_send_packet(OP_COMP_NC);    //    
    delay_25ms();           //wait 25ms because of pending UART packet
    reset_eeprom_params();  //no back way!
+   break;
+ }
+}
+
+//        .
+void sop_execute_operations(void)
+{
+ uint16_t ops;
+
+ if (sop.pending)
+ {
+  sop_check_deadlines();
+
+  for(;;)
+  {
+   //select operations whose resources are free. Operation which was not able to start (EEPROM
+   //or transmitter is busy) will be executed later, when resource becomes free.
+   ops = sop.pending;
+   if (!eeprom_is_idle())
+    ops&= ~SOP_EEPROM_OPS;
+   if (!uart_is_tx_buff_free())  //packet can be built while previous one is still being transmitted
+    ops&= ~SOP_UART_OPS;
+   if (!ops)
+    break;
+   if (ops & sop.overdue)
+    ops&= sop.overdue;   //overdue operations go first
+   sop_run_operation(sop_first_operation(ops));
   }
  }
 
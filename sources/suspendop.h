@@ -29,29 +29,34 @@
 
 #include <stdint.h>
 
-#define SOP_NA                     255    //!< not defined
-#define SOP_SAVE_PARAMETERS          0    //!< save parameters
-#define SOP_SAVE_CE_MERGED_ERRORS    1    //!< save merged bits of CE errors
-#define SOP_SEND_NC_PARAMETERS_SAVED 2    //!< notify that parameters has been saved
-#define SOP_SAVE_CE_ERRORS           3    //!< save CE errors into EEPROM
+//Codes of suspended operations. Code is also a priority of operation: the lower code, the higher priority
+//(notifications go first, so they are not stuck behind long EEPROM operations). Maximum 16 operations.
+#define SOP_SEND_NC_RESET_EEPROM     0    //!< notify that device has entered into the EEPROM resetting mode
+#ifdef DIAGNOSTICS
+#define SOP_SEND_NC_LEAVE_DIAG       1    //!< notify that device has left diagnostic mode
+#define SOP_SEND_NC_ENTER_DIAG       2    //!< notify that device has entered diagnostic mode
+#endif
+#define SOP_SEND_NC_PARAMETERS_SAVED 3    //!< notify that parameters has been saved
 #define SOP_SEND_NC_CE_ERRORS_SAVED  4    //!< notify that CE errors has been saved
-#define SOP_READ_CE_ERRORS           5    //!< read CE errors
-#define SOP_TRANSMIT_CE_ERRORS       6    //!< transmit CE errors
-#define SOP_SEND_FW_SIG_INFO         7    //!< send signature information about firmware
 #ifdef REALTIME_TABLES
-#define SOP_LOAD_TABLSET             9    //!< load new set of tables
-#define SOP_SEND_NC_TABLSET_LOADED  10    //!< notify that new tables set has being selected
-#define SOP_SAVE_TABLSET            11    //!< save table set for selected fuel from RAM to EEPROM
-#define SOP_SEND_NC_TABLSET_SAVED   12    //!< notify that table set for selected fuel has been saved
+#define SOP_SEND_NC_TABLSET_LOADED   5    //!< notify that new tables set has being selected
+#define SOP_SEND_NC_TABLSET_SAVED    6    //!< notify that table set for selected fuel has been saved
 #endif
-#ifdef DEBUG_VARIABLES
-#define SOP_DBGVAR_SENDING          13    //!< send out some of firmware variables
+#define SOP_TRANSMIT_CE_ERRORS       7    //!< transmit CE errors
+#define SOP_SEND_FW_SIG_INFO         8    //!< send signature information about firmware
+#define SOP_READ_CE_ERRORS           9    //!< read CE errors
+#ifdef REALTIME_TABLES
+#define SOP_LOAD_TABLSET            10    //!< load new set of tables
 #endif
-#ifdef DIAGNOSTICS
-#define SOP_SEND_NC_ENTER_DIAG      14    //!< notify that device has entered diagnostic mode
-#define SOP_SEND_NC_LEAVE_DIAG      15    //!< notify that device has left diagnostic mode
+#define SOP_SAVE_CE_ERRORS          11    //!< save CE errors into EEPROM
+#define SOP_SAVE_PARAMETERS         12    //!< save parameters
+#ifdef REALTIME_TABLES
+#define SOP_SAVE_TABLSET            13    //!< save table set for selected fuel from RAM to EEPROM
+#endif
+#define SOP_SAVE_CE_MERGED_ERRORS   14    //!< save merged bits of CE errors
+#ifdef DEBUG_VARIABLES
+#define SOP_DBGVAR_SENDING          15    //!< send out some of firmware variables
 #endif
-#define SOP_SEND_NC_RESET_EEPROM    16    //!< notify that device has entered into the EEPROM resetting mode
 
 //      0
 #define OPCODE_EEPROM_PARAM_SAVE     1    //!< save EEPROM parameters
@@ -82,7 +87,8 @@ uint8_t sop_is_operation_active(uint8_t opcode);
 /**Module initialization */
 void sop_init_operations(void);
 
-/**Process queue of suspended operations
+/**Process queue of suspended operations. Executes pending operations whose resources (EEPROM, UART's
+ * transmitter) are free, in order of priority. Overdue operations (see deadlines) are executed first.
  * Uses d ECU data structure
  */
 void sop_execute_operations(void);
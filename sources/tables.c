@@ -937,6 +937,9 @@ PGM_FIXED_ADDR_OBJ(fw_data_t fw_data, ".firmware_data") =
   .tdc_angle = {3648, 9408, 15168, 20928, 0, 0, 0 ,0},
   .smp_angle = 66*32,  //66
   .dwl_dead_time = 312, //1ms
+  .calc_angle = 30*32, //30
+  .inp_flt = {MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG,
+              MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG, MEAS_FLT_AVG}, //Type of filter for each input
 
   /**reserved bytes*/
   {0}
@@ -115,6 +115,11 @@
 
 #define INPUTNUM                        14          //!< number of ring buffers (analog inputs)
 
+//Types of filters which can be selected for each input (see fw_ex_data_t::inp_flt)
+#define MEAS_FLT_AVG                    0           //!< moving average (default)
+#define MEAS_FLT_MED3                   1           //!< median of 3 samples followed by moving average
+#define MEAS_FLT_EMA                    2           //!< exponential filter, time constant equal to number of averages
+
 #define PWMIAC_UCOEF_SIZE               16          //!< size of PWM IAC duty coefficient vs board voltage map
 #define AFTSTR_STRK_SIZE                16
 
@@ -461,12 +466,14 @@ typedef struct fw_ex_data_t
   uint16_t tdc_angle[8];  //Angle of TDC for each cylinder, value * ANGLE_MULTIPLIER, relatively to 0 tooth.
   uint16_t smp_angle;     //Angle for sampling of sensors, value * ANGLE_MULTIPLIER, relatively to TDC (BTDC)
   uint16_t dwl_dead_time; //Dwell dead time, 1 discrete = 3.2us
+  uint16_t calc_angle;    //Angle before latching of ignition timing at which calculations are started (STROKE_SYNC_CALC), value * ANGLE_MULTIPLIER
+  uint8_t  inp_flt[INPUTNUM]; //Type of filter for each input (MEAS_FLT_xxx)
   //---------------------------------------------------------------
 
   /**Following reserved bytes required for keeping binary compatibility between
    * different versions of firmware. Useful when you add/remove members to/from
    * this structure. */
-  uint8_t reserved[3758];
+  uint8_t reserved[3742];
 }fw_ex_data_t;
 
 /**Describes a universal programmable output*/
@@ -743,7 +750,11 @@ typedef struct params_t
 }params_t;
 
 //Define data structures are related to code area data and IO remapping data
+#ifdef __linux__ //host build (simulator)
+typedef uintptr_t fnptr_t;               //!< Special type for function pointers (they are wider than 16 bits on host)
+#else
 typedef uint16_t fnptr_t;                //!< Special type for function pointers
+#endif
 #define IOREM_SLOTS  49                  //!< Number of slots used for I/O remapping
 #define IOREM_PLUGS  92                  //!< Number of plugs used in I/O remapping
 
@@ -31,14 +31,22 @@
 #include "port/port.h"
 #include <string.h>
 #include "bitmask.h"
+#include "ckps.h"
+#include "datalog.h"
 #include "dbgvar.h"
 #include "ecudata.h"
 #include "eeprom.h"
+#include "funconv.h"
 #include "ioconfig.h"
+#include "isrprof.h"
+#include "loopprof.h"
+#include "sensdlt.h"
 #include "uart.h"
 #include "ufcodes.h"
 #include "wdt.h"
 
+#define secu3_offsetof(type,member)   ((size_t)(&((type *)0)->member))
+
 #define ETMT_NAME_STR 0     //!< name of tables's set id
 //ignition maps
 #define ETMT_STRT_MAP 1     //!< start map id
@@ -76,15 +84,26 @@ typedef struct
 {
  uint8_t send_mode;                     //!< current descriptor of packets beeing send
  uint8_t recv_buf[UART_RECV_BUFF_SIZE]; //!< receiver's buffer
+ uint8_t send_size;                     //!< size of data in the builder's buffer
+ uint8_t* tx_ptr;                       //!< pointer to the next byte to be transmitted
+ volatile uint8_t tx_size;              //!< number of bytes remaining to be transmitted
+#ifdef UART_DBLBUF
+ uint8_t send_bufs[2][UART_SEND_BUFF_SIZE]; //!< transmitter's buffers (ping-pong): one is being built, other is being transmitted
+ uint8_t* send_buf;                     //!< transmitter's buffer which is owned by packet builder
+ volatile uint8_t tx_pend;              //!< size of packet waiting in the builder's buffer for transmission, 0 - none
+#else
  uint8_t send_buf[UART_SEND_BUFF_SIZE]; //!< transmitter's buffer
- volatile uint8_t send_size;            //!< size of data to be send
- uint8_t send_index;                    //!< index in transmitter's buffer
+#endif
  volatile uint8_t recv_size;            //!< size of received data
  uint8_t recv_index;                    //!< index in receiver's buffer
 }uartstate_t;
 
 /**State variables */
-uartstate_t uart = {0,{0},{0},0,0,0,0};
+#ifdef UART_DBLBUF
+uartstate_t uart = {0,{0},0,0,0,{{0},{0}},0,0,0,0};
+#else
+uartstate_t uart = {0,{0},0,0,0,{0},0,0};
+#endif
 
 #ifdef UART_BINARY //binary mode
 // There are several special reserved symbols in binary mode: 0x21, 0x40, 0x0D, 0x0A
@@ -145,6 +164,38 @@ uint8_t takeout_rx_buff(void)
   return b1;
 }
 
+#ifdef DELTA_SENSDAT
+/**State of the delta encoder of SENSOR_DAT packets */
+static sensdlt_t sensdlt;
+
+/** Replaces payload of the packet built in the sender's buffer (follows descriptor) by
+ * delta encoded frame (SENSDLT_DAT). Payload is unstuffed into encoder's buffer and encoded
+ * frame is stuffed back. If payload is too big, then packet is sent as SENSOR_DAT
+ */
+static void encode_sensdlt(void)
+{
+ uint8_t* raw = sensdlt_get_buf(&sensdlt);
+ uint8_t i = 2, size = 0;
+ while(i < uart.send_size)
+ {
+  uint8_t b = uart.send_buf[i++];
+  if (size == SENSDLT_MAX_SIZE)
+  {
+   uart.send_buf[1] = SENSOR_DAT; //does not fit, send packet as is
+   return;
+  }
+  if (b == FESC)
+  {
+   b = uart.send_buf[i++];
+   b = (b == TFOBEGIN) ? FOBEGIN : ((b == TFIOEND) ? FIOEND : FESC);
+  }
+  raw[size++] = b;
+ }
+ uart.send_size = 2; //rewind to the beginning of payload
+ sensdlt_encode(&sensdlt, size, append_tx_buff);
+}
+#endif
+
 #else //HEX mode
 
 /**For BIN-->HEX encoding */
@@ -354,11 +405,31 @@ static void recept_rw(uint16_t* ramBuffer, uint8_t size)
 
 //--------------------------------------------------------------------
 
-/**Makes sender to start sending */
+/**Gives builder's buffer to the transmitter and takes other one (if UART_DBLBUF) for building of the next packet.
+ * Must be called with interrupts disabled
+ * \param size Size of packet in the builder's buffer
+ */
+static void swap_send_buffs(uint8_t size)
+{
+ uart.tx_ptr = uart.send_buf;
+ uart.tx_size = size;
+#ifdef UART_DBLBUF
+ uart.send_buf = (uart.send_buf == uart.send_bufs[0]) ? uart.send_bufs[1] : uart.send_bufs[0];
+#endif
+ uart.send_size = 0;
+}
+
+/**Makes sender to start sending. If previous packet is still being transmitted (UART_DBLBUF), then built
+ * packet is queued and will be taken by the UDRE interrupt */
 void uart_begin_send(void)
 {
- uart.send_index = 0;
  _DISABLE_INTERRUPT();
+#ifdef UART_DBLBUF
+ if (uart.tx_size)
+  uart.tx_pend = uart.send_size; //transmitter is busy, queue packet
+ else
+#endif
+  swap_send_buffs(uart.send_size);
  UCSRB |= _BV(UDRIE); /* enable UDRE interrupt */
  _ENABLE_INTERRUPT();
 }
@@ -478,7 +549,7 @@ void uart_send_packet(uint8_t send_mode)
     if (eeprom_is_idle())
     {
      build_i8h(index);
-     eeprom_read(&uart.send_buf[uart.send_size], (uint16_t)((f_data_t*)(EEPROM_REALTIME_TABLES_START))->name, F_NAME_SIZE);
+     eeprom_read(&uart.send_buf[uart.send_size], EEPROM_REALTIME_TABLES_START + secu3_offsetof(f_data_t, name), F_NAME_SIZE);
      uart.send_size+=F_NAME_SIZE;
     }
     else //skip this item - will be transferred next time
@@ -496,6 +567,9 @@ void uart_send_packet(uint8_t send_mode)
    if (index>=(TABLES_NUMBER)) index = 0;
     break;
 
+#ifdef DELTA_SENSDAT
+  case SENSDLT_DAT:  //same data as SENSOR_DAT, will be encoded after building
+#endif
   case SENSOR_DAT:
 #ifdef SEND_INST_VAL
    build_i16h(d.sens.inst_frq);          // instant RPM
@@ -825,12 +899,16 @@ void uart_send_packet(uint8_t send_mode)
 
   case FWINFO_DAT:
    //  ,       . 3  -    .
-#if ((UART_SEND_BUFF_SIZE - 3) < FW_SIGNATURE_INFO_SIZE+8)
+#if ((UART_SEND_BUFF_SIZE - 3) < FW_SIGNATURE_INFO_SIZE+8+6)
  #error "Out of buffer!"
 #endif
    build_fs(fw_data.fw_signature_info, FW_SIGNATURE_INFO_SIZE);
    build_i32h(PGM_GET_DWORD(&fw_data.cddata.config));   //<--compile-time options
    build_i8h(PGM_GET_BYTE(&fw_data.cddata.fw_version)); //<--version of the firmware
+#ifdef DEFERRED_CRC
+   build_i8h(d.fwcrc_progress);                         //<--progress of the deferred CRC check, %
+   build_i16h(d.fwcrc_speed);                           //<--achieved speed of the deferred CRC check, bytes/ms
+#endif
    break;
 
   case SIGINF_DAT:
@@ -1230,6 +1308,65 @@ void uart_send_packet(uint8_t send_mode)
    build_i16h(dbg_var4);
    break;
 #endif
+#ifdef LOOP_PROFILER
+  case LPROF_DAT:
+  {//send statistics of one stage per packet
+   static uint8_t stage = 0;
+   uint8_t i;
+   lprof_stat_t* p_st = &lprof_stat[stage];
+   build_i8h(stage);
+   build_i16h(p_st->s.count);
+   build_i16h(p_st->s.count ? p_st->min : 0);
+   build_i16h(p_st->s.max);
+   build_i16h(p_st->s.count ? (p_st->s.sum / p_st->s.count) : 0); //mean
+   for(i = 0; i < LPROF_HIST_SIZE; ++i)
+    build_i16h(p_st->hist[i]);
+   if (++stage >= LPS_NUMBER)
+    stage = 0;
+   break;
+  }
+#endif
+#ifdef ISR_PROFILER
+  case ISRPROF_DAT:
+  {//send statistics of all channels
+   uint8_t ch;
+   for(ch = 0; ch < IPC_NUMBER; ++ch)
+   {
+    isrprof_stat_t* p_st = &isrprof_stat[ch];
+    build_i8h(p_st->count ? p_st->min : 0);
+    build_i8h(p_st->max);            //worst case
+    build_i8h(isrprof_p99(ch));      //99th percentile
+    build_i16h(p_st->count);
+    build_i16h(p_st->lost);
+   }
+#ifdef DWELL_CONTROL
+   build_i16h(ckps_get_eq_overruns()); //ignition event queue overruns
+#endif
+   break;
+  }
+#endif
+#ifdef DATA_LOGGER
+  case DLOGCF_PAR:
+  {
+   uint8_t ch;
+   build_i8h(dlog_cfg.period);
+   for(ch = 0; ch < DLOG_MAX_CHANNELS; ++ch)
+   {
+    build_i16h(dlog_cfg.chan[ch].offset);
+    build_i4h(dlog_cfg.chan[ch].size);
+   }
+   break;
+  }
+  case DLOGBL_DAT:
+  {
+   uint8_t num = datalog_begin_block(), size;
+   build_i8h(datalog_get_recsize());  //size of record (sequence number and values of channels)
+   build_i8h(num);                    //number of records in block
+   for(size = num * datalog_get_recsize(); size; --size)
+    build_i8h(datalog_read_byte());
+   break;
+  }
+#endif
 #ifdef DIAGNOSTICS
   case DIAGINP_DAT:
    build_i8h(d.diag_inp.flags);
@@ -1269,6 +1406,11 @@ void uart_send_packet(uint8_t send_mode)
 #endif
  }//switch
 
+#ifdef DELTA_SENSDAT
+ if (send_mode == SENSDLT_DAT)
+  encode_sensdlt();
+#endif
+
  //common part for all packets
  uart.send_buf[uart.send_size++] = '\r';
 
@@ -1717,9 +1859,24 @@ uint8_t uart_recept_packet(void)
      recept_rb(((uint8_t*)&d.tables_ram.pwm_duty2[0][0]) + addr, F_WRK_POINTS_F); /*F_WRK_POINTS_F max*/
      break;
    }
+   invalidate_lookup_cache(); //content of maps has been changed
   }
   break;
 #endif
+#ifdef DATA_LOGGER
+  case DLOGCF_PAR:
+  {
+   uint8_t ch;
+   dlog_cfg.period = recept_i8h();
+   for(ch = 0; ch < DLOG_MAX_CHANNELS; ++ch)
+   {
+    dlog_cfg.chan[ch].offset = recept_i16h();
+    dlog_cfg.chan[ch].size = recept_i4h();
+   }
+   datalog_apply_config();
+   break;
+  }
+#endif
 #ifdef DIAGNOSTICS
   case DIAGOUT_DAT:
    d.diag_out = recept_i32h();
@@ -1750,7 +1907,20 @@ void uart_notify_processed(void)
 
 uint8_t uart_is_sender_busy(void)
 {
- return (uart.send_size > 0);
+#ifdef UART_DBLBUF
+ return (uart.tx_size > 0 || uart.tx_pend > 0);
+#else
+ return (uart.tx_size > 0);
+#endif
+}
+
+uint8_t uart_is_tx_buff_free(void)
+{
+#ifdef UART_DBLBUF
+ return !uart.tx_pend;
+#else
+ return !uart.tx_size;   //single buffer is free only when it has been transmitted
+#endif
 }
 
 uint8_t uart_is_packet_received(void)
@@ -1765,6 +1935,10 @@ uint8_t uart_get_send_mode(void)
 
 uint8_t uart_set_send_mode(uint8_t descriptor)
 { //note: code of this function must follow code in uart_send_packet() !
+#ifdef DELTA_SENSDAT
+ if (descriptor == SENSDLT_DAT)
+  sensdlt_reset(&sensdlt); //start from key frame
+#endif
  switch(descriptor)
  {
   case TEMPER_PAR:
@@ -1775,6 +1949,9 @@ uint8_t uart_set_send_mode(uint8_t descriptor)
   case STARTR_PAR:
   case FNNAME_DAT:
   case SENSOR_DAT:
+#ifdef DELTA_SENSDAT
+  case SENSDLT_DAT:
+#endif
   case ADCCOR_PAR:
   case ADCRAW_DAT:
   case CKPS_PAR:
@@ -1809,6 +1986,16 @@ uint8_t uart_set_send_mode(uint8_t descriptor)
 #ifdef DEBUG_VARIABLES
   case DBGVAR_DAT:
 #endif
+#ifdef LOOP_PROFILER
+  case LPROF_DAT:
+#endif
+#ifdef ISR_PROFILER
+  case ISRPROF_DAT:
+#endif
+#ifdef DATA_LOGGER
+  case DLOGCF_PAR:
+  case DLOGBL_DAT:
+#endif
 #ifdef DIAGNOSTICS
   case DIAGINP_DAT:
 #endif
@@ -1849,6 +2036,9 @@ void uart_init(uint16_t baud)
 #endif
 
  uart.send_mode = SENSOR_DAT;
+#ifdef UART_DBLBUF
+ uart.send_buf = uart.send_bufs[0];
+#endif
 }
 
 
@@ -1857,11 +2047,18 @@ void uart_init(uint16_t baud)
  */
 ISR(USART_UDRE_vect)
 {
- if (uart.send_size > 0)
+#ifdef UART_DBLBUF
+ if (!uart.tx_size && uart.tx_pend)
+ { //previous packet has been transmitted, take queued one
+  swap_send_buffs(uart.tx_pend);
+  uart.tx_pend = 0;
+ }
+#endif
+
+ if (uart.tx_size > 0)
  {
-  UDR = uart.send_buf[uart.send_index];
-  --uart.send_size;
-  ++uart.send_index;
+  UDR = *uart.tx_ptr++;
+  --uart.tx_size;
  }
  else
  {//  
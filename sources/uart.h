@@ -61,7 +61,8 @@
 // Interface of the module
 
 /**Builds a packet depending of type of the current descriptor and launches it on the transfer.
- * Function does not check the transmitter is busy or not, it should be done before the call
+ * Function does not check the transmitter's buffer is free or not, it should be done before the call
+ * (see uart_is_tx_buff_free())
  * Uses d ECU data structure
  * \param send_mode code of descriptor of packet to be send
  */
@@ -77,9 +78,15 @@
 /**Call this function to tell service that you already accepted frame (reset busy state) */
  void uart_notify_processed(void);
 
-/**\return 1 if sender is busy, otherwise - 0 */
+/**\return 1 if sender is busy (there are data which are not transmitted yet), otherwise - 0 */
  uint8_t uart_is_sender_busy(void);
 
+/**With UART_DBLBUF option transmitter uses two buffers: packet is built in one of them while other one is
+ * being transmitted. Otherwise there is only one buffer and it is free when all data have been transmitted.
+ * \return 1 if next packet can be built (with UART_DBLBUF even if previous packet is still being transmitted), otherwise - 0
+ */
+ uint8_t uart_is_tx_buff_free(void);
+
 /**This function checks for received frame
  * \return 1 if unprocessed frame is pending
  */
@@ -41,6 +41,7 @@
 
 #define   FNNAME_DAT   'p'   //!< used for transfering of names of set of functions (lookup tables)
 #define   SENSOR_DAT   'q'   //!< used for transfering of sensors data
+#define   SENSDLT_DAT  'Q'   //!< used for transfering of sensors data, delta encoded (see sensdlt.h)
 
 #define   ADCCOR_PAR   'r'   //!< parameters related to ADC corrections
 #define   ADCRAW_DAT   's'   //!< used for transfering 'raw' values directly from ADC
@@ -59,6 +60,8 @@
 #define   ATTTAB_PAR   '}'   //!< used for transferring of attenuator map (knock detection related)
 #define   RPMGRD_PAR   '"'   //!< used for transferring of RPM grid
 #define   DBGVAR_DAT   ':'   //!< for watching of firmware variables (used for debug purposes)
+#define   LPROF_DAT    '$'   //!< statistics of the main loop profiler (execution time of stages)
+#define   ISRPROF_DAT  '+'   //!< statistics of the interrupt profiler (latency, execution time, spark error)
 #define   DIAGINP_DAT  '='   //!< diagnostics: send input values (analog & digital values)
 #define   DIAGOUT_DAT  '^'   //!< diagnostics: receive output states (bits)
 
@@ -78,5 +81,7 @@
 #define   LZBLHS       'H'   //!< "handshake" command sent to injector driver
 #define   CLTGRD_PAR   '('   //!< used for transferring of CLT grid
 #define   LODGRD_PAR   ')'   //!< used for transferring of load grid
+#define   DLOGCF_PAR   '<'   //!< configuration of the data logger (list of channels, sampling period)
+#define   DLOGBL_DAT   '>'   //!< block of records of the data logger
 
 #endif //_UFCODES_H_
@@ -32,6 +32,7 @@
 #include "bitmask.h"
 #include "ce_errors.h"
 #include "ioconfig.h" //for SM_CONTROL
+#include "isrprof.h"
 #include "tables.h"
 #include "vstimer.h"
 #include "knock.h" //for knock_start_expander_latching()
@@ -40,7 +41,12 @@
  frequency will be divided by 6 */
 #define DIVIDER_RELOAD       5
 
-//TODO: Do refactoring of timers! Implement callback mechanism.
+/**Subtracts specified number of ticks from the timer, timer stops at zero */
+#define s_timer_sub(T, N)    { if ((T) > (N)) (T)-= (N); else (T) = 0; }
+
+#ifdef __linux__ //host build: timer 1 is not running between scheduling points, use host's clock instead
+ #define FREE_TIMER() host_free_timer()
+#endif
 
 volatile s_timer8_t  send_packet_interval_counter = 0;    //!< used for sending of packets
 volatile s_timer8_t  force_measure_timeout_counter = 0;   //!< used by measuring process when engine is stopped
@@ -53,12 +59,18 @@ volatile s_timer16_t save_param_timeout_counter = 0;      //!< used for saving o
 volatile s_timer16_t fuel_pump_time_counter = 0;          //!< used for fuel pump
 #endif
 volatile s_timer16_t powerdown_timeout_counter = 0;       //!< used for power-down timeout 
+#ifdef STROKE_SYNC_CALC
+volatile s_timer8_t  calc_timeout_counter = 0;            //!< used to perform calculations when there are no engine strokes
+#endif
 
 /**for division, to achieve 10ms, because timer overflovs each 2 ms */
 uint8_t divider = DIVIDER_RELOAD;
 
 volatile uint16_t sys_counter = 0;                        //!< system tick counter, 1 tick = 10ms
 
+/**Value of the system tick counter at the last update of virtual timers (see s_timer_process()) */
+uint16_t s_timer_last = 0;
+
 #ifdef SM_CONTROL
 //See smcontrol.c
 extern volatile uint16_t sm_steps;
@@ -111,6 +123,7 @@ static volatile uint8_t diagnostics = 0;   //!< diagnostics flag
  */
 ISR(TIMER2_OVF_vect)
 {
+ ISRPROF_ENTER();
  _ENABLE_INTERRUPT();
 
 #ifdef DIAGNOSTICS
@@ -227,24 +240,14 @@ if (!diagnostics) {
  else
  {//each 10 ms
   divider = DIVIDER_RELOAD;
-  s_timer_update(force_measure_timeout_counter);
-  s_timer_update(save_param_timeout_counter);
-  s_timer_update(send_packet_interval_counter);
-  s_timer_update(ce_control_time_counter);
-  s_timer_update(engine_rotation_timeout_counter);
-  s_timer_update(epxx_delay_time_counter);
-  s_timer_update(idle_period_time_counter);
-#ifdef FUEL_PUMP
-  s_timer_update(fuel_pump_time_counter);
-#endif
-  s_timer_update(powerdown_timeout_counter);
-  ++sys_counter;
+  ++sys_counter;    //virtual timers are updated from the main loop, see s_timer_process()
  }
 
  _DISABLE_INTERRUPT();
 #if !defined(SECU3T) || defined(OBD_SUPPORT) //---SECU-3i---
  knock_start_expander_latching();
 #endif
+ ISRPROF_LEAVE(IPC_VST_DUR);
 }
 
 void s_timer_init(void)
@@ -272,6 +275,43 @@ uint16_t s_timer_gtc(void)
  return result;
 }
 
+uint16_t s_timer_ftc(void)
+{
+#ifdef FREE_TIMER
+ return FREE_TIMER();
+#else
+ uint16_t t;
+ _BEGIN_ATOMIC_BLOCK(); //ICR1/OCR1x are accessed from interrupts and share the TEMP register with TCNT1
+ t = TCNT1;
+ _END_ATOMIC_BLOCK();
+ return t;
+#endif
+}
+
+void s_timer_process(void)
+{
+ uint16_t t = s_timer_gtc();
+ uint16_t n = t - s_timer_last;  //number of ticks elapsed since last update
+ if (!n)
+  return;                        //nothing to do, timers can change only once per 10ms
+ s_timer_last = t;
+
+ s_timer_sub(force_measure_timeout_counter, n);
+ s_timer_sub(save_param_timeout_counter, n);
+ s_timer_sub(send_packet_interval_counter, n);
+ s_timer_sub(ce_control_time_counter, n);
+ s_timer_sub(engine_rotation_timeout_counter, n);
+ s_timer_sub(epxx_delay_time_counter, n);
+ s_timer_sub(idle_period_time_counter, n);
+#ifdef FUEL_PUMP
+ s_timer_sub(fuel_pump_time_counter, n);
+#endif
+ s_timer_sub(powerdown_timeout_counter, n);
+#ifdef STROKE_SYNC_CALC
+ s_timer_sub(calc_timeout_counter, n);
+#endif
+}
+
 #ifdef DIAGNOSTICS
 void s_timer_enter_diag(void)
 {
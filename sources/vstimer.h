@@ -81,9 +81,19 @@ extern volatile uint16_t sys_counter;
  return result;
 }*/
 
+/**Get value of the free-running timer 1 (tick = 3.2us). Used to measure short intervals of time
+ * (profilers, deferred check of firmware's CRC) */
+uint16_t s_timer_ftc(void);
+
 /**Initialization of system timers */
 void s_timer_init(void);
 
+/**Updates virtual timers: subtracts number of system ticks elapsed since last call. Interrupt of system
+ * timer only counts ticks, so this function must be called from each loop which uses virtual timers
+ * (main loop, diagnostics and blink codes loops)
+ */
+void s_timer_process(void);
+
 #ifdef DIAGNOSTICS
 /**Enter diagnostics compatible mode*/
 void s_timer_enter_diag(void);
@@ -101,6 +111,9 @@ extern volatile s_timer16_t save_param_timeout_counter;
 extern volatile s_timer16_t fuel_pump_time_counter;
 #endif
 extern volatile s_timer16_t powerdown_timeout_counter;
+#ifdef STROKE_SYNC_CALC
+extern volatile s_timer8_t  calc_timeout_counter;
+#endif
 //////////////////////////////////////////////////////////////////
 
 #endif //_VSTIMER_H_